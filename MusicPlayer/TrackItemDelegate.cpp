@@ -1,4 +1,5 @@
 #include <QPainter>
+#include <QtMath>
 #include <QMouseEvent>
 #include <QApplication>
 #include <QMenu>
@@ -6,6 +7,7 @@
 #include <qfileinfo.h>
 
 #include "TrackItemDelegate.h"
+#include "librarymanager.h"
 
 TrackItemDelegate::TrackItemDelegate(QObject* parent, Context ctx, MediaController* externalMediaController) :
     QStyledItemDelegate(parent),
@@ -41,14 +43,21 @@ void TrackItemDelegate::paint(QPainter* painter,
     }
 
     // Fetch data from the model
-    Track* track = qvariant_cast<Track*>(index.data(Qt::UserRole));
-    QString title  = track->title;
-    QString artist = track->artist;
+    const TrackHandle handle = index.data(Qt::UserRole).value<TrackHandle>();
+    Track track;
+    if (!LibraryManager::instance().getTrack(handle, track)) {
+        // Removed from the library (the list is about to catch up), or an
+        // entry that names no file under the roots.
+        painter->restore();
+        return;
+    }
+    QString title  = track.title;
+    QString artist = track.artist;
     bool    fav    = index.data(IsFavouriteRole ).toBool();
     bool isPlaying = index.data(IsPlayingRole).toBool();
 
     // 0) If this row is the currently playing track, give it a special highlight:
-    QString thisPath = track->filePath;
+    QString thisPath = track.filePath;
     QString playing  = mediaController->getAudioPlayback()->getCurrentTrackPath();
     if (!playing.isEmpty() && QFileInfo(playing).canonicalFilePath() ==
                                   QFileInfo(thisPath).canonicalFilePath())
@@ -72,8 +81,11 @@ void TrackItemDelegate::paint(QPainter* painter,
     // favourite icon on the right before overflow icon
     QRect heartRect(r.right() - (iconSize*2 + margin*2), r.top() + (iconSize/2), iconSize, iconSize);
 
+    // cover art after the play icon, as tall as the row allows
+    QRect coverRect(playRect.right() + margin*2, r.top(), r.height(), r.height());
+
     // text in the middle
-    int textX = playRect.right() + margin*3;
+    int textX = coverRect.right() + margin*2;
     int textW = heartRect.left() - margin - textX;
     QRect titleRect(textX, r.top() + margin/2, textW, iconSize);
     QRect artistRect(textX, r.top() + (margin*2) + 4, textW, iconSize);
@@ -81,6 +93,19 @@ void TrackItemDelegate::paint(QPainter* painter,
     // Draw the play icon
     (isPlaying ? pauseIcon : playIcon).paint(painter, playRect);
 
+    // Draw the cover: a stored thumbnail, never the full-size picture
+    const qreal dpr = painter->device()->devicePixelRatio();
+    QPixmap cover = LibraryManager::instance().getCoverArt(handle, qCeil(coverRect.height() * dpr));
+    if (!cover.isNull()) {
+        QSize coverSize = cover.size().scaled(coverRect.size(), Qt::KeepAspectRatio);
+        QRect target(QPoint(0, 0), coverSize);
+        target.moveCenter(coverRect.center());
+        painter->setRenderHint(QPainter::SmoothPixmapTransform);
+        painter->drawPixmap(target, cover);
+    } else {
+        painter->fillRect(coverRect, hover);
+    }
+
     // Draw the overflow icon
     moreIcon.paint(painter, moreRect);
     // Draw heart icon
@@ -193,8 +218,10 @@ bool TrackItemDelegate::editorEvent(QEvent* event,
         {
             // 1) Build the menu
             QMenu menu;
-            Track* track = qvariant_cast<Track*>(index.data(Qt::UserRole));
-            QString trackName = QFileInfo(track->filePath).fileName();
+            const QString trackPath = LibraryManager::instance().getTrackPath(index.data(Qt::UserRole).value<TrackHandle>());
+            if (trackPath.isEmpty())
+                return true;
+            QString trackName = LibraryManager::instance().toLibraryPath(trackPath);
             qDebug() << "trackName" << trackName;
             menu.addAction("Add/Remove in Playlist", [=]{
                 emit overflowActionRequested(index, OverflowCommand::AddToPlaylist, trackName);
@@ -0,0 +1,161 @@
+#include "acousticfingerprint.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+
+void AcousticFingerprint::prepare(double sampleRate)
+{
+    // Never above TargetRate, so a frame's duration always fits the transform.
+    const int factor = juce::jmax(1, static_cast<int>(std::ceil(sampleRate / TargetRate - 1.0e-9)));
+    decimator.prepare(factor, sampleRate);
+    const double rate = decimator.getOutputRate();
+
+    hopSamples = Hop * rate / TargetRate;
+    frameLength = juce::jlimit(2, FrameSize, static_cast<int>(std::lround(FrameSize * rate / TargetRate)));
+
+    fft = FftBackend::createFastest(FrameOrder);
+
+    window.resize(static_cast<size_t>(frameLength));
+    const double pi = juce::MathConstants<double>::pi;
+    for (int i = 0; i < frameLength; ++i)
+        window[static_cast<size_t>(i)] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * pi * i / (frameLength - 1)));
+
+    // Log-spaced band edges, as FFT bins; every band at least one bin wide.
+    const double binHz = rate / FrameSize;
+    const double maxHz = juce::jmin(MaxHz, rate * 0.5 - binHz);
+    for (int band = 0; band <= NumBands; ++band)
+    {
+        const double hz = MinHz * std::pow(maxHz / MinHz, static_cast<double>(band) / NumBands);
+        bandEdges[static_cast<size_t>(band)] = static_cast<int>(std::lround(hz / binHz));
+        if (band > 0)
+            bandEdges[static_cast<size_t>(band)] = juce::jmax(bandEdges[static_cast<size_t>(band)],
+                                                              bandEdges[static_cast<size_t>(band - 1)] + 1);
+    }
+
+    ring.assign(static_cast<size_t>(frameLength), 0.0f);
+    fftData.assign(static_cast<size_t>(FrameSize * 2), 0.0f);
+    decimated.clear();
+    writeIndex = 0;
+    filled = 0;
+    untilNextFrame = 0.0;
+    havePrevious = false;
+    words.clear();
+}
+
+void AcousticFingerprint::process(const float* samples, int numSamples)
+{
+    decimated.resize(static_cast<size_t>(numSamples / decimator.getFactor() + 1));
+    const int numDecimated = decimator.process(samples, numSamples, decimated.data());
+
+    for (int i = 0; i < numDecimated; ++i)
+    {
+        ring[static_cast<size_t>(writeIndex)] = decimated[static_cast<size_t>(i)];
+        if (++writeIndex == frameLength)
+            writeIndex = 0;
+        filled = juce::jmin(filled + 1, frameLength);
+
+        if (filled == frameLength && (untilNextFrame -= 1.0) <= 0.0)
+        {
+            untilNextFrame += hopSamples;
+            processFrame();
+        }
+    }
+}
+
+void AcousticFingerprint::processFrame()
+{
+    // Oldest sample first: from writeIndex to the end of the ring, then the
+    // start; zeros after it up to FrameSize (the transform overwrote them).
+    for (int i = 0, r = writeIndex; i < frameLength; ++i, r = (r + 1 == frameLength ? 0 : r + 1))
+        fftData[static_cast<size_t>(i)] = ring[static_cast<size_t>(r)] * window[static_cast<size_t>(i)];
+    std::fill(fftData.begin() + frameLength, fftData.begin() + FrameSize, 0.0f);
+    fft->performRealForward(fftData.data());
+
+    std::array<float, NumBands> energy {};
+    for (int band = 0; band < NumBands; ++band)
+    {
+        float sum = 0.0f;
+        for (int bin = bandEdges[static_cast<size_t>(band)]; bin < bandEdges[static_cast<size_t>(band + 1)]; ++bin)
+        {
+            const float re = fftData[static_cast<size_t>(2 * bin)];
+            const float im = fftData[static_cast<size_t>(2 * bin + 1)];
+            sum += re * re + im * im;
+        }
+        energy[static_cast<size_t>(band)] = sum;
+    }
+
+    if (havePrevious)
+    {
+        uint32_t word = 0;
+        for (int band = 0; band < NumBands - 1; ++band)
+        {
+            const float now = energy[static_cast<size_t>(band)] - energy[static_cast<size_t>(band + 1)];
+            const float before = previousEnergy[static_cast<size_t>(band)] - previousEnergy[static_cast<size_t>(band + 1)];
+            if (now - before > 0.0f)
+                word |= 1u << band;
+        }
+        words.push_back(word);
+    }
+
+    previousEnergy = energy;
+    havePrevious = true;
+}
+
+AcousticFingerprint::Words AcousticFingerprint::compute(juce::AudioFormatReader& reader, double maxSeconds)
+{
+    AcousticFingerprint fingerprint;
+    fingerprint.prepare(reader.sampleRate);
+
+    constexpr int blockSize = 8192;
+    const int numChannels = juce::jlimit(1, 2, static_cast<int>(reader.numChannels));
+    juce::AudioBuffer<float> block(numChannels, blockSize);
+    std::vector<float> mono(static_cast<size_t>(blockSize));
+
+    const juce::int64 length = juce::jmin(reader.lengthInSamples,
+                                          static_cast<juce::int64>(maxSeconds * reader.sampleRate));
+    for (juce::int64 position = 0; position < length; position += blockSize)
+    {
+        const int numSamples = static_cast<int>(juce::jmin<juce::int64>(blockSize, length - position));
+        if (!reader.read(&block, 0, numSamples, position, true, numChannels > 1))
+            break;
+
+        const float scale = 1.0f / static_cast<float>(numChannels);
+        for (int i = 0; i < numSamples; ++i)
+        {
+            float sum = 0.0f;
+            for (int channel = 0; channel < numChannels; ++channel)
+                sum += block.getSample(channel, i);
+            mono[static_cast<size_t>(i)] = sum * scale;
+        }
+        fingerprint.process(mono.data(), numSamples);
+    }
+
+    return fingerprint.words;
+}
+
+float AcousticFingerprint::bitErrorRate(const uint32_t* a, int aSize, const uint32_t* b, int bSize, int offset)
+{
+    const int first = juce::jmax(0, -offset);
+    const int last = juce::jmin(aSize, bSize - offset);
+    if (last - first < MinOverlapWords)
+        return 1.0f;
+
+    int differing = 0;
+    for (int i = first; i < last; ++i)
+        differing += static_cast<int>(std::bitset<32>(a[i] ^ b[i + offset]).count());
+
+    return static_cast<float>(differing) / static_cast<float>(32 * (last - first));
+}
+
+AcousticFingerprint::Alignment AcousticFingerprint::align(const Words& a, const Words& b, int maxShift)
+{
+    Alignment best;
+    for (int offset = -maxShift; offset <= maxShift; ++offset)
+    {
+        const float bitErrors = bitErrorRate(a, b, offset);
+        if (bitErrors < best.bitErrors)
+            best = { offset, bitErrors };
+    }
+    return best;
+}
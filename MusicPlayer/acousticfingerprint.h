@@ -0,0 +1,109 @@
+#ifndef ACOUSTICFINGERPRINT_H
+#define ACOUSTICFINGERPRINT_H
+
+#include <juce_audio_formats/juce_audio_formats.h>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "fftbackend.h"
+#include "polyphasedecimator.h"
+
+// -----------------------------------------------------------------------------
+// AcousticFingerprint: a compact description of how a recording sounds, so
+// two files of it match whatever their codec, bitrate or container.
+//
+// The audio is mixed to mono and decimated by the smallest whole factor that
+// gets it to TargetRate or below (5512.5 Hz from 44.1 kHz, 5333 Hz from 48
+// and 96 kHz). Frames span FrameSize samples of TargetRate (~0.37 s) and
+// one is taken every Hop samples of TargetRate (~46 ms), both counted in
+// time rather than samples, so files at 44.1 and 48 kHz stay in step: at a
+// lower decimated rate a frame holds fewer samples, Hann-windowed and
+// zero-padded to the FrameSize-point FftBackend transform.
+// Each frame yields one 32-bit word: the energy in 33 log-spaced bands
+// between 300 Hz and 2 kHz is differenced across
+// neighbouring bands and then across neighbouring frames, and each bit is
+// the sign of one such difference (Haitsma & Kalker's scheme). Lossy codecs
+// move band energies a little but rarely flip which of two neighbours is
+// louder, so a re-encode keeps most bits. A gain change keeps all of them.
+//
+// Two fingerprints of the same recording, aligned, differ in well under
+// SameRecordingBitErrors of their bits. Unrelated audio differs in about
+// half of them.
+//
+// Only the first MaxSeconds are taken: 60 s is about 1290 words, about 5 KB.
+// prepare() allocates; process() doesn't, but none of this is meant for the
+// audio thread.
+// -----------------------------------------------------------------------------
+class AcousticFingerprint
+{
+public:
+    using Words = std::vector<uint32_t>;
+
+    static constexpr double TargetRate = 5512.5;
+    static constexpr int FrameOrder = 11;
+    static constexpr int FrameSize = 1 << FrameOrder;   // 2048 samples of TargetRate
+    static constexpr int Hop = 256;
+    static constexpr int NumBands = 33;
+    static constexpr double MinHz = 300.0;
+    static constexpr double MaxHz = 2000.0;
+    static constexpr double MaxSeconds = 60.0;
+
+    // Matching: at most this fraction of bits differ over at least
+    // MinOverlapWords aligned words (~6 s).
+    static constexpr float SameRecordingBitErrors = 0.35f;
+    static constexpr int MinOverlapWords = 128;
+
+    void prepare(double sampleRate);
+
+    // Feed mono samples at the prepared rate; words collect in getWords().
+    void process(const float* samples, int numSamples);
+
+    const Words& getWords() const { return words; }
+
+    // The fingerprint of the first maxSeconds of reader's audio.
+    static Words compute(juce::AudioFormatReader& reader, double maxSeconds = MaxSeconds);
+
+    // Fraction of differing bits between a[i] and b[i + offset] where both
+    // exist; 1 if they overlap by fewer than MinOverlapWords.
+    static float bitErrorRate(const uint32_t* a, int aSize, const uint32_t* b, int bSize, int offset);
+    static float bitErrorRate(const Words& a, const Words& b, int offset)
+    {
+        return bitErrorRate(a.data(), static_cast<int>(a.size()), b.data(), static_cast<int>(b.size()), offset);
+    }
+
+    // The offset within +/- maxShift of b against a with the fewest
+    // differing bits, and that fraction.
+    struct Alignment
+    {
+        int offset = 0;
+        float bitErrors = 1.0f;
+    };
+    static Alignment align(const Words& a, const Words& b, int maxShift);
+
+private:
+    void processFrame();
+
+    PolyphaseDecimator decimator;
+    std::unique_ptr<FftBackend> fft;
+
+    std::vector<float> window;       // frameLength
+    std::vector<float> ring;         // the last frameLength decimated samples
+    std::vector<float> fftData;      // 2 * FrameSize
+    std::vector<float> decimated;
+    std::array<int, NumBands + 1> bandEdges {};   // first bin of each band, then one past the last
+    std::array<float, NumBands> previousEnergy {};
+
+    int frameLength = 0;             // FrameSize at TargetRate, at the decimated rate
+    int writeIndex = 0;              // oldest sample in ring, once it is full
+    int filled = 0;                  // samples in ring, up to frameLength
+    double hopSamples = 0.0;         // Hop at the decimated rate
+    double untilNextFrame = 0.0;
+    bool havePrevious = false;
+
+    Words words;
+};
+
+#endif // ACOUSTICFINGERPRINT_H
@@ -0,0 +1,211 @@
+#include "artstore.h"
+
+#include <QBuffer>
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageReader>
+#include <QPixmapCache>
+#include <QSaveFile>
+#include <QThread>
+
+#include <algorithm>
+
+#include "threadpolicy.h"
+#include "xxhash64.h"
+
+namespace
+{
+QString hexKey(quint64 artHash)
+{
+    return QStringLiteral("%1").arg(artHash, 16, 16, QChar(u'0'));
+}
+} // namespace
+
+ArtStore::ArtStore(QObject* parent)
+    : QObject(parent)
+{
+    // Leave the other half of the cores to the scan feeding us.
+    pool.setMaxThreadCount(std::max(1, QThread::idealThreadCount() / 2));
+}
+
+QString ArtStore::thumbnailPath(quint64 artHash, int size) const
+{
+    const QString key = hexKey(artHash);
+    return directory + u'/' + key.left(2) + u'/' + key + u'-' + QString::number(size) + QStringLiteral(".jpg");
+}
+
+quint64 ArtStore::add(const QByteArray& imageData)
+{
+    if (imageData.isEmpty())
+        return 0;
+
+    // 0 means "no art".
+    const quint64 artHash = std::max<quint64>(XxHash64::hash(imageData.constData(), size_t(imageData.size())), 1);
+
+    QMutexLocker locker(&mutex);
+    addedSinceRetain.insert(artHash);
+    if (stored.contains(artHash) || queued.contains(artHash))
+        return artHash;
+    // The largest size is written last, so it marks a complete set.
+    if (QFile::exists(thumbnailPath(artHash, Sizes[NumSizes - 1]))) {
+        stored.insert(artHash);
+        return artHash;
+    }
+
+    queued.insert(artHash);
+    unavailable.remove(artHash);
+    if (pendingBytes + imageData.size() > PendingBudget) {
+        locker.unlock();
+        finish(artHash, 0, makeThumbnails(artHash, imageData));
+        return artHash;
+    }
+    pendingBytes += imageData.size();
+    locker.unlock();
+
+    pool.start([this, artHash, imageData] {
+        ThreadPolicy::applyIfChanged(ThreadPolicy::Role::Background);
+        finish(artHash, imageData.size(), makeThumbnails(artHash, imageData));
+    });
+    return artHash;
+}
+
+quint64 ArtStore::addFile(const QString& filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "ArtStore: can't read" << filePath;
+        return 0;
+    }
+    return add(file.readAll());
+}
+
+void ArtStore::finish(quint64 artHash, qsizetype queuedBytes, bool madeThumbnails)
+{
+    {
+        QMutexLocker locker(&mutex);
+        queued.remove(artHash);
+        pendingBytes -= queuedBytes;
+        if (madeThumbnails)
+            stored.insert(artHash);
+        else
+            unavailable.insert(artHash);
+    }
+    if (madeThumbnails)
+        emit thumbnailsReady(artHash);
+}
+
+bool ArtStore::makeThumbnails(quint64 artHash, const QByteArray& imageData) const
+{
+    QBuffer buffer;
+    buffer.setData(imageData);
+    buffer.open(QIODevice::ReadOnly);
+
+    QImageReader reader(&buffer);
+    reader.setAutoTransform(true);
+
+    // Fitting a square doesn't care about EXIF rotation, so the decoder can
+    // scale before it is applied.
+    const int largest = Sizes[NumSizes - 1];
+    const QSize original = reader.size();
+    if (original.isValid() && (original.width() > largest || original.height() > largest))
+        reader.setScaledSize(original.scaled(largest, largest, Qt::KeepAspectRatio));
+
+    QImage image = reader.read();
+    if (image.isNull()) {
+        qWarning() << "ArtStore: unreadable picture" << hexKey(artHash) << reader.errorString();
+        return false;
+    }
+    image = image.convertToFormat(QImage::Format_RGB32);
+
+    const QString first = thumbnailPath(artHash, Sizes[0]);
+    if (!QDir().mkpath(QFileInfo(first).absolutePath())) {
+        qWarning() << "ArtStore: can't create" << QFileInfo(first).absolutePath();
+        return false;
+    }
+
+    for (const int size : Sizes) {
+        const QImage thumbnail = image.width() > size || image.height() > size
+                                     ? image.scaled(size, size, Qt::KeepAspectRatio, Qt::SmoothTransformation)
+                                     : image;
+        QSaveFile file(thumbnailPath(artHash, size));
+        if (!file.open(QIODevice::WriteOnly) || !thumbnail.save(&file, "JPG", JpegQuality) || !file.commit()) {
+            qWarning() << "ArtStore: failed to write" << file.fileName();
+            return false;
+        }
+    }
+    return true;
+}
+
+QPixmap ArtStore::thumbnail(quint64 artHash, int size)
+{
+    if (artHash == 0)
+        return {};
+
+    const int* fit = std::lower_bound(Sizes, Sizes + NumSizes, size);
+    const int storedSize = fit != Sizes + NumSizes ? *fit : Sizes[NumSizes - 1];
+
+    const QString cacheKey = QStringLiteral("art:") + hexKey(artHash) + u':' + QString::number(storedSize);
+    QPixmap pixmap;
+    if (QPixmapCache::find(cacheKey, &pixmap))
+        return pixmap;
+
+    {
+        // Thumbnails made in an earlier run are found on disk, once.
+        QMutexLocker locker(&mutex);
+        if (!stored.contains(artHash)) {
+            if (queued.contains(artHash) || unavailable.contains(artHash))
+                return {};
+            if (!QFile::exists(thumbnailPath(artHash, Sizes[NumSizes - 1]))) {
+                unavailable.insert(artHash);
+                return {};
+            }
+            stored.insert(artHash);
+        }
+    }
+
+    if (!pixmap.load(thumbnailPath(artHash, storedSize)))
+        return {};
+    QPixmapCache::insert(cacheKey, pixmap);
+    return pixmap;
+}
+
+void ArtStore::retainOnly(const QSet<quint64>& artHashes)
+{
+    if (directory.isEmpty())
+        return;
+
+    const QString dirPath = directory;
+    pool.start([this, artHashes, dirPath] {
+        ThreadPolicy::applyIfChanged(ThreadPolicy::Role::Background);
+
+        int removed = 0;
+        QDirIterator it(dirPath, { QStringLiteral("*.jpg") }, QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            const QString filePath = it.next();
+            bool ok = false;
+            const quint64 artHash = it.fileName().left(16).toULongLong(&ok, 16);
+            if (!ok || artHashes.contains(artHash))
+                continue;
+
+            {
+                QMutexLocker locker(&mutex);
+                if (addedSinceRetain.contains(artHash) || queued.contains(artHash))
+                    continue;
+                stored.remove(artHash);
+            }
+            if (QFile::remove(filePath))
+                ++removed;
+        }
+
+        {
+            QMutexLocker locker(&mutex);
+            addedSinceRetain.clear();
+        }
+        if (removed > 0)
+            qDebug() << "ArtStore: removed" << removed << "unused thumbnails";
+    });
+}
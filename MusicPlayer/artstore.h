@@ -0,0 +1,92 @@
+#ifndef ARTSTORE_H
+#define ARTSTORE_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <QObject>
+#include <QPixmap>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+
+// -----------------------------------------------------------------------------
+// ArtStore: cover art, once per distinct picture and only as thumbnails.
+//
+// A picture is keyed by the XXH64 of its bytes (as embedded or downloaded),
+// so the tracks of an album that all carry the same cover share one entry,
+// and a Track only holds the 64-bit key (artHash). add() hashes the bytes
+// and hands the picture to a worker pool, which stores it at 64, 128 and
+// 512 px (the longer side; JPEG, under <directory>/<first two hex digits>/).
+// The original isn't kept: it stays in the audio file or the downloaded
+// cover it came from. Large JPEGs are scaled down as they are decoded, so
+// even a big cover costs little to reduce.
+//
+// Pictures waiting for the pool are held in memory; past PendingBudget
+// bytes of them, add() makes the thumbnails on the calling thread instead,
+// slowing the scan rather than letting queued pictures pile up. That also
+// bounds waitForDone() at quit.
+//
+// thumbnail() is for painting: it loads the smallest stored size that
+// covers the request, never the original, and keeps it in QPixmapCache. It
+// returns a null pixmap until the thumbnails are stored (thumbnailsReady).
+//
+// add() may be called from any thread (the scanner's, while extracting);
+// thumbnail() and retainOnly() run on the GUI thread.
+// -----------------------------------------------------------------------------
+class ArtStore : public QObject
+{
+    Q_OBJECT
+public:
+    static constexpr int Sizes[] = { 64, 128, 512 };
+    static constexpr int NumSizes = int(sizeof(Sizes) / sizeof(Sizes[0]));
+    static constexpr qsizetype PendingBudget = 64 * 1024 * 1024;
+    static constexpr int JpegQuality = 85;
+
+    explicit ArtStore(QObject* parent = nullptr);
+
+    // Where thumbnails are stored; set before the first add().
+    void setDirectory(const QString& dirPath) { directory = dirPath; }
+
+    // Key of the picture in imageData (JPEG, PNG, ...), queueing its
+    // thumbnails unless they are stored already; 0 if imageData is empty.
+    quint64 add(const QByteArray& imageData);
+    // Same, reading the picture from a file; 0 if it can't be read.
+    quint64 addFile(const QString& filePath);
+
+    // The stored thumbnail at least size px across (or the largest), or a
+    // null pixmap if there is none yet.
+    QPixmap thumbnail(quint64 artHash, int size);
+
+    // Delete, in the background, the thumbnails of every picture not in
+    // artHashes. Pictures added since the last sweep are kept either way:
+    // their tracks may not have reached the caller yet.
+    void retainOnly(const QSet<quint64>& artHashes);
+
+    // Block until the queued thumbnails are stored.
+    void waitForDone() { pool.waitForDone(); }
+
+    QString thumbnailPath(quint64 artHash, int size) const;
+
+signals:
+    // add()'s thumbnails are stored; emitted on the thread that made them.
+    void thumbnailsReady(quint64 artHash);
+
+private:
+    bool makeThumbnails(quint64 artHash, const QByteArray& imageData) const;
+    void finish(quint64 artHash, qsizetype queuedBytes, bool madeThumbnails);
+
+    QString directory;
+
+    QMutex mutex;
+    QSet<quint64> stored;          // thumbnails on disk
+    QSet<quint64> queued;          // or on their way
+    QSet<quint64> unavailable;     // looked for by thumbnail() and not there
+    QSet<quint64> addedSinceRetain;
+    qsizetype pendingBytes = 0;
+
+    // Declared last so it is destroyed first, waiting for thumbnails in
+    // flight while the rest of the object is still there.
+    QThreadPool pool;
+};
+
+#endif // ARTSTORE_H
@@ -0,0 +1,99 @@
+#include "audiochain.h"
+
+#include <cmath>
+
+AudioChain::AudioChain()
+    : controller(transportSource),
+    timeStretch(&controller),
+    dspChain(&timeStretch),
+    capturingSource(&dspChain, analyzer)
+{
+}
+
+AudioChain::~AudioChain()
+{
+    // Detaching the source also stops the transport. stop() itself would wait
+    // for an audio callback that may never come.
+    transportSource.setSource(nullptr);
+    timeStretch.setSource(nullptr);
+    dspChain.setSource(nullptr);
+    capturingSource.setSource(nullptr);
+}
+
+void AudioChain::setSource(juce::PositionableAudioSource* source, double sourceSampleRate)
+{
+    // The resampler may only be rewired while nothing pulls from it, so take
+    // it away from the transport first.
+    transportSource.setSource(nullptr);
+    resampler.setSource(source, sourceSampleRate);
+
+    // The resampler already delivers the device rate: no read-ahead buffering
+    // and no rate correction in the transport.
+    if (source != nullptr)
+        transportSource.setSource(&resampler);
+
+    // Don't let the tail of the previous track come out of the stretcher, and
+    // drop fades or seeks that were meant for it.
+    timeStretch.requestReset();
+    controller.reset();
+
+    // Connect capturing source to the end of the effect chain.
+    capturingSource.setSource(source != nullptr ? &dspChain : nullptr);
+}
+
+double AudioChain::getPosition() const
+{
+    const double pending = controller.getPendingPosition();
+    if (pending >= 0.0)
+        return pending;
+
+    // Before the first block (or with no device at all) there is nothing to
+    // extrapolate from.
+    if (!clock.hasTimestamp())
+        return transportSource.getCurrentPosition();
+
+    return clock.getPositionSeconds();
+}
+
+// publishClock(): Audio thread, right after a block went through the chain.
+void AudioChain::publishClock(juce::int64 blockStartTicks, int numSamples, double sampleRate)
+{
+    // The transport runs ahead of the output by whatever the stretcher holds.
+    const double nextSample = static_cast<double>(transportSource.getNextReadPosition())
+                              - timeStretch.getBufferedTrackSamples();
+
+    // That sample follows this block out of the device, after its latency.
+    const double secondsUntilHeard = (numSamples + outputLatency.load(std::memory_order_relaxed)) / sampleRate;
+
+    PlaybackClock::Timestamp stamp;
+    stamp.samplePosition = juce::jmax<juce::int64>(0, std::llround(nextSample));
+    stamp.hostTicks      = blockStartTicks + juce::Time::secondsToHighResolutionTicks(secondsUntilHeard);
+    stamp.sampleRate     = sampleRate;
+    stamp.rate           = controller.isPulling() ? sampleRate * timeStretch.getSpeed() : 0.0;
+    stamp.blockSamples   = numSamples;
+    clock.publish(stamp);
+}
+
+//============================================================================
+// ClockedOutput
+
+void AudioChain::ClockedOutput::prepareToPlay(int samplesPerBlockExpected, double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    owner.capturingSource.prepareToPlay(samplesPerBlockExpected, newSampleRate);
+}
+
+void AudioChain::ClockedOutput::releaseResources()
+{
+    owner.capturingSource.releaseResources();
+}
+
+void AudioChain::ClockedOutput::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    const juce::int64 blockStart = juce::Time::getHighResolutionTicks();
+
+    owner.capturingSource.getNextAudioBlock(bufferToFill);
+
+    if (sampleRate > 0.0 && bufferToFill.numSamples > 0)
+        owner.publishClock(blockStart, bufferToFill.numSamples, sampleRate);
+}
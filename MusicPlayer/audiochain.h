@@ -0,0 +1,102 @@
+#ifndef AUDIOCHAIN_H
+#define AUDIOCHAIN_H
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_audio_devices/juce_audio_devices.h>
+
+#include <atomic>
+
+#include "capturingaudiosource.h"
+#include "dspchain.h"
+#include "playbackclock.h"
+#include "resamplersource.h"
+#include "spectrumanalyzer.h"
+#include "timestretchsource.h"
+#include "transportcontroller.h"
+
+// -----------------------------------------------------------------------------
+// AudioChain: the processing path every track goes through, from the file
+// source to the capture/analysis stage:
+//
+//     source -> resampler -> transportSource -> controller -> timeStretch
+//            -> dspChain -> capturingSource -> (device or renderer)
+//
+// The resampler brings the file to the device rate before the transport, so
+// everything from the transport on runs at the rate that is actually played.
+// The time stretch comes after the transport so positions stay in track time
+// while the analyzer sees the audio at the speed it is heard. Play, pause and
+// seek go through the controller, which applies them on the audio thread.
+// After every block the output stage publishes a PlaybackClock timestamp, so
+// the position can be read at any time without touching the transport.
+// AudioPlayback drives it from the sound card; the headless renderer pulls
+// blocks from getOutput() directly, so both hear exactly the same thing.
+// No Qt and no platform code in here.
+// -----------------------------------------------------------------------------
+class AudioChain
+{
+public:
+    AudioChain();
+    ~AudioChain();
+
+    // Point the transport at a source (not owned). Pass nullptr to detach.
+    void setSource(juce::PositionableAudioSource* source, double sourceSampleRate);
+
+    juce::AudioTransportSource& getTransport() { return transportSource; }
+    TransportController& getController() { return controller; }
+    const TransportController& getController() const { return controller; }
+    ResamplerSource& getResampler() { return resampler; }
+    const ResamplerSource& getResampler() const { return resampler; }
+    SpectrumAnalyzer& getAnalyzer() { return analyzer; }
+    const SpectrumAnalyzer& getAnalyzer() const { return analyzer; }
+    CapturingAudioSource& getCapture() { return capturingSource; }
+    TimeStretchSource& getTimeStretch() { return timeStretch; }
+    const TimeStretchSource& getTimeStretch() const { return timeStretch; }
+    DspChainSource& getDsp() { return dspChain; }
+    const DspChainSource& getDsp() const { return dspChain; }
+
+    // Last stage of the chain: whatever consumes audio pulls from here.
+    juce::AudioSource& getOutput() { return output; }
+
+    // Where playback is, as of the last block that was pulled.
+    const PlaybackClock& getClock() const { return clock; }
+
+    // Playback position in seconds: a seek still waiting for the audio thread,
+    // otherwise the clock extrapolated to now. Any thread.
+    double getPosition() const;
+
+    // Samples (at the output rate) between the end of the chain and the
+    // speaker, so the clock describes what is heard, not what was rendered.
+    void setOutputLatency(int samples) { outputLatency.store(samples, std::memory_order_relaxed); }
+
+private:
+    // Pulls the capture stage, then publishes the clock for that block.
+    class ClockedOutput : public juce::AudioSource
+    {
+    public:
+        explicit ClockedOutput(AudioChain& chainToClock) : owner(chainToClock) { }
+
+        void prepareToPlay(int samplesPerBlockExpected, double newSampleRate) override;
+        void releaseResources() override;
+        void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    private:
+        AudioChain& owner;
+        double sampleRate = 0.0;
+    };
+
+    void publishClock(juce::int64 blockStartTicks, int numSamples, double sampleRate);
+
+    ResamplerSource resampler;                  // must outlive the transport
+    juce::AudioTransportSource transportSource;
+    TransportController controller;
+    TimeStretchSource timeStretch;
+    DspChainSource dspChain;
+    SpectrumAnalyzer analyzer;
+    CapturingAudioSource capturingSource;
+    ClockedOutput output { *this };
+
+    PlaybackClock clock;
+    std::atomic<int> outputLatency { 0 };
+};
+
+#endif // AUDIOCHAIN_H
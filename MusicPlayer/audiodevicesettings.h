@@ -0,0 +1,39 @@
+#ifndef AUDIODEVICESETTINGS_H
+#define AUDIODEVICESETTINGS_H
+
+#include <QSettings>
+#include <QString>
+
+// -----------------------------------------------------------------------------
+// AudioDeviceSettings: the output device configuration persisted in QSettings
+// under "audio/". Empty / zero fields mean "use the device default".
+// -----------------------------------------------------------------------------
+struct AudioDeviceSettings
+{
+    QString deviceType;      // e.g. "Windows Audio", "ASIO", "ALSA"
+    QString outputDevice;
+    int bufferSize = 0;      // samples
+    double sampleRate = 0.0; // Hz
+
+    static AudioDeviceSettings load()
+    {
+        QSettings settings("FractalWave", "FractalWave");
+        AudioDeviceSettings s;
+        s.deviceType   = settings.value("audio/deviceType", "").toString();
+        s.outputDevice = settings.value("audio/outputDevice", "").toString();
+        s.bufferSize   = settings.value("audio/bufferSize", 0).toInt();
+        s.sampleRate   = settings.value("audio/sampleRate", 0.0).toDouble();
+        return s;
+    }
+
+    void save() const
+    {
+        QSettings settings("FractalWave", "FractalWave");
+        settings.setValue("audio/deviceType", deviceType);
+        settings.setValue("audio/outputDevice", outputDevice);
+        settings.setValue("audio/bufferSize", bufferSize);
+        settings.setValue("audio/sampleRate", sampleRate);
+    }
+};
+
+#endif // AUDIODEVICESETTINGS_H
@@ -1,110 +1,391 @@
 #include "audioplayback.h"
+#include "threadpolicysettings.h"
+#include <QSettings>
+#include <QMetaObject>
 #include <cmath>
 #include <algorithm>
 #include <cstring>
 
+// StateEventPump: sleeps until the transport controller posts an event from
+// the audio thread, then forwards it to the Qt thread. Posting a Qt event
+// allocates and locks, which the audio thread must not do itself. A
+// background thread: it only hands events on, and stays off the audio core.
+class AudioPlayback::StateEventPump : public juce::Thread
+{
+public:
+    explicit StateEventPump(AudioPlayback& ownerPlayback)
+        : juce::Thread("PlaybackStateEvents"), owner(ownerPlayback)
+    {
+        startThread();
+    }
+
+    ~StateEventPump() override
+    {
+        signalThreadShouldExit();
+        owner.chain.getController().wakeEventReader();
+        stopThread(1000);
+    }
+
+    void run() override
+    {
+        TransportController& controller = owner.chain.getController();
+
+        while (!threadShouldExit())
+        {
+            ThreadPolicy::applyIfChanged(ThreadPolicy::Role::Background);
+            controller.waitForEvents(-1);
+
+            TransportController::Event event;
+            while (controller.popEvent(event))
+            {
+                AudioPlayback* playback = &owner;
+                QMetaObject::invokeMethod(&owner.loadContext, [playback, event]() {
+                    playback->deliverTransportEvent(event);
+                }, Qt::QueuedConnection);
+            }
+        }
+    }
+
+private:
+    AudioPlayback& owner;
+};
+
 // Constructor: initializes audio device and registers callbacks.
 AudioPlayback::AudioPlayback()
-    : fft(fftOrder),
-    fftData(fftSize * 2, 0.0f),  // FFT requires an array of size 2*fftSize.
-    fftWindow(fftSize, 0.0f),
-    sampleBuffer(fftSize),
-    frequencyBands{},
-    capturingSource(&transportSource, sampleBuffer, this)  // Initially wrap transportSource.
+    : transportSource(chain.getTransport())
 {
+    // Analyse only while the visualizer is embedded, and hand it every new set
+    // of band levels.
+    chain.getCapture().shouldAnalyse = [] { return UnityPage::isUnityEmbedded(); };
+    chain.getCapture().onBandsReady = [this](const SpectrumAnalyzer::BandLevels& bands) {
+        transferFreqData(bands);
+        bandSharedMemory.writeFrequencyBands(bands);
+    };
+    chain.getCapture().onSeparationReady = [this](const SpectrumAnalyzer::Separation& separation) {
+        bandSharedMemory.writeSeparation(separation);
+    };
+
+    // Effect settings from the last session.
+    DspSettings::load(chain.getDsp().getParameters());
+
+    // Thread scheduling. The device's own thread applies it to itself when
+    // it starts, and reports what it got.
+    ThreadPolicy::setCurrent(ThreadPolicySettings::load());
+    telemetry.onAudioThreadStart = [this] {
+        const ThreadPolicy::Report report = ThreadPolicy::applyToCurrentThread(ThreadPolicy::Role::Audio,
+                                                                               ThreadPolicy::getCurrent());
+        const juce::SpinLock::ScopedLockType lock(audioThreadReportLock);
+        audioThreadReport = report;
+    };
+
     // Initialise the device manager: no input channels, 2 output channels.
     deviceManager.initialise(0, 2, nullptr, true);
 
-    // Set up the AudioSourcePlayer so that it pulls audio from transportSource.
-    deviceManager.addAudioCallback(&audioSourcePlayer);
-    audioSourcePlayer.setSource(&capturingSource);
+    // Reopen with the configuration saved from the settings page, if any.
+    QString deviceError;
+    if (!applyDeviceSettings(AudioDeviceSettings::load(), deviceError))
+        qDebug() << "Saved audio device settings could not be applied:" << deviceError;
+
+    // Set up the AudioSourcePlayer so that it pulls audio from the end of the chain.
+    // The device calls it through the telemetry wrapper, which times every callback.
+    deviceManager.addAudioCallback(&telemetry);
+    audioSourcePlayer.setSource(&chain.getOutput());
 
     // Register basic audio file formats (WAV, AIFF, MP3, etc.).
     formatManager.registerBasicFormats();
 
-    // Initialize Hann window for FFT.
-    for (int i = 0; i < fftSize; ++i)
-        fftWindow[i] = 0.5f * (1.0f - std::cos(2.0f * juce::MathConstants<float>::pi * i / (fftSize - 1)));
+    QSettings settings("FractalWave", "FractalWave");
+
+    // Resampling tier for tracks that don't match the device rate.
+    const int quality = settings.value("audio/resamplerQuality", static_cast<int>(ResamplerSource::SincFast)).toInt();
+    if (quality >= 0 && quality < ResamplerSource::NumQualities)
+        chain.getResampler().setQuality(static_cast<ResamplerSource::Quality>(quality));
+
+    // Band analysis for the visualizer.
+    const int analysisMode = settings.value("analysis/mode", static_cast<int>(SpectrumAnalyzer::Fft)).toInt();
+    if (analysisMode >= 0 && analysisMode < SpectrumAnalyzer::NumModes)
+        chain.getAnalyzer().setMode(static_cast<SpectrumAnalyzer::Mode>(analysisMode));
+    chain.getAnalyzer().setSeparationEnabled(settings.value("analysis/separation", false).toBool());
+
+    // Memory budget for decoded tracks kept around for instant switching.
+    const qulonglong budgetMB = settings.value("decodedCacheBudgetMB", 512).toULongLong();
+    DecodedAudioCache::instance().setBudgetBytes(static_cast<size_t>(budgetMB) * 1024u * 1024u);
+
+    // Start listening for state changes from the audio thread.
+    stateEventPump = std::make_unique<StateEventPump>(*this);
 }
 
 // Destructor: cleans up and disconnects callbacks.
 AudioPlayback::~AudioPlayback()
 {
+    // No more state events; queued ones are dropped along with loadContext.
+    stateEventPump.reset();
+
+    // Supersede and wait out any async load so no job touches us after this.
+    ++loadGeneration;
+    loadPool.removeAllJobs(true, -1);
+
     // Disconnect the audio callback.
     audioSourcePlayer.setSource(nullptr);
-    deviceManager.removeAudioCallback(&audioSourcePlayer);
-
-    // Stop playback and release the audio source.
-    transportSource.stop();
-    transportSource.setSource(nullptr);
+    deviceManager.removeAudioCallback(&telemetry);
 
-    capturingSource.setSource(nullptr);
+    // Release the audio source; detaching it also stops the transport.
+    chain.setSource(nullptr, 0.0);
 }
 
 // loadFile(): Attempts to load an audio file.
 // Returns true if the file is successfully loaded.
 bool AudioPlayback::loadFile(const QString filePath)
 {
-    currentTrackPath = filePath;
+    double sampleRate = 0.0;
+    std::unique_ptr<juce::PositionableAudioSource> newSource = openSource(filePath, sampleRate);
+    if (newSource == nullptr)
+    {
+        // File could not be opened.
+        notifyState(StateEvent::Error, filePath);
+        return false;
+    }
 
+    installSource(std::move(newSource), sampleRate, filePath);
+    return true;
+}
+
+// openSource(): Builds a positionable source for filePath without touching the
+// transport, so it can run off the Qt thread.
+std::unique_ptr<juce::PositionableAudioSource> AudioPlayback::openSource(const QString& filePath,
+                                                                         double& sampleRateOut)
+{
     // Convert the QString file path to a JUCE File.
     const juce::File juceFile(filePath.toStdString());
 
+    // Prefer a decoded copy from the cache: no file I/O and no decoder start-up.
+    if (auto cached = DecodedAudioCache::instance().find(juceFile.getFullPathName()))
+    {
+        sampleRateOut = cached->sampleRate;
+        return std::make_unique<CachedAudioSource>(std::move(cached));
+    }
+
     // Create a reader for the file using the format manager.
     std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(juceFile));
     if (reader == nullptr)
-        return false; // File could not be opened.
+        return nullptr;
 
-    // Create a reader source that will stream the file.
-    // The 'true' flag makes the reader source take ownership of the reader.
-    readerSource.reset(new juce::AudioFormatReaderSource(reader.release(), true));
+    // Decode it in the background so the next visit comes from memory; this
+    // one plays whatever the decode has reached from memory as well.
+    DecodedAudioCache::TrackPtr decoding = DecodedAudioCache::instance().prefetch(juceFile.getFullPathName());
+
+    // Stream the rest of the file; the source takes ownership of the reader.
+    sampleRateOut = reader->sampleRate;
+    return std::make_unique<DecodingAudioSource>(reader.release(), std::move(decoding));
+}
 
-    // Set the transport source to use the reader source.
-    // The second parameter (bufferSizeInSamples) is 0 (default buffering),
-    // and we use the sample rate from the file.
-    transportSource.setSource(readerSource.get(), 0, nullptr,
-                              readerSource->getAudioFormatReader()->sampleRate);
+// installSource(): Hands a freshly opened source to the transport.
+void AudioPlayback::installSource(std::unique_ptr<juce::PositionableAudioSource> newSource,
+                                  double sampleRate, const QString& filePath)
+{
+    // Point the chain at the new source before releasing the old one.
+    chain.setSource(newSource.get(), sampleRate);
+    currentSource = std::move(newSource);
+    currentSourceSampleRate = sampleRate;
+    currentTrackPath = filePath;
 
-    // Connect capturing source to the transportSource.
-    capturingSource.setSource(&transportSource);
+    notifyState(StateEvent::Loaded, filePath);
+}
 
-    return true;
+//============================================================================
+// Asynchronous loading
+
+// PendingLoad: everything one async request carries between threads. If the
+// request is dropped before settling (superseded, or the result event was
+// discarded) the future still resolves, to false.
+struct AudioPlayback::PendingLoad
+{
+    uint64_t generation = 0;
+    QString filePath;
+    bool startPlayback = false;
+    std::function<void(bool)> onFinished;
+
+    std::unique_ptr<juce::PositionableAudioSource> source;
+    double sampleRate = 0.0;
+
+    std::promise<bool> promise;
+    bool settled = false;
+
+    void settle(bool result)
+    {
+        if (settled)
+            return;
+        settled = true;
+        promise.set_value(result);
+        if (onFinished)
+            onFinished(result);
+    }
+
+    ~PendingLoad()
+    {
+        if (!settled)
+            promise.set_value(false);
+    }
+};
+
+// AsyncLoadJob: opens the file on the load thread, then posts the result to
+// the Qt thread where the transport is rewired.
+class AudioPlayback::AsyncLoadJob : public juce::ThreadPoolJob
+{
+public:
+    AsyncLoadJob(AudioPlayback& ownerPlayback, std::shared_ptr<PendingLoad> loadToRun)
+        : juce::ThreadPoolJob("AsyncLoadJob"), owner(ownerPlayback), load(std::move(loadToRun)) { }
+
+    JobStatus runJob() override
+    {
+        // Superseded before we even started.
+        if (shouldExit() || load->generation != owner.loadGeneration.load())
+            return jobHasFinished;
+
+        ThreadPolicy::applyIfChanged(ThreadPolicy::Role::Background);
+        load->source = owner.openSource(load->filePath, load->sampleRate);
+
+        if (shouldExit() || load->generation != owner.loadGeneration.load())
+            return jobHasFinished;
+
+        AudioPlayback* playback = &owner;
+        std::shared_ptr<PendingLoad> result = load;
+        QMetaObject::invokeMethod(&owner.loadContext, [playback, result]() {
+            playback->finishAsyncLoad(*result);
+        }, Qt::QueuedConnection);
+
+        return jobHasFinished;
+    }
+
+private:
+    AudioPlayback& owner;
+    std::shared_ptr<PendingLoad> load;
+};
+
+std::shared_future<bool> AudioPlayback::loadFileAsync(const QString& filePath,
+                                                      std::function<void(bool)> onFinished)
+{
+    return startAsyncLoad(filePath, false, std::move(onFinished));
+}
+
+std::shared_future<bool> AudioPlayback::replaceTrackAsync(const QString& filePath,
+                                                          std::function<void(bool)> onFinished)
+{
+    return startAsyncLoad(filePath, true, std::move(onFinished));
+}
+
+std::shared_future<bool> AudioPlayback::startAsyncLoad(const QString& filePath, bool startPlayback,
+                                                       std::function<void(bool)> onFinished)
+{
+    auto load = std::make_shared<PendingLoad>();
+    load->generation    = ++loadGeneration;
+    load->filePath      = filePath;
+    load->startPlayback = startPlayback;
+    load->onFinished    = std::move(onFinished);
+    std::shared_future<bool> future = load->promise.get_future().share();
+
+    pendingTrackPath = filePath;
+
+    // Drop queued requests and ask a running one to bail out; it also checks
+    // the generation, so we never wait for it here.
+    loadPool.removeAllJobs(true, 0);
+    loadPool.addJob(new AsyncLoadJob(*this, std::move(load)), true);
+
+    return future;
+}
+
+// finishAsyncLoad(): Runs on the Qt thread. Installs the result unless a newer
+// request arrived while it was in flight.
+void AudioPlayback::finishAsyncLoad(PendingLoad& load)
+{
+    if (load.generation != loadGeneration.load())
+    {
+        load.settle(false);
+        return;
+    }
+
+    pendingTrackPath.clear();
+
+    if (load.source == nullptr)
+    {
+        qDebug() << "Async load failed:" << load.filePath;
+        notifyState(StateEvent::Error, load.filePath);
+        load.settle(false);
+        return;
+    }
+
+    if (load.startPlayback)
+        unloadFile();
+
+    installSource(std::move(load.source), load.sampleRate, load.filePath);
+
+    if (load.startPlayback)
+        play();
+
+    load.settle(true);
+}
+
+//============================================================================
+// State events
+
+// deliverTransportEvent(): Qt thread. Turns an audio-thread event into a state
+// notification, unless it was meant for a track that has since been replaced.
+void AudioPlayback::deliverTransportEvent(const TransportController::Event& event)
+{
+    if (event.sourceSerial != chain.getController().getSourceSerial())
+        return;
+
+    switch (event.type)
+    {
+        case TransportController::Event::Started: notifyState(StateEvent::Started, currentTrackPath); break;
+        case TransportController::Event::Paused:  notifyState(StateEvent::Paused, currentTrackPath);  break;
+        case TransportController::Event::Ended:   notifyState(StateEvent::Ended, currentTrackPath);   break;
+    }
+}
+
+void AudioPlayback::notifyState(StateEvent::Type type, const QString& trackPath)
+{
+    if (stateListener)
+        stateListener({ type, trackPath });
 }
 
 // unloadFile(): Unloads the currently loaded track.
 void AudioPlayback::unloadFile()
 {
-    // Stop playback if needed.
-    transportSource.stop();
-    // Unlink the current source.
-    transportSource.setSource(nullptr);
-    capturingSource.setSource(nullptr);
+    // Unlink the current source. This also stops the transport; stop() itself
+    // would wait for a callback that never comes while playback is paused.
+    chain.setSource(nullptr, 0.0);
 
-    // Delete the reader source.
-    readerSource.reset();
+    // Delete the current source.
+    currentSource.reset();
+    currentSourceSampleRate = 0.0;
     // Clear the current track path.
     currentTrackPath.clear();
 }
 
-// play(): Starts playback by resetting position and starting the transport.
+// play(), stop(), togglePause() and seek() only post commands: the audio
+// thread carries them out at its next block with a short fade, so the UI never
+// waits on the transport's callback lock and nothing clicks.
+
+// play(): Starts (or resumes) playback.
 void AudioPlayback::play()
 {
-    transportSource.start();
+    chain.getController().play();
 }
 
-// stop(): Stops audio playback.
+// stop(): Pauses audio playback.
 void AudioPlayback::stop()
 {
-    transportSource.stop();
+    chain.getController().pause();
 }
 
 // togglePause(): If playing, stop (pause); if paused, start (resume).
 void AudioPlayback::togglePause()
 {
-    if (transportSource.isPlaying())
-        transportSource.stop();
+    if (isPlaying())
+        stop();
     else
-        transportSource.start();
+        play();
 }
 
 // replaceTrack(): Unloads the current track, loads a new track, and starts playback.
@@ -130,86 +411,199 @@ QString& AudioPlayback::getCurrentTrackPath()
 
 void AudioPlayback::seek(double newPosition)
 {
-    // Set the transport source position.
-    transportSource.setPosition(newPosition);
+    // Fades out, moves the transport and fades back in on the audio thread.
+    // The fade runs through the time stretcher, so it needs no flush.
+    chain.getController().seek(newPosition);
 }
 
 bool AudioPlayback::hasAudioLoaded()
 {
-    return readerSource != nullptr;
+    return currentSource != nullptr;
 }
 
-//============================================================================
-// performFFT: Captures fftSize samples from sampleBuffer, applies windowing,
-// performs an FFT, and analyzes frequency bands.
-void AudioPlayback::performFFT()
+void AudioPlayback::prefetchTrack(const QString& filePath)
 {
-    std::vector<float> fftInput;
-    sampleBuffer.getBuffer(fftInput);
+    if (filePath.isEmpty())
+        return;
 
-    if (fftInput.size() < static_cast<size_t>(fftSize))
+    const juce::File juceFile(filePath.toStdString());
+    DecodedAudioCache::instance().prefetch(juceFile.getFullPathName());
+}
+
+//============================================================================
+// Audio device configuration
+
+bool AudioPlayback::applyDeviceSettings(const AudioDeviceSettings& settings, QString& errorOut)
+{
+    if (!settings.deviceType.isEmpty()
+        && juce::String(settings.deviceType.toStdString()) != deviceManager.getCurrentAudioDeviceType())
     {
-        juce::Logger::writeToLog("Not enough samples in circular buffer: " + juce::String(fftInput.size()));
-        return;
+        deviceManager.setCurrentAudioDeviceType(settings.deviceType.toStdString(), true);
     }
 
-    // Ensure we only process exactly fftSize samples.
-    fftInput.resize(fftSize);
+    juce::AudioDeviceManager::AudioDeviceSetup setup = deviceManager.getAudioDeviceSetup();
+    if (!settings.outputDevice.isEmpty())
+        setup.outputDeviceName = settings.outputDevice.toStdString();
+    if (settings.bufferSize > 0)
+        setup.bufferSize = settings.bufferSize;
+    if (settings.sampleRate > 0.0)
+        setup.sampleRate = settings.sampleRate;
+
+    const juce::String error = deviceManager.setAudioDeviceSetup(setup, true);
 
-    // Clear fftData.
-    std::fill(fftData.begin(), fftData.end(), 0.0f);
+    // Old numbers describe the old configuration.
+    telemetry.reset();
 
-    // Copy fftInput samples into fftData (interleaved real-imaginary).
-    for (int i = 0; i < fftSize; ++i)
+    // The playback clock reports what is heard, so it needs the device latency.
+    if (auto* device = deviceManager.getCurrentAudioDevice())
+        chain.setOutputLatency(device->getOutputLatencyInSamples());
+
+    if (error.isNotEmpty())
     {
-        fftData[i * 2]     = fftInput[i] * fftWindow[i]; // apply window to real part.
-        fftData[i * 2 + 1] = 0.0f;                         // imaginary part is zero.
+        errorOut = QString::fromStdString(error.toStdString());
+        return false;
     }
+    return true;
+}
 
-    // Perform the FFT.
-    fft.performRealOnlyForwardTransform(fftData.data(), true);
+AudioDeviceSettings AudioPlayback::getActiveDeviceSettings() const
+{
+    AudioDeviceSettings active;
+    active.deviceType = QString::fromStdString(deviceManager.getCurrentAudioDeviceType().toStdString());
 
-    // Analyze frequency bands.
-    analyzeFrequencyBands();
+    if (auto* device = deviceManager.getCurrentAudioDevice())
+    {
+        active.outputDevice = QString::fromStdString(device->getName().toStdString());
+        active.bufferSize   = device->getCurrentBufferSizeSamples();
+        active.sampleRate   = device->getCurrentSampleRate();
+    }
+    return active;
 }
 
-//============================================================================
-// analyzeFrequencyBands: Processes fftData to compute average amplitudes for defined bands.
-void AudioPlayback::analyzeFrequencyBands()
+QStringList AudioPlayback::getAvailableDeviceTypes()
 {
-    std::fill(frequencyBands.begin(), frequencyBands.end(), 0.0f);
-
-    // Get sample rate from readerSource if available.
-    float sampleRate = 44100.0f;
-    if (readerSource != nullptr && readerSource->getAudioFormatReader() != nullptr)
-        sampleRate = readerSource->getAudioFormatReader()->sampleRate;
+    QStringList types;
+    for (auto* type : deviceManager.getAvailableDeviceTypes())
+        types.append(QString::fromStdString(type->getTypeName().toStdString()));
+    return types;
+}
 
-    // Convert frequency ranges (Hz) to FFT bin indices.
-    for (int band = 0; band < NumBands; ++band)
+QStringList AudioPlayback::getAvailableOutputDevices(const QString& deviceType)
+{
+    QStringList devices;
+    for (auto* type : deviceManager.getAvailableDeviceTypes())
     {
-        int startBin = juce::jlimit(0, fftSize / 2, static_cast<int>(bandRanges[band].min * fftSize / sampleRate));
-        int endBin   = juce::jlimit(0, fftSize / 2, static_cast<int>(bandRanges[band].max   * fftSize / sampleRate));
-        float sum = 0.0f;
-        for (int i = startBin; i < endBin; ++i)
-        {
-            // In a real-only FFT, the output is stored in interleaved format.
-            float re = fftData[i * 2];
-            float im = fftData[i * 2 + 1];
-            float magnitude = std::sqrt(re * re + im * im);
-            sum += magnitude;
-        }
-        if (endBin > startBin)
-            frequencyBands[band] = sum / (endBin - startBin);
-        else
-            frequencyBands[band] = 0.0f;
+        if (QString::fromStdString(type->getTypeName().toStdString()) != deviceType)
+            continue;
+
+        type->scanForDevices();
+        for (const auto& name : type->getDeviceNames(false))
+            devices.append(QString::fromStdString(name.toStdString()));
     }
+    return devices;
+}
+
+QList<int> AudioPlayback::getAvailableBufferSizes() const
+{
+    QList<int> sizes;
+    if (auto* device = deviceManager.getCurrentAudioDevice())
+        for (int size : device->getAvailableBufferSizes())
+            sizes.append(size);
+    return sizes;
+}
+
+QList<double> AudioPlayback::getAvailableSampleRates() const
+{
+    QList<double> rates;
+    if (auto* device = deviceManager.getCurrentAudioDevice())
+        for (double rate : device->getAvailableSampleRates())
+            rates.append(rate);
+    return rates;
+}
+
+void AudioPlayback::setAnalysisMode(SpectrumAnalyzer::Mode mode)
+{
+    chain.getAnalyzer().setMode(mode);
+
+    QSettings settings("FractalWave", "FractalWave");
+    settings.setValue("analysis/mode", static_cast<int>(mode));
+}
+
+void AudioPlayback::setSeparationEnabled(bool enabled)
+{
+    chain.getAnalyzer().setSeparationEnabled(enabled);
+
+    QSettings settings("FractalWave", "FractalWave");
+    settings.setValue("analysis/separation", enabled);
+}
+
+void AudioPlayback::setThreadPolicy(const ThreadPolicy::Settings& settings)
+{
+    ThreadPolicy::setCurrent(settings);
+    ThreadPolicySettings::save(settings);
+
+    // A fresh device thread picks up the new policy on its first callback.
+    deviceManager.closeAudioDevice();
+    deviceManager.restartLastAudioDevice();
+    telemetry.reset();
+
+    // Worker threads follow when they next pick up work.
+    chain.getController().wakeEventReader();
+}
+
+ThreadPolicy::Report AudioPlayback::getAudioThreadReport() const
+{
+    const juce::SpinLock::ScopedLockType lock(audioThreadReportLock);
+    return audioThreadReport;
+}
+
+void AudioPlayback::setResamplerQuality(ResamplerSource::Quality quality)
+{
+    chain.getResampler().setQuality(quality);
+
+    QSettings settings("FractalWave", "FractalWave");
+    settings.setValue("audio/resamplerQuality", static_cast<int>(quality));
+}
+
+int AudioPlayback::getDeviceXRunCount() const
+{
+    if (auto* device = deviceManager.getCurrentAudioDevice())
+        return device->getXRunCount();
+    return -1;
+}
+
+//============================================================================
+// performFFT: Runs the analyzer on the most recent captured samples.
+void AudioPlayback::performFFT()
+{
+    chain.getCapture().performFFT();
 }
 
 //============================================================================
 // getFrequencyBandLevel: Returns the computed amplitude for a given frequency band.
 float AudioPlayback::getFrequencyBandLevel(FrequencyBand band) const
 {
-    if (band >= 0 && band < NumBands)
-        return frequencyBands[band];
-    return 0.0f;
+    return chain.getAnalyzer().getFrequencyBandLevel(band);
+}
+
+//============================================================================
+// transferFreqData: Logs the first seven band levels.
+void AudioPlayback::transferFreqData(const SpectrumAnalyzer::BandLevels& bands)
+{
+    QString subBassLevelStr = QString::number(bands[SpectrumAnalyzer::Band0], 'f', 2);
+    QString bassLevelStr = QString::number(bands[SpectrumAnalyzer::Band1], 'f', 2);
+    QString lowMidLevelStr = QString::number(bands[SpectrumAnalyzer::Band2], 'f', 2);
+    QString midLevelStr = QString::number(bands[SpectrumAnalyzer::Band3], 'f', 2);
+    QString upperMidLevelStr = QString::number(bands[SpectrumAnalyzer::Band4], 'f', 2);
+    QString presenceLevelStr = QString::number(bands[SpectrumAnalyzer::Band5], 'f', 2);
+    QString brillianceLevelStr = QString::number(bands[SpectrumAnalyzer::Band6], 'f', 2);
+
+    // Log the frequency band levels.
+    qDebug() << "SubBass:" << subBassLevelStr
+             << "Bass:" << bassLevelStr
+             << "LowMid:" << lowMidLevelStr
+             << "Mid:" << midLevelStr
+             << "HighMid:" << upperMidLevelStr
+             << "Presence:" << presenceLevelStr
+             << "Treble:" << brillianceLevelStr;
 }
@@ -0,0 +1,112 @@
+#include "avmetadatareader.h"
+
+#include <QDebug>
+
+#include <memory>
+#include <mutex>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/avutil.h>
+#include <libavutil/dict.h>
+}
+
+#include "contenthasher.h"
+
+namespace
+{
+// Closes the context however read() returns.
+struct FormatContextCloser
+{
+    void operator()(AVFormatContext* context) const { avformat_close_input(&context); }
+};
+
+QString tagValue(const AVDictionary* container, const AVDictionary* stream, const char* key)
+{
+    // av_dict_get matches keys case-insensitively unless AV_DICT_MATCH_CASE.
+    for (const AVDictionary* dict : { container, stream }) {
+        if (const AVDictionaryEntry* entry = av_dict_get(dict, key, nullptr, 0)) {
+            const QString value = QString::fromUtf8(entry->value).trimmed();
+            if (!value.isEmpty())
+                return value;
+        }
+    }
+    return {};
+}
+} // namespace
+
+bool AvMetadataReader::read(const QString& filePath, Track& track, QByteArray* embeddedArt, quint64* quickHash)
+{
+    // A library scan would otherwise print every demuxer warning.
+    static std::once_flag quietLogging;
+    std::call_once(quietLogging, [] { av_log_set_level(AV_LOG_ERROR); });
+
+    AVFormatContext* opened = nullptr;
+    // libavformat takes UTF-8 paths on every platform.
+    if (avformat_open_input(&opened, filePath.toUtf8().constData(), nullptr, nullptr) < 0) {
+        qWarning() << "AvMetadataReader: can't open" << filePath;
+        return false;
+    }
+    std::unique_ptr<AVFormatContext, FormatContextCloser> context(opened);
+
+    const int audioIndex = av_find_best_stream(context.get(), AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+    AVStream* audio = audioIndex >= 0 ? context->streams[audioIndex] : nullptr;
+
+    const bool headerIsEnough = audio != nullptr
+                                && audio->codecpar->sample_rate > 0
+                                && (context->duration > 0 || audio->duration > 0);
+    if (!headerIsEnough) {
+        context->probesize = 256 * 1024;
+        context->max_analyze_duration = AV_TIME_BASE / 2;
+        if (avformat_find_stream_info(context.get(), nullptr) >= 0 && audio == nullptr) {
+            const int index = av_find_best_stream(context.get(), AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+            audio = index >= 0 ? context->streams[index] : nullptr;
+        }
+    }
+
+    const AVDictionary* streamTags = audio != nullptr ? audio->metadata : nullptr;
+    const QString title = tagValue(context->metadata, streamTags, "title");
+    if (!title.isEmpty())
+        track.title = title;
+    track.artist = tagValue(context->metadata, streamTags, "artist");
+    track.album  = tagValue(context->metadata, streamTags, "album");
+
+    if (context->duration > 0)
+        track.durationMs = context->duration / (AV_TIME_BASE / 1000);
+    else if (audio != nullptr && audio->duration > 0)
+        track.durationMs = av_rescale_q(audio->duration, audio->time_base, AVRational{ 1, 1000 });
+
+    track.bitRate = context->bit_rate > 0 ? static_cast<int>(context->bit_rate) : 0;
+
+    if (audio != nullptr) {
+        track.codec      = QString::fromUtf8(avcodec_get_name(audio->codecpar->codec_id));
+        track.sampleRate = audio->codecpar->sample_rate;
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(57, 24, 100)
+        track.channels   = audio->codecpar->ch_layout.nb_channels;
+#else
+        track.channels   = audio->codecpar->channels;
+#endif
+        if (track.bitRate == 0 && audio->codecpar->bit_rate > 0)
+            track.bitRate = static_cast<int>(audio->codecpar->bit_rate);
+    }
+
+    if (embeddedArt != nullptr) {
+        embeddedArt->clear();
+        for (unsigned int i = 0; i < context->nb_streams; ++i) {
+            const AVStream* stream = context->streams[i];
+            if ((stream->disposition & AV_DISPOSITION_ATTACHED_PIC) != 0 && stream->attached_pic.size > 0) {
+                *embeddedArt = QByteArray(reinterpret_cast<const char*>(stream->attached_pic.data),
+                                          stream->attached_pic.size);
+                break;
+            }
+        }
+    }
+
+    // Packets the stream-info probe read are buffered, so this still starts
+    // at the first one.
+    if (quickHash != nullptr)
+        *quickHash = audio != nullptr ? ContentHasher::quickHash(context.get(), audio->index) : 0;
+
+    return true;
+}
@@ -0,0 +1,39 @@
+#ifndef AVMETADATAREADER_H
+#define AVMETADATAREADER_H
+
+#include <QByteArray>
+#include <QString>
+
+#include "track.h"
+
+// -----------------------------------------------------------------------------
+// AvMetadataReader: reads a file's tags and stream info in-process with
+// libavformat, without decoding any audio.
+//
+// Opening the file runs the demuxer's header parser, which for the formats
+// the library holds (MP3 Xing/Info frames, FLAC STREAMINFO, Ogg page
+// granules, WAV chunk sizes) already yields the codec parameters and the
+// duration. Only when it doesn't is avformat_find_stream_info() run, on a
+// small probe budget.
+//
+// Tags are looked up case-insensitively on the container and then on the
+// audio stream (Ogg keeps its Vorbis comments there). Embedded cover art is
+// the attached-picture stream, as stored (JPEG or PNG).
+//
+// Every call opens its own AVFormatContext, so calls on different threads
+// don't share state and the scanner can run as many as it has threads.
+// -----------------------------------------------------------------------------
+class AvMetadataReader
+{
+public:
+    // Fills title / artist / album and the stream fields of track (filePath,
+    // title fallback and artHash are the caller's). embeddedArt, if given,
+    // receives the attached picture's bytes, or stays empty. quickHash, if
+    // given, receives ContentHasher's quick hash, read from the same context
+    // (0 if there's no audio).
+    // Returns false if libavformat couldn't open the file.
+    static bool read(const QString& filePath, Track& track, QByteArray* embeddedArt = nullptr,
+                     quint64* quickHash = nullptr);
+};
+
+#endif // AVMETADATAREADER_H
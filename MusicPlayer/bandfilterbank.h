@@ -0,0 +1,124 @@
+#ifndef BANDFILTERBANK_H
+#define BANDFILTERBANK_H
+
+#include <juce_core/juce_core.h>
+
+#include <array>
+#include <cmath>
+
+// -----------------------------------------------------------------------------
+// BandFilterbank: time-domain band levels with no analysis window. One biquad
+// band-pass and one envelope follower per band, designed from the band edges
+// the FFT mode uses, so the levels describe the same bands; they just follow
+// a transient within the block that carries it instead of 90-190 ms later.
+//
+// All state is kept band-major in structure-of-arrays form and every sample
+// runs one loop across all bands, with no branches. That loop is what the
+// compiler vectorises (16 bands: four SSE or two AVX registers), so the whole
+// bank costs a handful of vector operations per sample.
+//
+// Each band's level is scaled by the caller's figure for a full-scale sine
+// at the band's centre (the FFT mode's band average for that sine), so the
+// visualizer stays in range whichever mode is running.
+// -----------------------------------------------------------------------------
+template <int NumBands>
+class BandFilterbank
+{
+public:
+    struct BandEdges { float min; float max; };
+    using Levels = std::array<float, NumBands>;
+
+    // Design the filters for these edges at the given rate and clear the
+    // state. A sine of amplitude 1 at a band's centre reads levelScales[b].
+    void prepare(const std::array<BandEdges, NumBands>& edges, double sampleRate, const Levels& levelScales)
+    {
+        const double nyquistLimit = 0.45 * sampleRate;
+
+        for (int b = 0; b < NumBands; ++b)
+        {
+            // Centre at the geometric middle of the band; the RBJ band-pass
+            // (0 dB peak) with the band's width in octaves puts its -3 dB
+            // points on the edges.
+            const double low = juce::jmax(1.0, static_cast<double>(edges[b].min));
+            const double high = juce::jmin(nyquistLimit, juce::jmax(low * 1.01, static_cast<double>(edges[b].max)));
+            const double centre = std::sqrt(low * high);
+            const double octaves = std::log2(high / low);
+
+            const double w0 = juce::MathConstants<double>::twoPi * centre / sampleRate;
+            const double sinW0 = std::sin(w0);
+            const double alpha = sinW0 * std::sinh(0.5 * std::log(2.0) * octaves * w0 / sinW0);
+            const double a0 = 1.0 + alpha;
+
+            b0[b] = static_cast<float>(alpha / a0);
+            b2[b] = static_cast<float>(-alpha / a0);
+            a1[b] = static_cast<float>(-2.0 * std::cos(w0) / a0);
+            a2[b] = static_cast<float>((1.0 - alpha) / a0);
+
+            // Rise within about a quarter cycle of the band's centre (but
+            // never slower than 10 ms), fall over a few cycles so the ripple
+            // of a rectified low tone doesn't make the level shake.
+            const double attackSeconds = juce::jmin(0.010, 0.25 / centre);
+            const double releaseSeconds = juce::jmax(0.060, 4.0 / centre);
+            attack[b] = static_cast<float>(1.0 - std::exp(-1.0 / (attackSeconds * sampleRate)));
+            release[b] = static_cast<float>(1.0 - std::exp(-1.0 / (releaseSeconds * sampleRate)));
+
+            // Fast up and slow down, the envelope rides near the rectified
+            // sine's peaks, so it is scaled as an amplitude.
+            scale[b] = levelScales[b];
+        }
+        reset();
+    }
+
+    void reset()
+    {
+        z1.fill(0.0f);
+        z2.fill(0.0f);
+        envelope.fill(0.0f);
+    }
+
+    // Run a block of mono samples through every band.
+    void process(const float* samples, int numSamples)
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const float x = samples[i];
+
+            for (int b = 0; b < NumBands; ++b)
+            {
+                // Transposed direct form II; a band-pass has no b1 term.
+                const float y = b0[b] * x + z1[b];
+                z1[b] = z2[b] - a1[b] * y;
+                z2[b] = b2[b] * x - a2[b] * y;
+
+                const float rectified = std::abs(y);
+                const float coeff = rectified > envelope[b] ? attack[b] : release[b];
+                envelope[b] += coeff * (rectified - envelope[b]);
+            }
+        }
+
+        // Keep denormals out of the recursion once the input goes silent.
+        for (int b = 0; b < NumBands; ++b)
+        {
+            z1[b] = std::abs(z1[b]) < 1.0e-15f ? 0.0f : z1[b];
+            z2[b] = std::abs(z2[b]) < 1.0e-15f ? 0.0f : z2[b];
+            envelope[b] = envelope[b] < 1.0e-15f ? 0.0f : envelope[b];
+        }
+    }
+
+    // Band levels as of the end of the last block.
+    void getLevels(Levels& levels) const
+    {
+        for (int b = 0; b < NumBands; ++b)
+            levels[b] = envelope[b] * scale[b];
+    }
+
+private:
+    // Coefficients, one lane per band.
+    alignas(32) std::array<float, NumBands> b0 {}, b2 {}, a1 {}, a2 {};
+    alignas(32) std::array<float, NumBands> attack {}, release {}, scale {};
+
+    // State, one lane per band.
+    alignas(32) std::array<float, NumBands> z1 {}, z2 {}, envelope {};
+};
+
+#endif // BANDFILTERBANK_H
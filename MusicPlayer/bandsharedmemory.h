@@ -0,0 +1,122 @@
+#ifndef BANDSHAREDMEMORY_H
+#define BANDSHAREDMEMORY_H
+
+#include <QDebug>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+// Windows API for shared memory
+#include <windows.h>
+
+#include "spectrumanalyzer.h"
+
+// -----------------------------------------------------------------------------
+// BandSharedMemory: publishes the band levels to the Unity visualizer through
+// a named file mapping. The view is mapped once and kept for the lifetime of
+// the object instead of being re-mapped on every block.
+//
+// The harmonic/percussive split goes to a second mapping, so readers of the
+// original one see exactly the layout they always did:
+//   float harmonic[16], percussive[16], harmonicEnergy, percussiveEnergy
+// -----------------------------------------------------------------------------
+class BandSharedMemory
+{
+public:
+    // Initiating constants for shared memory
+    static constexpr const wchar_t* SHM_NAME = L"Local\\FractalWaveFFT";
+    static constexpr size_t BAND_COUNT = static_cast<size_t>(SpectrumAnalyzer::NumBands);
+    static constexpr size_t SHM_SIZE   = BAND_COUNT * sizeof(float);
+
+    static constexpr const wchar_t* HPSS_SHM_NAME = L"Local\\FractalWaveHPSS";
+    static constexpr size_t HPSS_SHM_SIZE = (2 * BAND_COUNT + 2) * sizeof(float);
+
+    BandSharedMemory() = default;
+
+    BandSharedMemory(const BandSharedMemory&) = delete;
+    BandSharedMemory& operator=(const BandSharedMemory&) = delete;
+
+    // Call every frame
+    void writeFrequencyBands(const std::array<float, BAND_COUNT>& frequencyBands)
+    {
+        if (!bands.isOpen() && !bands.open())
+            return;
+
+        // Copy the raw floats into shared memory
+        std::memcpy(bands.view, frequencyBands.data(), SHM_SIZE);
+    }
+
+    // Call whenever the analyzer has a new separation frame
+    void writeSeparation(const SpectrumAnalyzer::Separation& separation)
+    {
+        if (!hpss.isOpen() && !hpss.open())
+            return;
+
+        std::array<float, 2 * BAND_COUNT + 2> values {};
+        std::copy(separation.harmonic.begin(), separation.harmonic.end(), values.begin());
+        std::copy(separation.percussive.begin(), separation.percussive.end(), values.begin() + BAND_COUNT);
+        values[2 * BAND_COUNT] = separation.harmonicEnergy;
+        values[2 * BAND_COUNT + 1] = separation.percussiveEnergy;
+
+        std::memcpy(hpss.view, values.data(), HPSS_SHM_SIZE);
+    }
+
+private:
+    struct Mapping
+    {
+        Mapping(const wchar_t* mappingName, size_t mappingSize) : name(mappingName), size(mappingSize) {}
+
+        ~Mapping()
+        {
+            if (view != nullptr)
+                UnmapViewOfFile(view);
+            if (hMap != nullptr)
+                CloseHandle(hMap);
+        }
+
+        bool isOpen() const { return view != nullptr; }
+
+        bool open()
+        {
+            // Don't retry a failed mapping on every audio block.
+            if (openFailed)
+                return false;
+
+            // INVALID_HANDLE_VALUE = use the system paging file
+            hMap = CreateFileMappingW(
+                INVALID_HANDLE_VALUE,
+                nullptr,
+                PAGE_READWRITE,
+                0,
+                (DWORD)size,
+                name
+                );
+            if (!hMap) {
+                qDebug() << "CreateFileMapping failed:" << GetLastError();
+                openFailed = true;
+                return false;
+            }
+
+            // Map the memory into our address space
+            view = MapViewOfFile(hMap, FILE_MAP_WRITE, 0, 0, size);
+            if (!view) {
+                qDebug() << "MapViewOfFile failed:" << GetLastError();
+                openFailed = true;
+                return false;
+            }
+            return true;
+        }
+
+        const wchar_t* name;
+        size_t size;
+        HANDLE hMap = nullptr;
+        LPVOID view = nullptr;
+        bool openFailed = false;
+    };
+
+    Mapping bands { SHM_NAME, SHM_SIZE };
+    Mapping hpss { HPSS_SHM_NAME, HPSS_SHM_SIZE };
+};
+
+#endif // BANDSHAREDMEMORY_H
@@ -0,0 +1,165 @@
+#ifndef CALLBACKTELEMETRY_H
+#define CALLBACKTELEMETRY_H
+
+#include <juce_audio_devices/juce_audio_devices.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+// -----------------------------------------------------------------------------
+// CallbackTelemetry: sits between the device and the real callback (the
+// AudioSourcePlayer) and measures every callback from inside the audio thread.
+// Everything is published through relaxed atomics, so the UI can read a
+// snapshot at any time without ever taking a lock the callback also needs.
+//
+// Callback durations go into a histogram of the fraction of the buffer period
+// they used (10% steps, the last bucket is "over budget"). CPU load is an
+// exponential average of the same fraction. An xrun is counted whenever a
+// callback runs past its period or arrives more than half a period late.
+//
+// Being the first thing the device calls, it is also where per-thread setup
+// for the audio thread happens (onAudioThreadStart).
+// -----------------------------------------------------------------------------
+class CallbackTelemetry : public juce::AudioIODeviceCallback
+{
+public:
+    static constexpr int NumBuckets = 11;
+
+    struct Snapshot
+    {
+        std::array<uint32_t, NumBuckets> histogram {};
+        uint64_t callbacks = 0;
+        uint32_t overruns = 0;        // callback took longer than its period
+        uint32_t lateCallbacks = 0;   // callback started late (gap in the stream)
+        float cpuLoad = 0.0f;         // 0..1, smoothed
+        float maxDurationMs = 0.0f;
+        double bufferPeriodMs = 0.0;
+    };
+
+    explicit CallbackTelemetry(juce::AudioIODeviceCallback& callbackToWrap)
+        : wrapped(callbackToWrap) { }
+
+    // Runs on the audio thread before the first callback of every device
+    // session (drivers usually start a new thread each time). Set it before
+    // the callback is registered.
+    std::function<void()> onAudioThreadStart;
+
+    void audioDeviceIOCallbackWithContext(const float* const* inputChannelData,
+                                          int numInputChannels,
+                                          float* const* outputChannelData,
+                                          int numOutputChannels,
+                                          int numSamples,
+                                          const juce::AudioIODeviceCallbackContext& context) override
+    {
+        if (!audioThreadStarted.exchange(true, std::memory_order_relaxed) && onAudioThreadStart)
+            onAudioThreadStart();
+
+        const juce::int64 start = juce::Time::getHighResolutionTicks();
+
+        wrapped.audioDeviceIOCallbackWithContext(inputChannelData, numInputChannels,
+                                                 outputChannelData, numOutputChannels,
+                                                 numSamples, context);
+
+        const juce::int64 end = juce::Time::getHighResolutionTicks();
+        record(start, end, numSamples);
+    }
+
+    void audioDeviceAboutToStart(juce::AudioIODevice* device) override
+    {
+        sampleRate = device != nullptr ? device->getCurrentSampleRate() : 0.0;
+        lastStartTicks = 0;
+        audioThreadStarted.store(false, std::memory_order_relaxed);
+        wrapped.audioDeviceAboutToStart(device);
+    }
+
+    void audioDeviceStopped() override
+    {
+        wrapped.audioDeviceStopped();
+    }
+
+    void audioDeviceError(const juce::String& errorMessage) override
+    {
+        wrapped.audioDeviceError(errorMessage);
+    }
+
+    Snapshot getSnapshot() const
+    {
+        Snapshot s;
+        for (int i = 0; i < NumBuckets; ++i)
+            s.histogram[i] = histogram[i].load(std::memory_order_relaxed);
+        s.callbacks      = callbacks.load(std::memory_order_relaxed);
+        s.overruns       = overruns.load(std::memory_order_relaxed);
+        s.lateCallbacks  = lateCallbacks.load(std::memory_order_relaxed);
+        s.cpuLoad        = cpuLoad.load(std::memory_order_relaxed);
+        s.maxDurationMs  = maxDurationMs.load(std::memory_order_relaxed);
+        s.bufferPeriodMs = bufferPeriodMs.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    // Zero the counters (e.g. after changing the device configuration).
+    void reset()
+    {
+        for (auto& bucket : histogram)
+            bucket.store(0, std::memory_order_relaxed);
+        callbacks.store(0, std::memory_order_relaxed);
+        overruns.store(0, std::memory_order_relaxed);
+        lateCallbacks.store(0, std::memory_order_relaxed);
+        maxDurationMs.store(0.0f, std::memory_order_relaxed);
+    }
+
+private:
+    void record(juce::int64 start, juce::int64 end, int numSamples)
+    {
+        if (sampleRate <= 0.0 || numSamples <= 0)
+            return;
+
+        const double periodSeconds = numSamples / sampleRate;
+        const double usedSeconds = juce::Time::highResolutionTicksToSeconds(end - start);
+        const double fraction = usedSeconds / periodSeconds;
+
+        const int bucket = juce::jlimit(0, NumBuckets - 1, static_cast<int>(fraction * 10.0));
+        histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+        callbacks.fetch_add(1, std::memory_order_relaxed);
+
+        if (fraction > 1.0)
+            overruns.fetch_add(1, std::memory_order_relaxed);
+
+        if (lastStartTicks != 0)
+        {
+            const double gapSeconds = juce::Time::highResolutionTicksToSeconds(start - lastStartTicks);
+            if (gapSeconds > periodSeconds * 1.5)
+                lateCallbacks.fetch_add(1, std::memory_order_relaxed);
+        }
+        lastStartTicks = start;
+
+        // Only the audio thread writes these, so load/modify/store is fine.
+        const float load = cpuLoad.load(std::memory_order_relaxed);
+        cpuLoad.store(load + 0.05f * (static_cast<float>(fraction) - load), std::memory_order_relaxed);
+
+        const float durationMs = static_cast<float>(usedSeconds * 1000.0);
+        if (durationMs > maxDurationMs.load(std::memory_order_relaxed))
+            maxDurationMs.store(durationMs, std::memory_order_relaxed);
+
+        bufferPeriodMs.store(periodSeconds * 1000.0, std::memory_order_relaxed);
+    }
+
+    juce::AudioIODeviceCallback& wrapped;
+
+    std::atomic<bool> audioThreadStarted { false };
+
+    // Audio thread only.
+    double sampleRate = 0.0;
+    juce::int64 lastStartTicks = 0;
+
+    std::array<std::atomic<uint32_t>, NumBuckets> histogram {};
+    std::atomic<uint64_t> callbacks { 0 };
+    std::atomic<uint32_t> overruns { 0 };
+    std::atomic<uint32_t> lateCallbacks { 0 };
+    std::atomic<float> cpuLoad { 0.0f };
+    std::atomic<float> maxDurationMs { 0.0f };
+    std::atomic<double> bufferPeriodMs { 0.0 };
+};
+
+#endif // CALLBACKTELEMETRY_H
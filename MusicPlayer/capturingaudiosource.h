@@ -0,0 +1,85 @@
+#ifndef CAPTURINGAUDIOSOURCE_H
+#define CAPTURINGAUDIOSOURCE_H
+
+#include <juce_audio_basics/juce_audio_basics.h>
+
+#include <functional>
+
+#include "spectrumanalyzer.h"
+
+// -----------------------------------------------------------------------------
+// CapturingAudioSource: Wraps another AudioSource to capture samples
+// -----------------------------------------------------------------------------
+// Custom audio source that captures samples as they're played and feeds them
+// to a SpectrumAnalyzer. Whoever owns the chain decides when analysis runs
+// (shouldAnalyse) and what happens with the band levels (onBandsReady) and,
+// when the analyzer separates them, the harmonic/percussive bands
+// (onSeparationReady); all are called on the audio thread.
+class CapturingAudioSource : public juce::AudioSource
+{
+public:
+    CapturingAudioSource(juce::AudioSource* sourceToWrap, SpectrumAnalyzer& analyzerToFeed)
+        : wrappedSource(sourceToWrap),
+        analyzer(analyzerToFeed) { }
+
+    void setSource(juce::AudioSource* newSource) { wrappedSource = newSource; }
+
+    std::function<bool()> shouldAnalyse;
+    std::function<void(const SpectrumAnalyzer::BandLevels&)> onBandsReady;
+    std::function<void(const SpectrumAnalyzer::Separation&)> onSeparationReady;
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override
+    {
+        // Analysis runs on what the device actually plays, so at its rate.
+        analyzer.prepare(sampleRate);
+
+        if (wrappedSource != nullptr)
+            wrappedSource->prepareToPlay(samplesPerBlockExpected, sampleRate);
+    }
+
+    void releaseResources() override
+    {
+        if (wrappedSource != nullptr)
+            wrappedSource->releaseResources();
+    }
+
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override
+    {
+        if (wrappedSource != nullptr)
+            wrappedSource->getNextAudioBlock(bufferToFill);
+        else
+            bufferToFill.clearActiveBufferRegion();
+
+        if (shouldAnalyse && !shouldAnalyse())
+            return;
+
+        if (bufferToFill.buffer != nullptr && bufferToFill.buffer->getNumChannels() > 0)
+        {
+            // Append samples to the analyzer's buffer
+            auto* channelData = bufferToFill.buffer->getReadPointer(0, bufferToFill.startSample);
+            analyzer.pushSamples(channelData, bufferToFill.numSamples);
+        }
+
+        performFFT();
+    }
+
+    void performFFT()
+    {
+        if (analyzer.isReady()) {
+            // Perform FFT analysis on the current audio samples.
+            analyzer.performFFT();
+
+            if (onBandsReady)
+                onBandsReady(analyzer.getFreqBands());
+
+            if (onSeparationReady && analyzer.hasNewSeparation())
+                onSeparationReady(analyzer.getSeparation());
+        }
+    }
+
+private:
+    juce::AudioSource* wrappedSource;
+    SpectrumAnalyzer& analyzer;
+};
+
+#endif // CAPTURINGAUDIOSOURCE_H
@@ -0,0 +1,683 @@
+// HEADLESSRENDER.CPP - Faster-than-real-time render and analysis tool
+//
+// Pushes tracks through the same AudioChain the player uses (reader ->
+// resampler -> transport -> effects -> capture/analysis) without a sound card
+// or any Qt, as fast as the CPU allows. Rendered audio can go to WAV files or be discarded, and the
+// analyzer's band levels can be written out as CSV frames.
+//
+//   fractalwave-render [options] <file|directory|playlist.m3u> ...
+//
+//   --out <path>       write rendered audio as WAV (file for a single input,
+//                      otherwise a directory)
+//   --frames <path>    write analysis frames as CSV (file or directory)
+//   --null             discard rendered audio (default)
+//   --rate <hz>        rate the chain runs at, like a device rate (48000)
+//   --block <n>        block size pulled per callback (512)
+//   --no-analysis      skip the capture/analysis stage
+//   --analysis <mode>  fft, filterbank or multirate (fft)
+//   --hpss             add harmonic/percussive band sets and energies to the
+//                      frames (fft and multirate modes)
+//   --eq <g0,...,g9>   enable the 10-band EQ with these gains in dB
+//   --width <w>        enable the stereo widener (0..2)
+//   --limit <db>       enable the limiter at this threshold
+//   --speed <x>        playback speed 0.5..2, pitch kept (1)
+//   --resampler <q>    linear, lagrange, fast or best (fast)
+//   --bench-resampler  print each resampling tier's CPU cost and exit
+//   --bench-fft        time every FFT backend at the analyzer's sizes and exit
+//   --fft <backend>    auto, juce, radix2 or fftw (auto: fastest measured)
+//   --bench-threads    stress test: xruns of a simulated device thread with the
+//                      thread policy off and on, against one busy thread per core
+//   --pin              with --bench-threads, pin the audio thread to its own core
+//   --fingerprint      print each input's acoustic fingerprint size and how
+//                      closely it matches the first input's, then exit
+//   --quiet            only print the summary
+
+#include <juce_core/juce_core.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "acousticfingerprint.h"
+#include "audiochain.h"
+#include "fftbackend.h"
+#include "threadpolicy.h"
+
+namespace
+{
+
+struct RenderOptions
+{
+    juce::File outPath;
+    juce::File framesPath;
+    double sampleRate = 48000.0;
+    int blockSize = 512;
+    bool analysis = true;
+    SpectrumAnalyzer::Mode analysisMode = SpectrumAnalyzer::Fft;
+    bool separation = false;
+    bool quiet = false;
+
+    // Effect chain; everything off unless asked for.
+    juce::Array<float> eqGains;
+    float width = -1.0f;     // < 0: widener off
+    float limitDb = 1.0f;    // > 0: limiter off
+
+    ResamplerSource::Quality resampler = ResamplerSource::SincFast;
+    double speed = 1.0;
+
+    bool benchThreads = false;
+    bool pinThreads = false;
+    bool fingerprint = false;
+};
+
+struct RenderStats
+{
+    double audioSeconds = 0.0;
+    double wallSeconds = 0.0;
+    juce::int64 analysisFrames = 0;
+};
+
+void printUsage()
+{
+    std::cout << "usage: fractalwave-render [options] <file|directory|playlist.m3u> ...\n"
+                 "  --out <path>      write rendered audio as WAV (file or directory)\n"
+                 "  --frames <path>   write analysis frames as CSV (file or directory)\n"
+                 "  --null            discard rendered audio (default)\n"
+                 "  --rate <hz>       rate the chain runs at (default 48000)\n"
+                 "  --block <n>       block size (default 512)\n"
+                 "  --no-analysis     skip the capture/analysis stage\n"
+                 "  --analysis <mode> fft, filterbank or multirate (default fft)\n"
+                 "  --hpss            add harmonic/percussive bands and energies to the frames\n"
+                 "  --eq <g0,...,g9>  enable the 10-band EQ with these gains in dB\n"
+                 "  --width <w>       enable the stereo widener (0..2)\n"
+                 "  --limit <db>      enable the limiter at this threshold\n"
+                 "  --speed <x>       playback speed 0.5..2, pitch kept (default 1)\n"
+                 "  --resampler <q>   linear, lagrange, fast or best (default fast)\n"
+                 "  --bench-resampler print each resampling tier's CPU cost and exit\n"
+                 "  --bench-fft       time every FFT backend at the analyzer's sizes and exit\n"
+                 "  --fft <backend>   auto, juce, radix2 or fftw (default auto)\n"
+                 "  --bench-threads   xruns under CPU load with the thread policy off and on\n"
+                 "  --pin             with --bench-threads, pin the audio thread to its own core\n"
+                 "  --fingerprint     compare the inputs' acoustic fingerprints to the first's\n"
+                 "  --quiet           only print the summary\n";
+}
+
+bool parseResamplerQuality(const juce::String& name, ResamplerSource::Quality& quality)
+{
+    if (name == "linear")        quality = ResamplerSource::Linear;
+    else if (name == "lagrange") quality = ResamplerSource::Lagrange;
+    else if (name == "fast")     quality = ResamplerSource::SincFast;
+    else if (name == "best")     quality = ResamplerSource::SincBest;
+    else                         return false;
+    return true;
+}
+
+// CPU cost of every tier for the rate conversions people actually hit,
+// in microseconds of CPU per channel-second of output.
+void benchmarkResampler()
+{
+    struct Conversion { double from, to; };
+    const Conversion conversions[] = { { 44100.0, 48000.0 }, { 48000.0, 44100.0 },
+                                       { 96000.0, 48000.0 }, { 192000.0, 44100.0 } };
+
+    std::cout << "us CPU per channel-second of output\n";
+    std::cout << juce::String("conversion").paddedRight(' ', 20);
+    for (int q = 0; q < ResamplerSource::NumQualities; ++q)
+        std::cout << juce::String(ResamplerSource::getQualityName(static_cast<ResamplerSource::Quality>(q))).paddedLeft(' ', 14);
+    std::cout << "\n";
+
+    for (const auto& conversion : conversions)
+    {
+        std::cout << (juce::String(conversion.from / 1000.0, 1) + " -> " + juce::String(conversion.to / 1000.0, 1) + " kHz").paddedRight(' ', 20);
+        for (int q = 0; q < ResamplerSource::NumQualities; ++q)
+        {
+            const double cost = ResamplerSource::measureCostPerChannelSecond(static_cast<ResamplerSource::Quality>(q),
+                                                                             conversion.from, conversion.to);
+            std::cout << juce::String(cost * 1.0e6, 1).paddedLeft(' ', 14);
+        }
+        std::cout << "\n";
+    }
+}
+
+// Time per transform of every FFT backend at the sizes the analyzer uses,
+// and which one it will pick.
+void benchmarkFft()
+{
+    const int orders[] = { SpectrumAnalyzer::lowFftOrder, SpectrumAnalyzer::highFftOrder, SpectrumAnalyzer::fftOrder };
+
+    std::cout << "us per real forward transform\n";
+    std::cout << juce::String("size").paddedRight(' ', 10);
+    for (int k = 0; k < FftBackend::NumKinds; ++k)
+        std::cout << juce::String(FftBackend::getKindName(static_cast<FftBackend::Kind>(k))).paddedLeft(' ', 12);
+    std::cout << juce::String("picked").paddedLeft(' ', 12) << "\n";
+
+    for (const int order : orders)
+    {
+        std::cout << juce::String(1 << order).paddedRight(' ', 10);
+        for (int k = 0; k < FftBackend::NumKinds; ++k)
+        {
+            const double nanos = FftBackend::measureNanosPerTransform(static_cast<FftBackend::Kind>(k), order, 0.2);
+            std::cout << (nanos < 0.0 ? juce::String("-") : juce::String(nanos / 1000.0, 2)).paddedLeft(' ', 12);
+        }
+        std::cout << juce::String(FftBackend::getKindName(FftBackend::getFastest(order))).paddedLeft(' ', 12) << "\n";
+    }
+}
+
+bool parseFftBackend(const juce::String& name, FftBackend::Kind& kind)
+{
+    if (name == "auto")
+    {
+        kind = FftBackend::NumKinds;
+        return true;
+    }
+
+    for (int k = 0; k < FftBackend::NumKinds; ++k)
+    {
+        if (name == FftBackend::getKindName(static_cast<FftBackend::Kind>(k)))
+        {
+            kind = static_cast<FftBackend::Kind>(k);
+            return FftBackend::isAvailable(kind);
+        }
+    }
+    return false;
+}
+
+//============================================================================
+// Thread policy stress test
+
+struct StressResult
+{
+    juce::int64 callbacks = 0;
+    int xruns = 0;
+    double worstMs = 0.0;          // longest from request to block ready
+    juce::String audioThread;
+    juce::String background;
+};
+
+// One simulated device session: a thread asks the chain for a block every
+// buffer period, as a sound card would, while one busy thread per core
+// competes for the CPU. A block that isn't ready by the end of its period
+// would have been a gap in the output: an xrun.
+StressResult runThreadStress(const RenderOptions& options, const ThreadPolicy::Settings& policy, double seconds)
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Four seconds of looping noise at 44.1 kHz, so the resampler, the EQ
+    // and the limiter all have real work to do.
+    juce::AudioBuffer<float> noise(2, 4 * 44100);
+    juce::Random random(1234);
+    for (int ch = 0; ch < noise.getNumChannels(); ++ch)
+        for (int i = 0; i < noise.getNumSamples(); ++i)
+            noise.setSample(ch, i, random.nextFloat() * 0.5f - 0.25f);
+    juce::MemoryAudioSource source(noise, false, true);
+
+    AudioChain chain;
+    chain.getResampler().setQuality(ResamplerSource::SincBest);
+    DspParameters& dsp = chain.getDsp().getParameters();
+    dsp.eqEnabled = true;
+    for (int b = 0; b < DspParameters::NumEqBands; ++b)
+        dsp.eqGainDb[b] = b % 2 == 0 ? 3.0f : -3.0f;
+    dsp.limiterEnabled = true;
+
+    chain.setSource(&source, 44100.0);
+    chain.getOutput().prepareToPlay(options.blockSize, options.sampleRate);
+    chain.getController().play();
+
+    StressResult result;
+    std::atomic<bool> running { true };
+
+    std::vector<std::thread> hogs;
+    for (int i = 0; i < juce::SystemStats::getNumCpus(); ++i)
+    {
+        hogs.emplace_back([&running, &policy, &result, i] {
+            const auto report = ThreadPolicy::applyToCurrentThread(ThreadPolicy::Role::Background, policy);
+            if (i == 0)
+                result.background = ThreadPolicy::describe(report);
+
+            double sink = 0.0;
+            while (running.load(std::memory_order_relaxed))
+                for (int k = 1; k < 10000; ++k)
+                    sink += std::sqrt(static_cast<double>(k));
+            juce::ignoreUnused(sink);
+        });
+    }
+
+    std::thread audio([&] {
+        result.audioThread = ThreadPolicy::describe(ThreadPolicy::applyToCurrentThread(ThreadPolicy::Role::Audio, policy));
+
+        juce::AudioBuffer<float> block(2, options.blockSize);
+        const auto period = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(options.blockSize / options.sampleRate));
+        const auto end = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+
+        for (auto request = Clock::now() + period; request < end; request += period)
+        {
+            // Sleep most of the way and spin the rest: sleep granularity can be
+            // coarser than a buffer period.
+            std::this_thread::sleep_until(request - std::chrono::milliseconds(2));
+            while (Clock::now() < request)
+                std::this_thread::yield();
+
+            juce::AudioSourceChannelInfo info(&block, 0, options.blockSize);
+            chain.getOutput().getNextAudioBlock(info);
+
+            const auto ready = Clock::now();
+            ++result.callbacks;
+            result.worstMs = juce::jmax(result.worstMs, std::chrono::duration<double, std::milli>(ready - request).count());
+
+            // Late: count it and carry on from now, like a device restarting its stream.
+            if (ready > request + period)
+            {
+                ++result.xruns;
+                request = ready;
+            }
+        }
+    });
+
+    audio.join();
+    running = false;
+    for (auto& hog : hogs)
+        hog.join();
+
+    chain.getOutput().releaseResources();
+    chain.setSource(nullptr, 0.0);
+    return result;
+}
+
+void benchmarkThreadPolicy(const RenderOptions& options)
+{
+    constexpr double seconds = 10.0;
+
+    std::cout << "thread policy stress: block " << options.blockSize << " @ " << options.sampleRate << " Hz ("
+              << juce::String(1000.0 * options.blockSize / options.sampleRate, 2) << " ms), "
+              << juce::SystemStats::getNumCpus() << " busy threads, " << seconds << " s per run\n";
+
+    ThreadPolicy::Settings off;
+    off.enabled = false;
+    ThreadPolicy::Settings on;
+    on.pinThreads = options.pinThreads;
+
+    for (const auto* policy : { &off, &on })
+    {
+        const StressResult result = runThreadStress(options, *policy, seconds);
+        std::cout << (policy->enabled ? "  policy on:  " : "  policy off: ")
+                  << result.callbacks << " callbacks, " << result.xruns << " xruns, worst "
+                  << juce::String(result.worstMs, 2) << " ms to ready\n"
+                  << "    " << result.audioThread << "\n"
+                  << "    " << result.background << "\n";
+    }
+}
+
+bool isPlaylistFile(const juce::File& file)
+{
+    return file.hasFileExtension("m3u;m3u8;txt");
+}
+
+// Expand directories (their own files only: outputs are named after the
+// input's file name, so tracks from two subfolders could overwrite each
+// other) and playlists (one path per line, '#' lines ignored, relative to
+// the playlist's folder).
+void collectInputs(const juce::File& input, juce::AudioFormatManager& formatManager,
+                   juce::Array<juce::File>& results)
+{
+    if (input.isDirectory())
+    {
+        auto files = input.findChildFiles(juce::File::findFiles, false);
+        files.sort();
+        for (const auto& file : files)
+            if (formatManager.findFormatForFileExtension(file.getFileExtension()) != nullptr)
+                results.add(file);
+        return;
+    }
+
+    if (isPlaylistFile(input))
+    {
+        juce::StringArray lines;
+        input.readLines(lines);
+        for (auto line : lines)
+        {
+            line = line.trim();
+            if (line.isEmpty() || line.startsWithChar('#'))
+                continue;
+            results.add(input.getParentDirectory().getChildFile(line));
+        }
+        return;
+    }
+
+    results.add(input);
+}
+
+// Fingerprint every track, as the library does, and compare each with the
+// first: a bit error rate under AcousticFingerprint::SameRecordingBitErrors
+// is what the library calls the same recording.
+bool fingerprintTracks(const juce::Array<juce::File>& tracks, juce::AudioFormatManager& formatManager)
+{
+    // About 10 s either way, for files that start with more or less silence.
+    constexpr int maxShift = 220;
+
+    AcousticFingerprint::Words first;
+    bool ok = true;
+    for (const auto& track : tracks)
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(track));
+        if (reader == nullptr || reader->sampleRate <= 0.0)
+        {
+            std::cerr << track.getFullPathName() << ": can't read\n";
+            ok = false;
+            continue;
+        }
+
+        const juce::int64 startTicks = juce::Time::getHighResolutionTicks();
+        const AcousticFingerprint::Words words = AcousticFingerprint::compute(*reader);
+        const double wallSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+
+        std::cout << track.getFileName() << ": " << words.size() << " words in "
+                  << juce::String(wallSeconds * 1000.0, 1) << " ms";
+        if (first.empty())
+        {
+            first = words;
+        }
+        else
+        {
+            const auto alignment = AcousticFingerprint::align(first, words, maxShift);
+            std::cout << ", " << juce::String(alignment.bitErrors * 100.0f, 1) << "% bits differ at offset "
+                      << alignment.offset
+                      << (alignment.bitErrors <= AcousticFingerprint::SameRecordingBitErrors ? " (same recording)" : "");
+        }
+        std::cout << "\n";
+    }
+    return ok;
+}
+
+// Output file for one input: the path itself for a single input written to a
+// file, otherwise <dir>/<input name>.<extension>.
+juce::File outputFileFor(const juce::File& path, const juce::File& input,
+                         const juce::String& extension, bool singleInput)
+{
+    if (path == juce::File())
+        return {};
+    if (singleInput && path.hasFileExtension(extension))
+        return path;
+
+    path.createDirectory();
+    return path.getChildFile(input.getFileNameWithoutExtension() + "." + extension);
+}
+
+bool renderTrack(const juce::File& input, const RenderOptions& options, bool singleInput,
+                 juce::AudioFormatManager& formatManager, RenderStats& stats)
+{
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(input));
+    if (reader == nullptr)
+    {
+        std::cerr << "cannot read " << input.getFullPathName() << "\n";
+        return false;
+    }
+
+    const double fileRate = reader->sampleRate;
+    const juce::int64 fileLength = reader->lengthInSamples;
+    juce::AudioFormatReaderSource readerSource(reader.release(), true);
+
+    // Optional WAV writer.
+    std::unique_ptr<juce::AudioFormatWriter> writer;
+    const juce::File wavFile = outputFileFor(options.outPath, input, "wav", singleInput);
+    if (wavFile != juce::File())
+    {
+        wavFile.deleteFile();
+        std::unique_ptr<juce::FileOutputStream> stream(wavFile.createOutputStream());
+        juce::WavAudioFormat wavFormat;
+        if (stream != nullptr)
+            writer.reset(wavFormat.createWriterFor(stream.get(), options.sampleRate, 2, 24, {}, 0));
+        if (writer == nullptr)
+        {
+            std::cerr << "cannot write " << wavFile.getFullPathName() << "\n";
+            return false;
+        }
+        stream.release(); // now owned by the writer
+    }
+
+    // Optional analysis frame sink.
+    std::unique_ptr<juce::FileOutputStream> frames;
+    const juce::File csvFile = outputFileFor(options.framesPath, input, "csv", singleInput);
+    if (csvFile != juce::File())
+    {
+        csvFile.deleteFile();
+        frames = csvFile.createOutputStream();
+        if (frames == nullptr)
+        {
+            std::cerr << "cannot write " << csvFile.getFullPathName() << "\n";
+            return false;
+        }
+
+        juce::String header = "time";
+        for (int band = 0; band < SpectrumAnalyzer::NumBands; ++band)
+            header << ",band" << band;
+        if (options.separation)
+        {
+            for (int band = 0; band < SpectrumAnalyzer::NumBands; ++band)
+                header << ",harmonic" << band;
+            for (int band = 0; band < SpectrumAnalyzer::NumBands; ++band)
+                header << ",percussive" << band;
+            header << ",harmonicEnergy,percussiveEnergy";
+        }
+        *frames << header << "\n";
+    }
+
+    AudioChain chain;
+    double blockEndSeconds = 0.0;
+    juce::int64 analysisFrames = 0;
+
+    chain.getCapture().shouldAnalyse = [&options] { return options.analysis; };
+    chain.getCapture().onBandsReady = [&](const SpectrumAnalyzer::BandLevels& bands) {
+        ++analysisFrames;
+        if (frames == nullptr)
+            return;
+
+        juce::String line(blockEndSeconds, 6);
+        for (float level : bands)
+            line << "," << juce::String(level, 6);
+
+        // The latest separation frame (they come every separationHop samples).
+        if (options.separation)
+        {
+            const SpectrumAnalyzer::Separation& separation = chain.getAnalyzer().getSeparation();
+            for (float level : separation.harmonic)
+                line << "," << juce::String(level, 6);
+            for (float level : separation.percussive)
+                line << "," << juce::String(level, 6);
+            line << "," << juce::String(separation.harmonicEnergy, 6)
+                 << "," << juce::String(separation.percussiveEnergy, 6);
+        }
+        *frames << line << "\n";
+    };
+
+    chain.getResampler().setQuality(options.resampler);
+    chain.getTimeStretch().setSpeed(options.speed);
+    chain.getAnalyzer().setMode(options.analysisMode);
+    chain.getAnalyzer().setSeparationEnabled(options.separation);
+
+    DspParameters& dsp = chain.getDsp().getParameters();
+    if (!options.eqGains.isEmpty())
+    {
+        dsp.eqEnabled = true;
+        for (int b = 0; b < DspParameters::NumEqBands && b < options.eqGains.size(); ++b)
+            dsp.eqGainDb[b] = options.eqGains[b];
+    }
+    if (options.width >= 0.0f)
+    {
+        dsp.widenerEnabled = true;
+        dsp.stereoWidth = options.width;
+    }
+    if (options.limitDb <= 0.0f)
+    {
+        dsp.limiterEnabled = true;
+        dsp.limiterThresholdDb = options.limitDb;
+    }
+
+    chain.setSource(&readerSource, fileRate);
+    chain.getOutput().prepareToPlay(options.blockSize, options.sampleRate);
+    chain.getController().play();
+
+    // Number of output samples the whole file becomes at the chain's rate and speed.
+    const double speed = chain.getTimeStretch().getSpeed();
+    const juce::int64 totalSamples = static_cast<juce::int64>(std::ceil(fileLength * options.sampleRate / fileRate / speed));
+    juce::AudioBuffer<float> block(2, options.blockSize);
+
+    const juce::int64 startTicks = juce::Time::getHighResolutionTicks();
+
+    for (juce::int64 rendered = 0; rendered < totalSamples;)
+    {
+        const int numSamples = static_cast<int>(juce::jmin<juce::int64>(options.blockSize, totalSamples - rendered));
+        rendered += numSamples;
+        blockEndSeconds = static_cast<double>(rendered) / options.sampleRate;
+
+        juce::AudioSourceChannelInfo info(&block, 0, numSamples);
+        chain.getOutput().getNextAudioBlock(info);
+
+        if (writer != nullptr)
+            writer->writeFromAudioSampleBuffer(block, 0, numSamples);
+    }
+
+    const double wallSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+    const double audioSeconds = static_cast<double>(totalSamples) / options.sampleRate;
+
+    chain.getOutput().releaseResources();
+    chain.setSource(nullptr, 0.0);
+
+    stats.audioSeconds += audioSeconds;
+    stats.wallSeconds += wallSeconds;
+    stats.analysisFrames += analysisFrames;
+
+    if (!options.quiet)
+    {
+        std::cout << input.getFileName() << ": "
+                  << juce::String(audioSeconds, 2) << " s audio in "
+                  << juce::String(wallSeconds, 3) << " s ("
+                  << juce::String(audioSeconds / juce::jmax(wallSeconds, 1e-9), 1) << "x realtime), "
+                  << analysisFrames << " analysis frames\n";
+
+        const auto loads = chain.getDsp().getStageLoads();
+        for (int stage = 0; stage < DspChainSource::NumStages; ++stage)
+            if (loads[stage] > 0.0f)
+                std::cout << "  " << DspChainSource::getStageName(static_cast<DspChainSource::Stage>(stage)) << ": "
+                          << juce::String(loads[stage] * 100.0f, 3) << "% of the block period\n";
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    RenderOptions options;
+    juce::StringArray inputs;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const juce::String arg(argv[i]);
+        const bool hasValue = i + 1 < argc;
+
+        if (arg == "--out" && hasValue)               options.outPath = juce::File::getCurrentWorkingDirectory().getChildFile(argv[++i]);
+        else if (arg == "--frames" && hasValue)       options.framesPath = juce::File::getCurrentWorkingDirectory().getChildFile(argv[++i]);
+        else if (arg == "--null")                     options.outPath = juce::File();
+        else if (arg == "--rate" && hasValue)         options.sampleRate = juce::String(argv[++i]).getDoubleValue();
+        else if (arg == "--block" && hasValue)        options.blockSize = juce::String(argv[++i]).getIntValue();
+        else if (arg == "--no-analysis")              options.analysis = false;
+        else if (arg == "--hpss")                     options.separation = true;
+        else if (arg == "--analysis" && hasValue)
+        {
+            const juce::String mode(argv[++i]);
+            if (mode == "fft")             options.analysisMode = SpectrumAnalyzer::Fft;
+            else if (mode == "filterbank") options.analysisMode = SpectrumAnalyzer::Filterbank;
+            else if (mode == "multirate")  options.analysisMode = SpectrumAnalyzer::Multirate;
+            else
+            {
+                std::cerr << "unknown analysis mode " << mode << "\n";
+                return 2;
+            }
+        }
+        else if (arg == "--eq" && hasValue)
+        {
+            for (const auto& gain : juce::StringArray::fromTokens(argv[++i], ",", ""))
+                options.eqGains.add(gain.getFloatValue());
+        }
+        else if (arg == "--width" && hasValue)        options.width = juce::String(argv[++i]).getFloatValue();
+        else if (arg == "--limit" && hasValue)        options.limitDb = juce::String(argv[++i]).getFloatValue();
+        else if (arg == "--speed" && hasValue)        options.speed = juce::String(argv[++i]).getDoubleValue();
+        else if (arg == "--resampler" && hasValue)
+        {
+            if (!parseResamplerQuality(argv[++i], options.resampler))
+            {
+                std::cerr << "unknown resampler quality " << argv[i] << "\n";
+                return 2;
+            }
+        }
+        else if (arg == "--bench-resampler")          { benchmarkResampler(); return 0; }
+        else if (arg == "--bench-fft")                { benchmarkFft(); return 0; }
+        else if (arg == "--fft" && hasValue)
+        {
+            FftBackend::Kind kind = FftBackend::NumKinds;
+            if (!parseFftBackend(argv[++i], kind))
+            {
+                std::cerr << "unknown or unavailable FFT backend " << argv[i] << "\n";
+                return 2;
+            }
+            FftBackend::setOverride(kind);
+        }
+        else if (arg == "--bench-threads")            options.benchThreads = true;
+        else if (arg == "--pin")                      options.pinThreads = true;
+        else if (arg == "--fingerprint")              options.fingerprint = true;
+        else if (arg == "--quiet")                    options.quiet = true;
+        else if (arg == "--help" || arg == "-h")      { printUsage(); return 0; }
+        else if (arg.startsWith("--"))                { std::cerr << "unknown option " << arg << "\n"; printUsage(); return 2; }
+        else                                          inputs.add(arg);
+    }
+
+    // The analyzer doesn't wait for the FFT backends to be measured (the
+    // player can't); here there is time to, so every chain starts on the
+    // winners and renders the same from the first block.
+    for (const int order : { SpectrumAnalyzer::fftOrder, SpectrumAnalyzer::lowFftOrder, SpectrumAnalyzer::highFftOrder })
+        FftBackend::getFastest(order);
+
+    // Runs after parsing so --rate and --block apply.
+    if (options.benchThreads && options.sampleRate > 0.0 && options.blockSize > 0)
+    {
+        benchmarkThreadPolicy(options);
+        return 0;
+    }
+
+    if (inputs.isEmpty() || options.sampleRate <= 0.0 || options.blockSize <= 0)
+    {
+        printUsage();
+        return 2;
+    }
+
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    juce::Array<juce::File> tracks;
+    for (const auto& input : inputs)
+        collectInputs(juce::File::getCurrentWorkingDirectory().getChildFile(input), formatManager, tracks);
+
+    if (options.fingerprint)
+        return fingerprintTracks(tracks, formatManager) ? 0 : 1;
+
+    RenderStats stats;
+    int failures = 0;
+    for (const auto& track : tracks)
+        if (!renderTrack(track, options, tracks.size() == 1, formatManager, stats))
+            ++failures;
+
+    std::cout << "rendered " << (tracks.size() - failures) << "/" << tracks.size() << " tracks: "
+              << juce::String(stats.audioSeconds, 2) << " s audio in "
+              << juce::String(stats.wallSeconds, 3) << " s ("
+              << juce::String(stats.audioSeconds / juce::jmax(stats.wallSeconds, 1e-9), 1) << "x realtime), "
+              << stats.analysisFrames << " analysis frames\n";
+
+    return failures == 0 ? 0 : 1;
+}
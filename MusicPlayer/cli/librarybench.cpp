@@ -0,0 +1,229 @@
+// LIBRARYBENCH.CPP - Memory and speed of the library's track storage
+//
+// Builds synthetic libraries (folders of artist/album/track, tags, cover
+// art keys, stream info) and keeps each one twice: as one Track per file with
+// a QHash by path, the way the library used to, and in a TrackStore. Prints
+// the bytes per track of each and the time to build, look up every path,
+// sort by artist and filter by a word.
+//
+//   fractalwave-library-bench [tracks ...]     (default 10000 100000 1000000)
+//
+// Byte counts come from container capacities and QString data blocks, not
+// from the allocator, so they leave out its per-block overhead. That
+// overhead falls mostly on the Track side: five heap blocks per track
+// against a handful of large arrays.
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+#include "stringpool.h"
+#include "trackstore.h"
+
+namespace
+{
+
+const char* const words[] = {
+    "love", "night", "blue", "fire", "river", "dream", "city", "light", "heart", "road",
+    "summer", "rain", "gold", "echo", "shadow", "wild", "home", "star", "ocean", "glass",
+};
+constexpr int numWords = int(sizeof(words) / sizeof(words[0]));
+
+// A few words picked by n, so titles vary in length and content.
+QString phrase(quint32 n, int count)
+{
+    QStringList parts;
+    for (int i = 0; i < count; ++i) {
+        parts.append(QString::fromLatin1(words[n % numWords]));
+        n = n * 2654435761u + 1;
+    }
+    parts.first()[0] = parts.first()[0].toUpper();
+    return parts.join(u' ');
+}
+
+// About ten tracks to an album and four albums to an artist. Every string
+// is built afresh, as the scanner's metadata reader does.
+std::vector<Track> makeLibrary(int numTracks)
+{
+    const QString musicRoot = QStringLiteral("C:/Users/listener/Music/");
+
+    std::vector<Track> tracks;
+    tracks.reserve(size_t(numTracks));
+    for (int i = 0; i < numTracks; ++i) {
+        const int album = i / 10;
+        const int artist = album / 4;
+        const QString artistName = phrase(quint32(artist), 2) + QStringLiteral(" %1").arg(artist);
+        const QString albumName = phrase(quint32(album) + 7u, 3) + QStringLiteral(" %1").arg(album);
+        const QString baseName = QStringLiteral("%1 - %2").arg(i % 10 + 1, 2, 10, QChar(u'0')).arg(phrase(quint32(i), 1 + i % 4));
+        const bool flac = i % 3 != 0;
+
+        Track track;
+        track.filePath = musicRoot + artistName + u'/' + albumName + u'/' + baseName + (flac ? QStringLiteral(".flac") : QStringLiteral(".mp3"));
+        track.title = baseName.mid(5);
+        track.artist = artistName;
+        track.album = albumName;
+        track.artHash = quint64(album) * 0xc2b2ae3d27d4eb4full + 1;
+        track.durationMs = 120000 + (i * 7919) % 240000;
+        track.codec = flac ? QString::fromLatin1("flac") : QString::fromLatin1("mp3");
+        track.sampleRate = 44100;
+        track.channels = 2;
+        track.bitRate = flac ? 900000 : 320000;
+        track.quickHash = quint64(i) * 0x9e3779b97f4a7c15ull + 1;
+        tracks.push_back(track);
+    }
+    return tracks;
+}
+
+struct Result
+{
+    qsizetype bytes = 0;
+    double buildMs = 0.0;
+    double lookupMs = 0.0;
+    double sortMs = 0.0;
+    double filterMs = 0.0;
+    qsizetype matches = 0;
+};
+
+double elapsedMs(const QElapsedTimer& timer)
+{
+    return double(timer.nsecsElapsed()) / 1e6;
+}
+
+// One Track per file and a hash of paths to them.
+Result measureTracks(const std::vector<Track>& library)
+{
+    Result result;
+    QElapsedTimer timer;
+
+    timer.start();
+    QVector<Track> tracks;
+    QHash<QString, int> byPath;
+    for (const Track& track : library) {
+        byPath.insert(track.filePath, int(tracks.size()));
+        tracks.append(track);
+    }
+    result.buildMs = elapsedMs(timer);
+
+    // The Track copies share their strings with library, so count them
+    // rather than measure the process.
+    result.bytes = tracks.capacity() * qsizetype(sizeof(Track));
+    for (const Track& track : tracks) {
+        for (const QString* s : { &track.filePath, &track.title, &track.artist, &track.album, &track.codec })
+            result.bytes += StringPool::heapBytes(*s);
+    }
+    result.bytes += byPath.capacity() * qsizetype(sizeof(QString) + sizeof(int) + 8);
+
+    timer.start();
+    qint64 found = 0;
+    for (const Track& track : library)
+        found += byPath.value(track.filePath, -1) >= 0;
+    result.lookupMs = elapsedMs(timer);
+    if (found != qint64(library.size()))
+        std::cerr << "QHash lookups missed " << qint64(library.size()) - found << " tracks\n";
+
+    timer.start();
+    std::vector<int> order(size_t(tracks.size()));
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&tracks](int a, int b) {
+        if (const int c = tracks[a].artist.compare(tracks[b].artist, Qt::CaseInsensitive))
+            return c < 0;
+        if (const int c = tracks[a].album.compare(tracks[b].album, Qt::CaseInsensitive))
+            return c < 0;
+        return tracks[a].filePath.compare(tracks[b].filePath, Qt::CaseInsensitive) < 0;
+    });
+    result.sortMs = elapsedMs(timer);
+
+    timer.start();
+    const QString needle = QStringLiteral("river");
+    for (const Track& track : tracks) {
+        if (track.title.contains(needle, Qt::CaseInsensitive) || track.artist.contains(needle, Qt::CaseInsensitive)
+            || track.album.contains(needle, Qt::CaseInsensitive))
+            ++result.matches;
+    }
+    result.filterMs = elapsedMs(timer);
+    return result;
+}
+
+Result measureStore(const std::vector<Track>& library)
+{
+    Result result;
+    QElapsedTimer timer;
+
+    timer.start();
+    TrackStore store;
+    for (const Track& track : library)
+        store.insert(track);
+    store.squeeze();
+    result.buildMs = elapsedMs(timer);
+    result.bytes = store.memoryUsage();
+
+    timer.start();
+    qint64 found = 0;
+    for (const Track& track : library)
+        found += !store.find(track.filePath).isNull();
+    result.lookupMs = elapsedMs(timer);
+    if (found != qint64(library.size()))
+        std::cerr << "TrackStore lookups missed " << qint64(library.size()) - found << " tracks\n";
+
+    timer.start();
+    store.sorted(TrackStore::SortKey::Artist);
+    result.sortMs = elapsedMs(timer);
+
+    timer.start();
+    result.matches = store.matching(u"river").size();
+    result.filterMs = elapsedMs(timer);
+    return result;
+}
+
+void printRow(const char* name, int numTracks, const Result& result)
+{
+    std::cout << "  " << std::left << std::setw(12) << name << std::right
+              << std::setw(8) << result.bytes / numTracks << " B/track"
+              << std::setw(9) << result.bytes / (1024 * 1024) << " MiB"
+              << std::fixed << std::setprecision(1)
+              << "   build " << std::setw(8) << result.buildMs << " ms"
+              << "   lookup " << std::setw(7) << result.lookupMs << " ms"
+              << "   sort " << std::setw(8) << result.sortMs << " ms"
+              << "   filter " << std::setw(7) << result.filterMs << " ms (" << result.matches << ")\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QVector<int> sizes;
+    for (const QString& arg : app.arguments().mid(1)) {
+        bool ok = false;
+        const int n = arg.toInt(&ok);
+        if (!ok || n <= 0) {
+            std::cerr << "usage: fractalwave-library-bench [tracks ...]\n";
+            return 2;
+        }
+        sizes.append(n);
+    }
+    if (sizes.isEmpty())
+        sizes = { 10000, 100000, 1000000 };
+
+    for (const int numTracks : sizes) {
+        const std::vector<Track> library = makeLibrary(numTracks);
+        const Result tracks = measureTracks(library);
+        const Result store = measureStore(library);
+
+        std::cout << numTracks << " tracks: " << std::fixed << std::setprecision(1)
+                  << double(tracks.bytes) / double(store.bytes) << "x smaller\n";
+        printRow("Track+QHash", numTracks, tracks);
+        printRow("TrackStore", numTracks, store);
+    }
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include "contenthasher.h"
+
+#include <QDebug>
+
+#include <memory>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+#include "avmetadatareader.h"
+#include "xxhash64.h"
+
+namespace
+{
+struct FormatContextCloser
+{
+    void operator()(AVFormatContext* context) const { avformat_close_input(&context); }
+};
+
+struct PacketFreer
+{
+    void operator()(AVPacket* packet) const { av_packet_free(&packet); }
+};
+} // namespace
+
+quint64 ContentHasher::quickHash(const QString& filePath)
+{
+    Track track;
+    quint64 digest = 0;
+    AvMetadataReader::read(filePath, track, nullptr, &digest);
+    return digest;
+}
+
+quint64 ContentHasher::quickHash(AVFormatContext* context, int audioIndex)
+{
+    return hashPackets(context, audioIndex, QuickBytes);
+}
+
+quint64 ContentHasher::contentHash(const QString& filePath)
+{
+    AVFormatContext* opened = nullptr;
+    if (avformat_open_input(&opened, filePath.toUtf8().constData(), nullptr, nullptr) < 0) {
+        qWarning() << "ContentHasher: can't open" << filePath;
+        return 0;
+    }
+    std::unique_ptr<AVFormatContext, FormatContextCloser> context(opened);
+
+    return hashPackets(context.get(), av_find_best_stream(context.get(), AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0), -1);
+}
+
+quint64 ContentHasher::hashPackets(AVFormatContext* context, int audioIndex, qint64 byteLimit)
+{
+    if (audioIndex < 0)
+        return 0;
+    const AVCodecParameters* codecpar = context->streams[audioIndex]->codecpar;
+
+    // A quick hash also stands in for the length, which the first packets
+    // can't tell; whole seconds, so an estimated duration still agrees.
+    XxHash64 hasher;
+    if (byteLimit >= 0) {
+        const qint64 header[] = { codecpar->codec_id, codecpar->sample_rate, codecpar->format,
+                                  context->duration > 0 ? context->duration / AV_TIME_BASE : 0 };
+        hasher.update(header, sizeof(header));
+    }
+
+    std::unique_ptr<AVPacket, PacketFreer> packet(av_packet_alloc());
+    qint64 hashed = 0;
+    while ((byteLimit < 0 || hashed < byteLimit) && av_read_frame(context, packet.get()) >= 0) {
+        if (packet->stream_index == audioIndex && packet->size > 0) {
+            hasher.update(packet->data, static_cast<size_t>(packet->size));
+            hashed += packet->size;
+        }
+        av_packet_unref(packet.get());
+    }
+
+    if (hashed == 0)
+        return 0;
+
+    // 0 is "unknown" everywhere these are kept.
+    const quint64 digest = hasher.digest();
+    return digest != 0 ? digest : 1;
+}
@@ -0,0 +1,42 @@
+#ifndef CONTENTHASHER_H
+#define CONTENTHASHER_H
+
+#include <QString>
+
+struct AVFormatContext;
+
+// -----------------------------------------------------------------------------
+// ContentHasher: XXH64 digests of a file's audio, for finding copies of a
+// track whatever they are called and however they are tagged.
+//
+// Only the packets of the audio stream are hashed, as libavformat demuxes
+// them, so tags, cover art and container padding don't count: a renamed or
+// re-tagged copy hashes the same, a re-encode doesn't (that's what the
+// acoustic fingerprints are for).
+//
+// quickHash() reads only the first QuickBytes of audio and mixes in the
+// codec, format and whole-second duration. It is cheap enough to take for
+// every file while scanning, and files whose quick hashes differ can't be
+// copies. contentHash() reads all of it and settles the files that share
+// one. Neither decodes anything. 0 means the file couldn't be read.
+//
+// A scan takes the quick hash from the context AvMetadataReader already has
+// open for the tags, so each file is opened once; quickHash(filePath) goes
+// through the same reader, so the two always agree.
+// -----------------------------------------------------------------------------
+class ContentHasher
+{
+public:
+    static constexpr qint64 QuickBytes = 64 * 1024;
+
+    static quint64 quickHash(const QString& filePath);
+    // The same from an open context no packets have been read from yet.
+    static quint64 quickHash(AVFormatContext* context, int audioIndex);
+    static quint64 contentHash(const QString& filePath);
+
+private:
+    // Hash the audio stream's packets until byteLimit (< 0: all of them).
+    static quint64 hashPackets(AVFormatContext* context, int audioIndex, qint64 byteLimit);
+};
+
+#endif // CONTENTHASHER_H
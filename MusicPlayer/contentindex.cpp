@@ -0,0 +1,174 @@
+#include "contentindex.h"
+
+#include <QDebug>
+#include <QPair>
+
+#include "contenthasher.h"
+#include "threadpolicy.h"
+
+ContentIndex::ContentIndex(QObject* parent)
+    : QObject(parent)
+{
+    pool.setMaxThreadCount(1);
+    connect(this, &ContentIndex::verified, this, &ContentIndex::onVerified, Qt::QueuedConnection);
+}
+
+void ContentIndex::unlink(QHash<quint64, QStringList>& buckets, quint64 hash, const QString& libraryPath)
+{
+    const auto it = buckets.find(hash);
+    if (it == buckets.end())
+        return;
+
+    it->removeOne(libraryPath);
+    if (it->isEmpty())
+        buckets.erase(it);
+}
+
+void ContentIndex::insert(const QString& libraryPath, quint64 quickHash, quint64 contentHash)
+{
+    remove(libraryPath);
+    if (quickHash == 0)
+        return;
+
+    entries.insert(libraryPath, Entry { quickHash, contentHash });
+    byQuickHash[quickHash].append(libraryPath);
+    if (contentHash != 0)
+        byContentHash[contentHash].append(libraryPath);
+}
+
+void ContentIndex::remove(const QString& libraryPath)
+{
+    const auto it = entries.constFind(libraryPath);
+    if (it == entries.cend())
+        return;
+
+    unlink(byQuickHash, it->quickHash, libraryPath);
+    if (it->contentHash != 0)
+        unlink(byContentHash, it->contentHash, libraryPath);
+    entries.erase(it);
+}
+
+void ContentIndex::retainOnly(const QSet<QString>& libraryPaths)
+{
+    QStringList gone;
+    for (auto it = entries.cbegin(); it != entries.cend(); ++it) {
+        if (!libraryPaths.contains(it.key()))
+            gone.append(it.key());
+    }
+    for (const QString& libraryPath : gone)
+        remove(libraryPath);
+}
+
+void ContentIndex::clear()
+{
+    entries.clear();
+    byQuickHash.clear();
+    byContentHash.clear();
+    ++generation;   // drop verifications still in flight
+}
+
+void ContentIndex::setContentHash(const QString& libraryPath, quint64 contentHash)
+{
+    const auto it = entries.find(libraryPath);
+    if (it == entries.end() || contentHash == 0 || it->contentHash == contentHash)
+        return;
+
+    if (it->contentHash != 0)
+        unlink(byContentHash, it->contentHash, libraryPath);
+    it->contentHash = contentHash;
+    byContentHash[contentHash].append(libraryPath);
+
+    emit contentHashed(libraryPath, contentHash);
+}
+
+QString ContentIndex::findCopyOf(const QString& filePath)
+{
+    const quint64 quickHash = ContentHasher::quickHash(filePath);
+    if (quickHash == 0)
+        return {};
+
+    const QStringList candidates = byQuickHash.value(quickHash);
+    if (candidates.isEmpty())
+        return {};
+
+    const quint64 contentHash = ContentHasher::contentHash(filePath);
+    if (contentHash == 0)
+        return {};
+
+    for (const QString& candidate : candidates) {
+        if (entries.value(candidate).contentHash == 0 && resolver)
+            setContentHash(candidate, ContentHasher::contentHash(resolver(candidate)));
+    }
+
+    // The file itself may already be indexed (the watcher can be quicker).
+    for (const QString& copy : byContentHash.value(contentHash)) {
+        if (!resolver || resolver(copy) != filePath)
+            return copy;
+    }
+    return {};
+}
+
+QVector<QStringList> ContentIndex::duplicateGroups() const
+{
+    QVector<QStringList> groups;
+    for (auto it = byContentHash.cbegin(); it != byContentHash.cend(); ++it) {
+        if (it->size() > 1) {
+            QStringList group = *it;
+            group.sort(Qt::CaseInsensitive);
+            groups.append(group);
+        }
+    }
+    return groups;
+}
+
+void ContentIndex::verifyCandidates()
+{
+    if (!resolver)
+        return;
+    if (verifying) {
+        verifyAgain = true;
+        return;
+    }
+
+    // Paths are resolved here; the pool only reads files.
+    QVector<QPair<QString, QString>> files;
+    for (auto bucket = byQuickHash.cbegin(); bucket != byQuickHash.cend(); ++bucket) {
+        if (bucket->size() < 2)
+            continue;
+        for (const QString& libraryPath : *bucket) {
+            if (entries.value(libraryPath).contentHash == 0)
+                files.append({ libraryPath, resolver(libraryPath) });
+        }
+    }
+    if (files.isEmpty())
+        return;
+
+    qDebug() << "ContentIndex: hashing" << files.size() << "possible duplicates";
+
+    verifying = true;
+    const quint64 verification = generation;
+    pool.start([this, verification, files] {
+        ThreadPolicy::applyIfChanged(ThreadPolicy::Role::Background);
+
+        QHash<QString, quint64> contentHashes;
+        for (const auto& file : files)
+            contentHashes.insert(file.first, ContentHasher::contentHash(file.second));
+        emit verified(verification, contentHashes);
+    });
+}
+
+void ContentIndex::onVerified(quint64 verification, const QHash<QString, quint64>& contentHashes)
+{
+    verifying = false;
+
+    if (verification == generation) {
+        for (auto it = contentHashes.cbegin(); it != contentHashes.cend(); ++it)
+            setContentHash(it.key(), it.value());
+        emit duplicatesChanged();
+    }
+
+    if (verifyAgain) {
+        verifyAgain = false;
+        verifyCandidates();
+    }
+}
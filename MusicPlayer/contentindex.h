@@ -0,0 +1,91 @@
+#ifndef CONTENTINDEX_H
+#define CONTENTINDEX_H
+
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+
+#include <functional>
+
+// -----------------------------------------------------------------------------
+// ContentIndex: which library files hold the same audio, by ContentHasher
+// digest, so a track is recognised however its copy is named or tagged.
+//
+// Files are bucketed by quick hash as the scan delivers them. Files alone
+// in their bucket can't be copies of anything and are never read again;
+// the rest are settled by their content hash, which verifyCandidates()
+// takes in the background (one file at a time; it is disk-bound) and
+// contentHashed() hands back to be cached. Looking a hash up is a hash
+// table probe either way.
+//
+// Everything but the hashing itself runs on the GUI thread.
+// -----------------------------------------------------------------------------
+class ContentIndex : public QObject
+{
+    Q_OBJECT
+public:
+    // Library path -> file on disk.
+    using Resolver = std::function<QString(const QString& libraryPath)>;
+
+    explicit ContentIndex(QObject* parent = nullptr);
+
+    void setResolver(Resolver newResolver) { resolver = std::move(newResolver); }
+
+    // Add or replace a file; a zero quick hash takes it out.
+    void insert(const QString& libraryPath, quint64 quickHash, quint64 contentHash);
+    void remove(const QString& libraryPath);
+    void retainOnly(const QSet<QString>& libraryPaths);
+    void clear();
+
+    int size() const { return static_cast<int>(entries.size()); }
+
+    // The library file holding the same audio as filePath (which needn't be
+    // in the library yet), or empty. Any hashes it needs are taken on the
+    // calling thread.
+    QString findCopyOf(const QString& filePath);
+
+    // Files known to hold the same audio, two or more to a group.
+    QVector<QStringList> duplicateGroups() const;
+
+    // Take the content hashes still missing from shared quick-hash buckets.
+    void verifyCandidates();
+
+signals:
+    void contentHashed(const QString& libraryPath, quint64 contentHash);
+    // verifyCandidates() finished and changed duplicateGroups().
+    void duplicatesChanged();
+
+    // Internal: a verification finished on the pool.
+    void verified(quint64 generation, const QHash<QString, quint64>& contentHashes);
+
+private slots:
+    void onVerified(quint64 generation, const QHash<QString, quint64>& contentHashes);
+
+private:
+    struct Entry
+    {
+        quint64 quickHash = 0;
+        quint64 contentHash = 0;
+    };
+
+    void setContentHash(const QString& libraryPath, quint64 contentHash);
+    static void unlink(QHash<quint64, QStringList>& buckets, quint64 hash, const QString& libraryPath);
+
+    Resolver resolver;
+    QHash<QString, Entry> entries;
+    QHash<quint64, QStringList> byQuickHash;
+    QHash<quint64, QStringList> byContentHash;
+
+    bool verifying = false;
+    bool verifyAgain = false;
+    quint64 generation = 0;
+
+    // Declared last so it is destroyed first, waiting for a verification in
+    // flight while the rest of the object is still there.
+    QThreadPool pool;
+};
+
+#endif // CONTENTINDEX_H
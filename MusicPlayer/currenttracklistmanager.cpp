@@ -39,23 +39,39 @@ void CurrentTracklistManager::scanDirectory(const QString &directoryPath)
 
 void CurrentTracklistManager::initializePlaylist(const QString& playlistName)
 {
-    QDir musicDir(LibraryManager::instance().getCurrentMusicDirectory());
     // 1) fetch the file-paths from LibraryManager
     QStringList trackNames =
         LibraryManager::instance().getTracksFromPlaylist(playlistName);
 
-    // 2) reset our internal Playlist
+    // 2) reset our internal Playlist, remembering which track was current
+    const QString currentPath = getCurrentTrack().filePath;
+    const int previousIndex = currentIndex;
     currentPlaylist.clear();
     currentPlaylist.setName(playlistName);
 
-    // 3) build Track objects and add them
+    // 3) copy the tracks from the library, whose scan has read their tags
+    //    (one it hasn't reached yet comes back titled after its file, and
+    //    the playlist is rebuilt when the scan finishes)
     for (const QString& trackName : trackNames)
     {
-        Track t;
-        t.filePath = musicDir.filePath(trackName);
-        t.title    = QFileInfo(trackName).baseName();
-        currentPlaylist.addTrack(t);
+        const QString filePath = LibraryManager::instance().resolveTrackPath(trackName);
+        const TrackHandle handle = LibraryManager::instance().getTrackFromMasterPlaylist(filePath);
+        Track track;
+        if (LibraryManager::instance().getTrack(handle, track))
+            currentPlaylist.addTrack(track);
+    }
+
+    // 4) keep the place on that track wherever it moved to; if it's gone,
+    //    stand just before where it was so nextTrack() carries on from there
+    currentIndex = -1;
+    for (int i = 0; !currentPath.isEmpty() && i < currentPlaylist.size(); ++i) {
+        if (currentPlaylist.at(i).filePath == currentPath) {
+            currentIndex = i;
+            break;
+        }
     }
+    if (currentIndex < 0 && previousIndex > 0)
+        currentIndex = qMin(previousIndex, currentPlaylist.size()) - 1;
 
     // emit playlistChanged(playlistName);
 }
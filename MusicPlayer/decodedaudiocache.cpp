@@ -0,0 +1,189 @@
+#include "decodedaudiocache.h"
+#include "threadpolicy.h"
+
+#include <cmath>
+
+// DecodeJob: background job that decodes one file and inserts it into the cache.
+class DecodedAudioCache::DecodeJob : public juce::ThreadPoolJob
+{
+public:
+    DecodeJob(DecodedAudioCache& ownerCache, const juce::String& path, std::shared_ptr<DecodedTrack> trackToFill)
+        : juce::ThreadPoolJob("DecodeJob"), owner(ownerCache), filePath(path), track(std::move(trackToFill)) { }
+
+    JobStatus runJob() override
+    {
+        ThreadPolicy::applyIfChanged(ThreadPolicy::Role::Background);
+
+        if (owner.decode(filePath, *track, *this))
+            owner.insert(filePath, track);
+
+        std::lock_guard<std::mutex> guard(owner.lock);
+        owner.pending.erase(filePath);
+        return jobHasFinished;
+    }
+
+private:
+    DecodedAudioCache& owner;
+    juce::String filePath;
+    std::shared_ptr<DecodedTrack> track;
+};
+
+DecodedAudioCache::DecodedAudioCache()
+{
+    formatManager.registerBasicFormats();
+}
+
+DecodedAudioCache::~DecodedAudioCache()
+{
+    decodePool.removeAllJobs(true, 2000);
+}
+
+void DecodedAudioCache::setBudgetBytes(size_t newBudget)
+{
+    budgetBytes = newBudget;
+
+    std::lock_guard<std::mutex> guard(lock);
+    evictToBudget({});
+}
+
+DecodedAudioCache::TrackPtr DecodedAudioCache::find(const juce::String& filePath)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    auto it = entries.find(filePath);
+    if (it == entries.end())
+        return nullptr;
+
+    // Move to the front of the LRU list.
+    lru.splice(lru.begin(), lru, it->second.lruPosition);
+    return it->second.track;
+}
+
+DecodedAudioCache::TrackPtr DecodedAudioCache::prefetch(const juce::String& filePath)
+{
+    if (filePath.isEmpty())
+        return nullptr;
+
+    auto track = std::make_shared<DecodedTrack>();
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (auto it = entries.find(filePath); it != entries.end())
+            return it->second.track;
+        if (auto it = pending.find(filePath); it != pending.end())
+            return it->second;
+        pending[filePath] = track;
+    }
+
+    decodePool.addJob(new DecodeJob(*this, filePath, track), true);
+    return track;
+}
+
+void DecodedAudioCache::clear()
+{
+    decodePool.removeAllJobs(true, 2000);
+
+    std::lock_guard<std::mutex> guard(lock);
+    entries.clear();
+    lru.clear();
+    pending.clear();
+    usedBytes = 0;
+}
+
+bool DecodedAudioCache::decode(const juce::String& filePath, DecodedTrack& track, juce::ThreadPoolJob& job)
+{
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(juce::File(filePath)));
+    if (reader == nullptr || reader->lengthInSamples <= 0 || reader->numChannels == 0)
+        return false;
+
+    // Nobody reads any of this until the first chunk is published below.
+    track.sampleRate  = reader->sampleRate;
+    track.numChannels = static_cast<int>(reader->numChannels);
+    track.numSamples  = reader->lengthInSamples;
+
+    // Integer PCM of 16 bits or less round-trips exactly through int16.
+    track.isPacked16 = !reader->usesFloatingPointData && reader->bitsPerSample <= 16;
+
+    const size_t totalSamples = static_cast<size_t>(track.numChannels) * static_cast<size_t>(track.numSamples);
+    const size_t bytesNeeded  = totalSamples * (track.isPacked16 ? sizeof(int16_t) : sizeof(float));
+    if (bytesNeeded > budgetBytes.load())
+        return false; // Would evict everything else; stream it from disk instead.
+
+    if (track.isPacked16)
+        track.int16Data.resize(totalSamples);
+    else
+        track.floatData.resize(totalSamples);
+
+    constexpr int chunkSize = 1 << 16;
+    juce::AudioBuffer<float> chunk(track.numChannels, chunkSize);
+
+    for (juce::int64 start = 0; start < track.numSamples; start += chunkSize)
+    {
+        if (job.shouldExit())
+            return false;
+
+        const int numToRead = static_cast<int>(juce::jmin<juce::int64>(chunkSize, track.numSamples - start));
+        if (!reader->read(&chunk, 0, numToRead, start, true, true))
+            return false;
+
+        for (int ch = 0; ch < track.numChannels; ++ch)
+        {
+            const float* src = chunk.getReadPointer(ch);
+            const size_t offset = static_cast<size_t>(ch) * static_cast<size_t>(track.numSamples)
+                                  + static_cast<size_t>(start);
+
+            if (track.isPacked16)
+            {
+                int16_t* dest = track.int16Data.data() + offset;
+                for (int i = 0; i < numToRead; ++i)
+                    dest[i] = static_cast<int16_t>(juce::jlimit(-32768.0f, 32767.0f, std::round(src[i] * 32768.0f)));
+            }
+            else
+            {
+                std::memcpy(track.floatData.data() + offset, src, sizeof(float) * static_cast<size_t>(numToRead));
+            }
+        }
+
+        // A source streaming this file plays the chunk from here on.
+        track.decodedSamples.store(start + numToRead, std::memory_order_release);
+    }
+
+    return true;
+}
+
+void DecodedAudioCache::insert(const juce::String& filePath, TrackPtr track)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    auto it = entries.find(filePath);
+    if (it != entries.end())
+    {
+        usedBytes -= it->second.track->sizeInBytes();
+        lru.erase(it->second.lruPosition);
+        entries.erase(it);
+    }
+
+    usedBytes += track->sizeInBytes();
+    lru.push_front(filePath);
+    entries[filePath] = Entry { std::move(track), lru.begin() };
+
+    evictToBudget(filePath);
+}
+
+// Caller must hold lock.
+void DecodedAudioCache::evictToBudget(const juce::String& keep)
+{
+    while (usedBytes.load() > budgetBytes.load() && !lru.empty())
+    {
+        const juce::String victim = lru.back();
+        if (victim == keep)
+            break;
+
+        auto it = entries.find(victim);
+        if (it != entries.end())
+        {
+            usedBytes -= it->second.track->sizeInBytes();
+            entries.erase(it);
+        }
+        lru.pop_back();
+    }
+}
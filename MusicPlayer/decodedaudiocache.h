@@ -0,0 +1,235 @@
+#ifndef DECODEDAUDIOCACHE_H
+#define DECODEDAUDIOCACHE_H
+
+#include <juce_core/juce_core.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// DecodedTrack: a decoded track held in memory.
+// Samples are stored planar. When the source file is <= 16-bit integer PCM the
+// samples are packed losslessly into int16 to halve the footprint, otherwise
+// they are kept as float.
+//
+// The decode fills it front to back and publishes how far it has got, so a
+// source can play the decoded part while the rest is still coming. Nothing
+// else (the format or the sample storage) may be read before
+// getDecodedSamples() is above 0.
+// -----------------------------------------------------------------------------
+struct DecodedTrack
+{
+    double sampleRate = 0.0;
+    int numChannels = 0;
+    juce::int64 numSamples = 0;
+
+    bool isPacked16 = false;
+    std::vector<float> floatData;     // numChannels * numSamples, planar
+    std::vector<int16_t> int16Data;   // numChannels * numSamples, planar
+
+    std::atomic<juce::int64> decodedSamples { 0 };   // numSamples once complete
+
+    juce::int64 getDecodedSamples() const { return decodedSamples.load(std::memory_order_acquire); }
+
+    size_t sizeInBytes() const
+    {
+        return floatData.size() * sizeof(float) + int16Data.size() * sizeof(int16_t);
+    }
+
+    // Copy numToRead samples of one channel, starting at startSample, into dest.
+    void read(int channel, juce::int64 startSample, float* dest, int numToRead) const
+    {
+        const size_t offset = static_cast<size_t>(channel) * static_cast<size_t>(numSamples)
+                              + static_cast<size_t>(startSample);
+        if (isPacked16)
+        {
+            const int16_t* src = int16Data.data() + offset;
+            constexpr float scale = 1.0f / 32768.0f;
+            for (int i = 0; i < numToRead; ++i)
+                dest[i] = static_cast<float>(src[i]) * scale;
+        }
+        else
+        {
+            std::memcpy(dest, floatData.data() + offset, sizeof(float) * static_cast<size_t>(numToRead));
+        }
+    }
+
+    // Fill bufferToFill from startSample (>= 0) on, with silence past the end.
+    // A mono track goes to every channel.
+    void read(const juce::AudioSourceChannelInfo& bufferToFill, juce::int64 startSample) const
+    {
+        const juce::int64 available = juce::jmax<juce::int64>(0, numSamples - startSample);
+        const int numToRead = static_cast<int>(juce::jmin<juce::int64>(available, bufferToFill.numSamples));
+
+        for (int ch = 0; ch < bufferToFill.buffer->getNumChannels(); ++ch)
+        {
+            float* dest = bufferToFill.buffer->getWritePointer(ch, bufferToFill.startSample);
+            const int srcChannel = juce::jmin(ch, numChannels - 1);
+
+            if (numToRead > 0)
+                read(srcChannel, startSample, dest, numToRead);
+
+            if (numToRead < bufferToFill.numSamples)
+                juce::FloatVectorOperations::clear(dest + numToRead, bufferToFill.numSamples - numToRead);
+        }
+    }
+};
+
+// -----------------------------------------------------------------------------
+// DecodedAudioCache: process-wide LRU cache of decoded tracks with a memory
+// budget. Tracks are decoded on a background thread (prefetch) and handed out
+// as shared pointers, so evicting an entry never pulls audio from under a
+// source that is still playing it.
+// -----------------------------------------------------------------------------
+class DecodedAudioCache
+{
+public:
+    using TrackPtr = std::shared_ptr<const DecodedTrack>;
+
+    /// Access the one—and only—instance
+    static DecodedAudioCache& instance()
+    {
+        static DecodedAudioCache cache;
+        return cache;
+    }
+
+    DecodedAudioCache(const DecodedAudioCache&) = delete;
+    DecodedAudioCache& operator=(const DecodedAudioCache&) = delete;
+
+    // Memory budget in bytes. Shrinking the budget evicts immediately.
+    void setBudgetBytes(size_t newBudget);
+    size_t getBudgetBytes() const { return budgetBytes.load(); }
+    size_t getUsedBytes() const { return usedBytes.load(); }
+
+    // Returns the decoded track if cached (and marks it most recently used),
+    // otherwise nullptr.
+    TrackPtr find(const juce::String& filePath);
+
+    // Queue a background decode of filePath unless it is cached or already
+    // queued. Returns the cached track, or the one the decode is filling in
+    // (nullptr for an empty path).
+    TrackPtr prefetch(const juce::String& filePath);
+
+    // Drop every cached track and cancel pending decodes.
+    void clear();
+
+private:
+    DecodedAudioCache();
+    ~DecodedAudioCache();
+
+    class DecodeJob;
+
+    // Runs on the decode thread, filling track in. Returns false on failure,
+    // when the track does not fit in the budget, or when the job was
+    // cancelled; whatever was decoded by then stays readable.
+    bool decode(const juce::String& filePath, DecodedTrack& track, juce::ThreadPoolJob& job);
+    void insert(const juce::String& filePath, TrackPtr track);
+    void evictToBudget(const juce::String& keep);
+
+    struct Entry
+    {
+        TrackPtr track;
+        std::list<juce::String>::iterator lruPosition;
+    };
+
+    juce::AudioFormatManager formatManager;
+    juce::ThreadPool decodePool { 1 };
+
+    std::mutex lock;
+    std::list<juce::String> lru;                        // front = most recently used
+    std::unordered_map<juce::String, Entry> entries;
+    std::unordered_map<juce::String, std::shared_ptr<DecodedTrack>> pending;   // being decoded
+
+    std::atomic<size_t> budgetBytes { 512u * 1024u * 1024u };
+    std::atomic<size_t> usedBytes { 0 };
+};
+
+// -----------------------------------------------------------------------------
+// CachedAudioSource: a PositionableAudioSource that plays a DecodedTrack from
+// memory, so it can replace an AudioFormatReaderSource in the transport.
+// -----------------------------------------------------------------------------
+class CachedAudioSource : public juce::PositionableAudioSource
+{
+public:
+    explicit CachedAudioSource(DecodedAudioCache::TrackPtr trackToPlay)
+        : track(std::move(trackToPlay)) { }
+
+    void prepareToPlay(int, double) override { }
+    void releaseResources() override { }
+
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override
+    {
+        track->read(bufferToFill, position);
+        position += bufferToFill.numSamples;
+    }
+
+    void setNextReadPosition(juce::int64 newPosition) override { position = juce::jmax<juce::int64>(0, newPosition); }
+    juce::int64 getNextReadPosition() const override { return position; }
+    juce::int64 getTotalLength() const override { return track->numSamples; }
+    bool isLooping() const override { return false; }
+
+    double getSampleRate() const { return track->sampleRate; }
+
+private:
+    DecodedAudioCache::TrackPtr track;
+    juce::int64 position = 0;
+};
+
+// -----------------------------------------------------------------------------
+// DecodingAudioSource: streams a file from disk while the DecodedAudioCache is
+// decoding it. Blocks the decode has already reached come from memory; only
+// what lies ahead of it is decoded again from the file. The decode runs far
+// faster than playback, so the file is soon left alone (unless the track
+// doesn't fit in the cache, when it streams as an AudioFormatReaderSource).
+// -----------------------------------------------------------------------------
+class DecodingAudioSource : public juce::PositionableAudioSource
+{
+public:
+    // Takes ownership of the reader. trackBeingDecoded may be nullptr.
+    DecodingAudioSource(juce::AudioFormatReader* readerToStream, DecodedAudioCache::TrackPtr trackBeingDecoded)
+        : stream(readerToStream, true), track(std::move(trackBeingDecoded)) { }
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override
+    {
+        stream.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    }
+
+    void releaseResources() override { stream.releaseResources(); }
+
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override
+    {
+        const juce::int64 position = stream.getNextReadPosition();
+        const juce::int64 decoded = track != nullptr ? track->getDecodedSamples() : 0;
+        if (decoded > 0 && position + bufferToFill.numSamples <= decoded)
+        {
+            track->read(bufferToFill, position);
+            stream.setNextReadPosition(position + bufferToFill.numSamples);
+            return;
+        }
+
+        stream.getNextAudioBlock(bufferToFill);
+    }
+
+    void setNextReadPosition(juce::int64 newPosition) override
+    {
+        stream.setNextReadPosition(juce::jmax<juce::int64>(0, newPosition));
+    }
+
+    juce::int64 getNextReadPosition() const override { return stream.getNextReadPosition(); }
+    juce::int64 getTotalLength() const override { return stream.getTotalLength(); }
+    bool isLooping() const override { return false; }
+
+private:
+    juce::AudioFormatReaderSource stream;
+    DecodedAudioCache::TrackPtr track;
+};
+
+#endif // DECODEDAUDIOCACHE_H
@@ -138,8 +138,7 @@ void DisplayPlaylists::findPlaylistsContainingTrack(const QString& trackName)
 
 void DisplayPlaylists::syncTrackWithSelectedPlaylists()
 {
-    for (const QString& trackPath : listOfTrackNames) {
-        QString fileName = QFileInfo(trackPath).fileName();
+    for (const QString& fileName : listOfTrackNames) {
 
         // Remove track from deselected playlists
         for (const QString& playlist : alreadyInPlaylists) {
@@ -0,0 +1,254 @@
+#include "dspchain.h"
+
+DspChainSource::DspChainSource(juce::AudioSource* sourceToWrap)
+    : wrappedSource(sourceToWrap)
+{
+    // Every band owns its coefficient object for good; the audio thread only
+    // ever overwrites the values in place, which keeps updates allocation-free.
+    for (auto& band : eqBands)
+        band.state = new juce::dsp::IIR::Coefficients<float>(1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f);
+}
+
+const char* DspChainSource::getStageName(Stage stage)
+{
+    switch (stage)
+    {
+        case Equalizer: return "Equalizer";
+        case Widener:   return "Widener";
+        case Limiter:   return "Limiter";
+        default:        return "";
+    }
+}
+
+DspChainSource::StageLoads DspChainSource::getStageLoads() const
+{
+    StageLoads loads {};
+    for (int i = 0; i < NumStages; ++i)
+        loads[i] = stageLoads[i].load(std::memory_order_relaxed);
+    return loads;
+}
+
+void DspChainSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    if (wrappedSource != nullptr)
+        wrappedSource->prepareToPlay(samplesPerBlockExpected, sampleRate);
+
+    currentSampleRate = sampleRate > 0.0 ? sampleRate : 44100.0;
+
+    const juce::dsp::ProcessSpec spec { currentSampleRate,
+                                        static_cast<juce::uint32>(juce::jmax(1, samplesPerBlockExpected)),
+                                        static_cast<juce::uint32>(MaxChannels) };
+
+    // Resetting the smoothers jumps them to their targets, so start from there.
+    for (int b = 0; b < DspParameters::NumEqBands; ++b)
+    {
+        eqGain[b].reset(currentSampleRate, RampSeconds);
+        eqAppliedDb[b] = eqGain[b].getTargetValue();
+        setEqCoefficients(b, eqAppliedDb[b]);
+        eqBands[b].prepare(spec);
+    }
+
+    width.reset(currentSampleRate, RampSeconds);
+
+    limiter.prepare(spec);
+    limiter.setThreshold(params.limiterThresholdDb.load(std::memory_order_relaxed));
+    limiter.setRelease(params.limiterReleaseMs.load(std::memory_order_relaxed));
+    limiterActive = false;
+}
+
+void DspChainSource::releaseResources()
+{
+    if (wrappedSource != nullptr)
+        wrappedSource->releaseResources();
+}
+
+void DspChainSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    if (wrappedSource == nullptr)
+    {
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+
+    wrappedSource->getNextAudioBlock(bufferToFill);
+
+    if (bufferToFill.buffer == nullptr || bufferToFill.numSamples <= 0)
+        return;
+
+    readParameters();
+
+    const auto numChannels = static_cast<size_t>(juce::jmin(MaxChannels, bufferToFill.buffer->getNumChannels()));
+    const auto block = juce::dsp::AudioBlock<float>(*bufferToFill.buffer)
+                           .getSubsetChannelBlock(0, numChannels)
+                           .getSubBlock(static_cast<size_t>(bufferToFill.startSample),
+                                        static_cast<size_t>(bufferToFill.numSamples));
+
+    // Skipped stages report zero so their readout decays.
+    juce::int64 start = juce::Time::getHighResolutionTicks();
+    juce::int64 end = start;
+
+    const bool eqRan = processEqualizer(block);
+    end = juce::Time::getHighResolutionTicks();
+    recordLoad(Equalizer, eqRan ? end - start : 0, bufferToFill.numSamples);
+
+    start = end;
+    const bool widenerRan = processWidener(block);
+    end = juce::Time::getHighResolutionTicks();
+    recordLoad(Widener, widenerRan ? end - start : 0, bufferToFill.numSamples);
+
+    start = end;
+    const bool limiterRan = processLimiter(block);
+    end = juce::Time::getHighResolutionTicks();
+    recordLoad(Limiter, limiterRan ? end - start : 0, bufferToFill.numSamples);
+}
+
+//============================================================================
+// readParameters: pick up whatever the UI stored since the last block and
+// retarget the ramps. Switched-off stages ramp towards neutral.
+void DspChainSource::readParameters()
+{
+    const bool eqOn = params.eqEnabled.load(std::memory_order_relaxed);
+    for (int b = 0; b < DspParameters::NumEqBands; ++b)
+    {
+        const float gainDb = eqOn ? juce::jlimit(-DspParameters::maxEqGainDb, DspParameters::maxEqGainDb,
+                                                 params.eqGainDb[b].load(std::memory_order_relaxed))
+                                  : 0.0f;
+        eqGain[b].setTargetValue(gainDb);
+    }
+
+    const bool widenerOn = params.widenerEnabled.load(std::memory_order_relaxed);
+    width.setTargetValue(widenerOn ? juce::jlimit(0.0f, 2.0f, params.stereoWidth.load(std::memory_order_relaxed))
+                                   : 1.0f);
+
+    const bool limiterOn = params.limiterEnabled.load(std::memory_order_relaxed);
+    if (limiterOn && !limiterActive)
+        limiter.reset(); // don't resume from a stale envelope
+    limiterActive = limiterOn;
+
+    if (limiterOn)
+    {
+        limiter.setThreshold(params.limiterThresholdDb.load(std::memory_order_relaxed));
+        limiter.setRelease(params.limiterReleaseMs.load(std::memory_order_relaxed));
+    }
+}
+
+void DspChainSource::setEqCoefficients(int band, float gainDb)
+{
+    // Keep the top band below Nyquist at low device rates.
+    const float frequency = juce::jmin(DspParameters::eqFrequencies[band],
+                                       static_cast<float>(currentSampleRate * 0.45));
+
+    *eqBands[band].state = juce::dsp::IIR::ArrayCoefficients<float>::makePeakFilter(
+        currentSampleRate, frequency, DspParameters::eqQ, juce::Decibels::decibelsToGain(gainDb));
+}
+
+//============================================================================
+// processEqualizer: ten peaking biquads in series. While any gain is ramping
+// the block is walked in SmoothingStep chunks so the coefficients follow the
+// ramp; otherwise it is a single pass per active band.
+bool DspChainSource::processEqualizer(const juce::dsp::AudioBlock<float>& block)
+{
+    const int numSamples = static_cast<int>(block.getNumSamples());
+    bool ran = false;
+
+    for (int offset = 0; offset < numSamples;)
+    {
+        bool ramping = false;
+        for (const auto& gain : eqGain)
+            ramping = ramping || gain.isSmoothing();
+
+        const int step = ramping ? juce::jmin(SmoothingStep, numSamples - offset) : numSamples - offset;
+
+        auto chunk = block.getSubBlock(static_cast<size_t>(offset), static_cast<size_t>(step));
+        juce::dsp::ProcessContextReplacing<float> context(chunk);
+
+        for (int b = 0; b < DspParameters::NumEqBands; ++b)
+        {
+            const float gainDb = eqGain[b].skip(step);
+
+            if (gainDb != eqAppliedDb[b])
+            {
+                // A band coming back from 0 dB was skipped; its history is stale.
+                if (eqAppliedDb[b] == 0.0f)
+                    eqBands[b].reset();
+
+                setEqCoefficients(b, gainDb);
+                eqAppliedDb[b] = gainDb;
+            }
+
+            // A 0 dB peak filter is the identity.
+            if (gainDb == 0.0f)
+                continue;
+
+            eqBands[b].process(context);
+            ran = true;
+        }
+
+        offset += step;
+    }
+
+    return ran;
+}
+
+//============================================================================
+// processWidener: mid/side width. Scales the side signal by `width`.
+bool DspChainSource::processWidener(const juce::dsp::AudioBlock<float>& block)
+{
+    if (block.getNumChannels() < 2)
+        return false;
+
+    if (!width.isSmoothing() && width.getTargetValue() == 1.0f)
+        return false;
+
+    float* left = block.getChannelPointer(0);
+    float* right = block.getChannelPointer(1);
+    const int numSamples = static_cast<int>(block.getNumSamples());
+
+    if (width.isSmoothing())
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const float w = width.getNextValue();
+            const float mid = 0.5f * (left[i] + right[i]);
+            const float side = 0.5f * (left[i] - right[i]) * w;
+            left[i] = mid + side;
+            right[i] = mid - side;
+        }
+        return true;
+    }
+
+    // Constant width: a plain loop the compiler can vectorise.
+    const float w = width.getTargetValue();
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const float mid = 0.5f * (left[i] + right[i]);
+        const float side = 0.5f * (left[i] - right[i]) * w;
+        left[i] = mid + side;
+        right[i] = mid - side;
+    }
+    return true;
+}
+
+bool DspChainSource::processLimiter(const juce::dsp::AudioBlock<float>& block)
+{
+    if (!limiterActive)
+        return false;
+
+    auto limited = block;
+    juce::dsp::ProcessContextReplacing<float> context(limited);
+    limiter.process(context);
+    return true;
+}
+
+void DspChainSource::recordLoad(Stage stage, juce::int64 ticks, int numSamples)
+{
+    const double periodSeconds = numSamples / currentSampleRate;
+    const float fraction = ticks > 0
+                               ? static_cast<float>(juce::Time::highResolutionTicksToSeconds(ticks) / periodSeconds)
+                               : 0.0f;
+
+    // Only the audio thread writes these.
+    auto& load = stageLoads[stage];
+    const float previous = load.load(std::memory_order_relaxed);
+    load.store(previous + 0.05f * (fraction - previous), std::memory_order_relaxed);
+}
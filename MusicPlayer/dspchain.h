@@ -0,0 +1,102 @@
+#ifndef DSPCHAIN_H
+#define DSPCHAIN_H
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_dsp/juce_dsp.h>
+
+#include <array>
+#include <atomic>
+
+// -----------------------------------------------------------------------------
+// DspParameters: the user-facing effect settings. The UI thread stores into
+// the atomics whenever it likes; the audio thread reads them once at the start
+// of every block and ramps towards them, so no lock is ever shared.
+// -----------------------------------------------------------------------------
+struct DspParameters
+{
+    static constexpr int NumEqBands = 10;
+    static constexpr std::array<float, NumEqBands> eqFrequencies = {{
+        31.25f, 62.5f, 125.0f, 250.0f, 500.0f, 1000.0f, 2000.0f, 4000.0f, 8000.0f, 16000.0f
+    }};
+    static constexpr float eqQ = 1.41f;            // one octave per band
+    static constexpr float maxEqGainDb = 12.0f;
+
+    std::atomic<bool> eqEnabled { false };
+    std::array<std::atomic<float>, NumEqBands> eqGainDb {};
+
+    std::atomic<bool> limiterEnabled { false };
+    std::atomic<float> limiterThresholdDb { -1.0f };
+    std::atomic<float> limiterReleaseMs { 100.0f };
+
+    std::atomic<bool> widenerEnabled { false };
+    std::atomic<float> stereoWidth { 1.0f };       // 0 = mono, 1 = unchanged, 2 = twice the side signal
+};
+
+// -----------------------------------------------------------------------------
+// DspChainSource: the effect stage between the transport and the capture
+// source, so the visualizer sees what the listener hears:
+//
+//     transportSource -> [10-band EQ -> widener -> limiter] -> capturingSource
+//
+// Everything runs in place on the block handed down by the device and nothing
+// is allocated after prepareToPlay(). The limiter comes last so it also
+// catches whatever the EQ or the widener pushed over full scale. A stage that
+// is switched off ramps to neutral first and is then skipped entirely, as is
+// any EQ band sitting at 0 dB. The time each stage takes is published as a
+// fraction of the buffer period for the settings page.
+// -----------------------------------------------------------------------------
+class DspChainSource : public juce::AudioSource
+{
+public:
+    enum Stage { Equalizer = 0, Widener, Limiter, NumStages };
+
+    // Smoothed share of the buffer period each stage used (0..1).
+    using StageLoads = std::array<float, NumStages>;
+
+    explicit DspChainSource(juce::AudioSource* sourceToWrap);
+
+    void setSource(juce::AudioSource* newSource) { wrappedSource = newSource; }
+
+    DspParameters& getParameters() { return params; }
+    const DspParameters& getParameters() const { return params; }
+
+    StageLoads getStageLoads() const;
+    static const char* getStageName(Stage stage);
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+private:
+    using EqBand = juce::dsp::ProcessorDuplicator<juce::dsp::IIR::Filter<float>,
+                                                  juce::dsp::IIR::Coefficients<float>>;
+
+    static constexpr int MaxChannels = 2;
+    static constexpr int SmoothingStep = 64;       // samples between coefficient updates while ramping
+    static constexpr double RampSeconds = 0.05;
+
+    void readParameters();
+    bool processEqualizer(const juce::dsp::AudioBlock<float>& block);
+    bool processWidener(const juce::dsp::AudioBlock<float>& block);
+    bool processLimiter(const juce::dsp::AudioBlock<float>& block);
+    void setEqCoefficients(int band, float gainDb);
+    void recordLoad(Stage stage, juce::int64 ticks, int numSamples);
+
+    juce::AudioSource* wrappedSource;
+    DspParameters params;
+    double currentSampleRate = 44100.0;
+
+    // Audio thread only.
+    std::array<EqBand, DspParameters::NumEqBands> eqBands;
+    std::array<juce::SmoothedValue<float>, DspParameters::NumEqBands> eqGain;
+    std::array<float, DspParameters::NumEqBands> eqAppliedDb {};
+
+    juce::SmoothedValue<float> width;
+
+    juce::dsp::Limiter<float> limiter;
+    bool limiterActive = false;
+
+    std::array<std::atomic<float>, NumStages> stageLoads {};
+};
+
+#endif // DSPCHAIN_H
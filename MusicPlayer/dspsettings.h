@@ -0,0 +1,46 @@
+#ifndef DSPSETTINGS_H
+#define DSPSETTINGS_H
+
+#include <QSettings>
+#include <QString>
+
+#include "dspchain.h"
+
+// -----------------------------------------------------------------------------
+// DspSettings: persists the effect chain's DspParameters in QSettings under
+// "dsp/". Kept out of dspchain.h so the chain itself stays Qt-free.
+// -----------------------------------------------------------------------------
+struct DspSettings
+{
+    static void load(DspParameters& params)
+    {
+        QSettings settings("FractalWave", "FractalWave");
+        params.eqEnabled.store(settings.value("dsp/eqEnabled", false).toBool());
+        for (int b = 0; b < DspParameters::NumEqBands; ++b)
+            params.eqGainDb[b].store(settings.value(QString("dsp/eqGain%1").arg(b), 0.0f).toFloat());
+
+        params.widenerEnabled.store(settings.value("dsp/widenerEnabled", false).toBool());
+        params.stereoWidth.store(settings.value("dsp/stereoWidth", 1.0f).toFloat());
+
+        params.limiterEnabled.store(settings.value("dsp/limiterEnabled", false).toBool());
+        params.limiterThresholdDb.store(settings.value("dsp/limiterThresholdDb", -1.0f).toFloat());
+        params.limiterReleaseMs.store(settings.value("dsp/limiterReleaseMs", 100.0f).toFloat());
+    }
+
+    static void save(const DspParameters& params)
+    {
+        QSettings settings("FractalWave", "FractalWave");
+        settings.setValue("dsp/eqEnabled", params.eqEnabled.load());
+        for (int b = 0; b < DspParameters::NumEqBands; ++b)
+            settings.setValue(QString("dsp/eqGain%1").arg(b), params.eqGainDb[b].load());
+
+        settings.setValue("dsp/widenerEnabled", params.widenerEnabled.load());
+        settings.setValue("dsp/stereoWidth", params.stereoWidth.load());
+
+        settings.setValue("dsp/limiterEnabled", params.limiterEnabled.load());
+        settings.setValue("dsp/limiterThresholdDb", params.limiterThresholdDb.load());
+        settings.setValue("dsp/limiterReleaseMs", params.limiterReleaseMs.load());
+    }
+};
+
+#endif // DSPSETTINGS_H
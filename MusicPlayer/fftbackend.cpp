@@ -0,0 +1,394 @@
+#include "fftbackend.h"
+
+#include <juce_dsp/juce_dsp.h>
+
+#if FRACTALWAVE_HAVE_FFTW
+ #include <fftw3.h>
+#endif
+
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+//============================================================================
+// JuceFft: juce::dsp::FFT as it is.
+class JuceFft : public FftBackend
+{
+public:
+    explicit JuceFft(int fftOrder) : FftBackend(fftOrder), fft(fftOrder) {}
+
+    Kind getKind() const override { return Juce; }
+
+    void performRealForward(float* data) noexcept override
+    {
+        fft.performRealOnlyForwardTransform(data, true);
+    }
+
+private:
+    juce::dsp::FFT fft;
+};
+
+//============================================================================
+// Radix2Fft: the N real samples are read as N/2 complex ones (even samples
+// real, odd imaginary), transformed in place, and the two interleaved
+// spectra are split apart in one pass over bins 0..N/2.
+class Radix2Fft : public FftBackend
+{
+public:
+    explicit Radix2Fft(int fftOrder)
+        : FftBackend(fftOrder),
+        halfSize(juce::jmax(1, getSize() / 2))
+    {
+        const double twoPi = juce::MathConstants<double>::twoPi;
+
+        bitReversed.resize(static_cast<size_t>(halfSize));
+        const int bits = juce::jmax(0, fftOrder - 1);
+        for (int i = 0; i < halfSize; ++i)
+        {
+            int reversed = 0;
+            for (int b = 0; b < bits; ++b)
+                reversed |= ((i >> b) & 1) << (bits - 1 - b);
+            bitReversed[static_cast<size_t>(i)] = reversed;
+        }
+
+        // exp(-2 pi i k / (N/2)) for the butterflies.
+        butterflyCos.resize(static_cast<size_t>(juce::jmax(1, halfSize / 2)));
+        butterflySin.resize(butterflyCos.size());
+        for (size_t k = 0; k < butterflyCos.size(); ++k)
+        {
+            butterflyCos[k] = static_cast<float>(std::cos(twoPi * k / halfSize));
+            butterflySin[k] = static_cast<float>(-std::sin(twoPi * k / halfSize));
+        }
+
+        // exp(-2 pi i k / N) for the split.
+        splitCos.resize(static_cast<size_t>(halfSize / 2 + 1));
+        splitSin.resize(splitCos.size());
+        for (size_t k = 0; k < splitCos.size(); ++k)
+        {
+            splitCos[k] = static_cast<float>(std::cos(twoPi * k / getSize()));
+            splitSin[k] = static_cast<float>(-std::sin(twoPi * k / getSize()));
+        }
+    }
+
+    Kind getKind() const override { return Radix2; }
+
+    void performRealForward(float* data) noexcept override
+    {
+        transformHalfSize(data);
+        split(data);
+    }
+
+private:
+    void transformHalfSize(float* z) noexcept
+    {
+        for (int i = 0; i < halfSize; ++i)
+        {
+            const int j = bitReversed[static_cast<size_t>(i)];
+            if (j > i)
+            {
+                std::swap(z[2 * i], z[2 * j]);
+                std::swap(z[2 * i + 1], z[2 * j + 1]);
+            }
+        }
+
+        for (int length = 2; length <= halfSize; length <<= 1)
+        {
+            const int half = length / 2;
+            const int stride = halfSize / length;
+
+            for (int start = 0; start < halfSize; start += length)
+            {
+                for (int j = 0; j < half; ++j)
+                {
+                    const float wr = butterflyCos[static_cast<size_t>(j * stride)];
+                    const float wi = butterflySin[static_cast<size_t>(j * stride)];
+
+                    float* a = z + 2 * (start + j);
+                    float* b = z + 2 * (start + j + half);
+
+                    const float vr = b[0] * wr - b[1] * wi;
+                    const float vi = b[0] * wi + b[1] * wr;
+
+                    b[0] = a[0] - vr;
+                    b[1] = a[1] - vi;
+                    a[0] += vr;
+                    a[1] += vi;
+                }
+            }
+        }
+    }
+
+    // X[k] = (Z[k] + conj Z[M-k]) / 2 - i W^k (Z[k] - conj Z[M-k]) / 2, with
+    // M = N/2; bins k and M-k are worked out together from the same pair.
+    void split(float* data) noexcept
+    {
+        const float r0 = data[0];
+        const float i0 = data[1];
+
+        for (int k = 1; k <= halfSize / 2; ++k)
+        {
+            const int j = halfSize - k;
+            const float ar = data[2 * k], ai = data[2 * k + 1];
+            const float br = data[2 * j], bi = data[2 * j + 1];
+
+            const float evenRe = 0.5f * (ar + br);
+            const float evenIm = 0.5f * (ai - bi);
+            const float oddRe = 0.5f * (ai + bi);
+            const float oddIm = -0.5f * (ar - br);
+
+            const float wr = splitCos[static_cast<size_t>(k)];
+            const float wi = splitSin[static_cast<size_t>(k)];
+            const float turnedRe = wr * oddRe - wi * oddIm;
+            const float turnedIm = wr * oddIm + wi * oddRe;
+
+            data[2 * k]     = evenRe + turnedRe;
+            data[2 * k + 1] = evenIm + turnedIm;
+            data[2 * j]     = evenRe - turnedRe;
+            data[2 * j + 1] = turnedIm - evenIm;
+        }
+
+        data[0] = r0 + i0;
+        data[1] = 0.0f;
+        data[2 * halfSize] = r0 - i0;
+        data[2 * halfSize + 1] = 0.0f;
+    }
+
+    const int halfSize;
+    std::vector<int> bitReversed;
+    std::vector<float> butterflyCos, butterflySin;
+    std::vector<float> splitCos, splitSin;
+};
+
+#if FRACTALWAVE_HAVE_FFTW
+//============================================================================
+// FftwFft: an r2c plan on FFTW's own aligned buffers. Planning isn't thread
+// safe in FFTW, so it is serialised; executing the plan is.
+class FftwFft : public FftBackend
+{
+public:
+    explicit FftwFft(int fftOrder) : FftBackend(fftOrder)
+    {
+        const int size = getSize();
+        input = fftwf_alloc_real(static_cast<size_t>(size));
+        output = fftwf_alloc_complex(static_cast<size_t>(size / 2 + 1));
+
+        const std::lock_guard<std::mutex> lock(planMutex());
+        plan = fftwf_plan_dft_r2c_1d(size, input, output, FFTW_MEASURE);
+    }
+
+    ~FftwFft() override
+    {
+        {
+            const std::lock_guard<std::mutex> lock(planMutex());
+            fftwf_destroy_plan(plan);
+        }
+        fftwf_free(input);
+        fftwf_free(output);
+    }
+
+    Kind getKind() const override { return Fftw; }
+
+    void performRealForward(float* data) noexcept override
+    {
+        const int size = getSize();
+        std::memcpy(input, data, sizeof(float) * static_cast<size_t>(size));
+        fftwf_execute(plan);
+        std::memcpy(data, output, sizeof(fftwf_complex) * static_cast<size_t>(size / 2 + 1));
+    }
+
+private:
+    static std::mutex& planMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    float* input = nullptr;
+    fftwf_complex* output = nullptr;
+    fftwf_plan plan = nullptr;
+};
+#endif
+
+constexpr int maxOrder = 20;
+
+// The fastest kind + 1 for each order, 0 until measured. Measuring is
+// serialised by fastestMutex; reading what was measured isn't.
+std::mutex fastestMutex;
+std::array<std::atomic<int>, maxOrder + 1> fastestByOrder {};
+std::array<std::atomic<bool>, maxOrder + 1> measuringStarted {};
+
+int getMeasuredFastest(int order)
+{
+    return fastestByOrder[static_cast<size_t>(order)].load(std::memory_order_acquire) - 1;
+}
+
+std::atomic<int> overrideKind { FftBackend::NumKinds };
+} // namespace
+
+const char* FftBackend::getKindName(Kind kind)
+{
+    switch (kind)
+    {
+        case Juce:     return "juce";
+        case Radix2:   return "radix2";
+        case Fftw:     return "fftw";
+        case NumKinds: break;
+    }
+    return "";
+}
+
+bool FftBackend::isAvailable(Kind kind)
+{
+    switch (kind)
+    {
+        case Juce:
+        case Radix2:
+            return true;
+        case Fftw:
+#if FRACTALWAVE_HAVE_FFTW
+            return true;
+#else
+            return false;
+#endif
+        case NumKinds:
+            break;
+    }
+    return false;
+}
+
+std::unique_ptr<FftBackend> FftBackend::create(Kind kind, int order)
+{
+    if (order < 1 || order > maxOrder)
+        return nullptr;
+
+    switch (kind)
+    {
+        case Juce:   return std::make_unique<JuceFft>(order);
+        case Radix2: return std::make_unique<Radix2Fft>(order);
+        case Fftw:
+#if FRACTALWAVE_HAVE_FFTW
+            return std::make_unique<FftwFft>(order);
+#else
+            return nullptr;
+#endif
+        case NumKinds:
+            break;
+    }
+    return nullptr;
+}
+
+//============================================================================
+// measureNanosPerTransform: transform the same noise over and over, restoring
+// the input each time (the transforms work in place), for about secondsToRun.
+double FftBackend::measureNanosPerTransform(Kind kind, int order, double secondsToRun)
+{
+    auto backend = create(kind, order);
+    if (backend == nullptr)
+        return -1.0;
+
+    const int size = backend->getSize();
+    std::vector<float> noise(static_cast<size_t>(size));
+    juce::Random random(0x5eed);
+    for (auto& sample : noise)
+        sample = random.nextFloat() * 2.0f - 1.0f;
+
+    std::vector<float> data(static_cast<size_t>(size * 2), 0.0f);
+    auto runOnce = [&] {
+        std::memcpy(data.data(), noise.data(), sizeof(float) * noise.size());
+        backend->performRealForward(data.data());
+    };
+
+    // Warm the caches and the branch predictors first.
+    for (int i = 0; i < 8; ++i)
+        runOnce();
+
+    const juce::int64 budgetTicks = juce::Time::secondsToHighResolutionTicks(secondsToRun);
+    const juce::int64 startTicks = juce::Time::getHighResolutionTicks();
+    juce::int64 elapsedTicks = 0;
+    juce::int64 transforms = 0;
+
+    do
+    {
+        for (int i = 0; i < 16; ++i)
+            runOnce();
+        transforms += 16;
+        elapsedTicks = juce::Time::getHighResolutionTicks() - startTicks;
+    } while (elapsedTicks < budgetTicks);
+
+    return juce::Time::highResolutionTicksToSeconds(elapsedTicks) * 1.0e9 / static_cast<double>(transforms);
+}
+
+FftBackend::Kind FftBackend::getFastest(int order)
+{
+    const int forced = overrideKind.load(std::memory_order_relaxed);
+    if (forced < NumKinds && isAvailable(static_cast<Kind>(forced)))
+        return static_cast<Kind>(forced);
+
+    if (order < 1 || order > maxOrder)
+        return Juce;
+
+    if (const int measured = getMeasuredFastest(order); measured >= 0)
+        return static_cast<Kind>(measured);
+
+    const std::lock_guard<std::mutex> lock(fastestMutex);
+    if (const int measured = getMeasuredFastest(order); measured >= 0)
+        return static_cast<Kind>(measured);
+
+    Kind fastest = Juce;
+    double fastestNanos = 0.0;
+    juce::String summary;
+
+    for (int k = 0; k < NumKinds; ++k)
+    {
+        const double nanos = measureNanosPerTransform(static_cast<Kind>(k), order);
+        if (nanos < 0.0)
+            continue;
+
+        summary << " " << getKindName(static_cast<Kind>(k)) << " " << juce::String(nanos, 0) << " ns";
+        if (fastestNanos <= 0.0 || nanos < fastestNanos)
+        {
+            fastest = static_cast<Kind>(k);
+            fastestNanos = nanos;
+        }
+    }
+
+    DBG("FFT " << (1 << order) << ":" << summary << " -> " << getKindName(fastest));
+    fastestByOrder[static_cast<size_t>(order)].store(fastest + 1, std::memory_order_release);
+    return fastest;
+}
+
+std::unique_ptr<FftBackend> FftBackend::createFastest(int order)
+{
+    return create(getFastest(order), order);
+}
+
+bool FftBackend::isFastestKnown(int order)
+{
+    const int forced = overrideKind.load(std::memory_order_relaxed);
+    if (forced < NumKinds && isAvailable(static_cast<Kind>(forced)))
+        return true;
+
+    return order < 1 || order > maxOrder || getMeasuredFastest(order) >= 0;
+}
+
+std::unique_ptr<FftBackend> FftBackend::createFastestOrJuce(int order)
+{
+    if (isFastestKnown(order))
+        return createFastest(order);
+
+    // One measurement per size, on a thread of its own.
+    if (!measuringStarted[static_cast<size_t>(order)].exchange(true))
+        juce::Thread::launch([order] { getFastest(order); });
+
+    return create(Juce, order);
+}
+
+void FftBackend::setOverride(Kind kind)
+{
+    overrideKind.store(kind, std::memory_order_relaxed);
+}
@@ -0,0 +1,76 @@
+#ifndef FFTBACKEND_H
+#define FFTBACKEND_H
+
+#include <juce_core/juce_core.h>
+
+#include <memory>
+
+// -----------------------------------------------------------------------------
+// FftBackend: a real-input forward FFT of one fixed power-of-two size, behind
+// which several implementations can sit:
+//
+//   Juce   - juce::dsp::FFT (whatever engine JUCE was built with)
+//   Radix2 - in-tree: the real signal packed as a half-size complex FFT,
+//            iterative radix-2 with precomputed twiddles, then split
+//   Fftw   - FFTW's r2c plans; only when built with FRACTALWAVE_USE_FFTW
+//
+// Which one is fastest depends on the size and the CPU, so getFastest()
+// times every available backend on first use for each size and remembers
+// the winner for the rest of the process. That takes ~20 ms per backend, so
+// code that can't wait for it (the player's analyzer, built on the GUI
+// thread) asks createFastestOrJuce() instead: Juce until the size has been
+// measured on a background thread, the winner once it has.
+//
+// create() allocates and plans; performRealForward() doesn't, so it is safe
+// on the audio thread. One instance must not be used from two threads at once.
+// -----------------------------------------------------------------------------
+class FftBackend
+{
+public:
+    enum Kind { Juce = 0, Radix2, Fftw, NumKinds };
+
+    virtual ~FftBackend() = default;
+
+    virtual Kind getKind() const = 0;
+    int getOrder() const { return order; }
+    int getSize() const { return 1 << order; }
+
+    // data holds 2 * getSize() floats, the first getSize() of them the input.
+    // On return bins 0..getSize()/2 are interleaved re/im pairs, the layout of
+    // juce::dsp::FFT::performRealOnlyForwardTransform(data, true).
+    virtual void performRealForward(float* data) noexcept = 0;
+
+    static const char* getKindName(Kind kind);
+    static bool isAvailable(Kind kind);
+
+    // nullptr if the backend isn't built in.
+    static std::unique_ptr<FftBackend> create(Kind kind, int order);
+
+    // Wall time per transform of this size, in nanoseconds; < 0 if the
+    // backend isn't built in.
+    static double measureNanosPerTransform(Kind kind, int order, double secondsToRun = 0.02);
+
+    // The fastest backend for this size, measured once per process (on the
+    // calling thread, if it hasn't been yet).
+    static Kind getFastest(int order);
+    static std::unique_ptr<FftBackend> createFastest(int order);
+
+    // Doesn't wait: whether getFastest() would answer without measuring.
+    static bool isFastestKnown(int order);
+
+    // Doesn't wait: the fastest backend if it is known, otherwise Juce, with
+    // the size measured on a background thread for the next call.
+    static std::unique_ptr<FftBackend> createFastestOrJuce(int order);
+
+    // Use this backend wherever it is available instead of measuring;
+    // NumKinds goes back to measuring. Affects backends created afterwards.
+    static void setOverride(Kind kind);
+
+protected:
+    explicit FftBackend(int fftOrder) : order(fftOrder) {}
+
+private:
+    const int order;
+};
+
+#endif // FFTBACKEND_H
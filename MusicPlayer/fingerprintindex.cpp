@@ -0,0 +1,336 @@
+#include "fingerprintindex.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <memory>
+
+#include "acousticfingerprint.h"
+#include "threadpolicy.h"
+
+namespace
+{
+constexpr quint32 fingerprintsMagic = 0x46574650;   // "FWFP"
+constexpr quint32 fingerprintsVersion = 2;   // 2: frames timed the same at every rate
+
+// Save what has been fingerprinted every so often, so quitting halfway
+// through a large library doesn't lose it all.
+constexpr int saveEvery = 100;
+
+bool isIndexable(quint32 word)
+{
+    // All-same bits come from silence and flat noise, not from the music.
+    return word != 0 && word != ~quint32(0);
+}
+
+// Whether fingerprintFile() has a reader for the file's format. mp3 and
+// opus have none among JUCE's basic formats; they are left out rather than
+// stored with empty fingerprints.
+bool isDecodable(const juce::AudioFormatManager& formatManager, const QString& filePath)
+{
+    return formatManager.findFormatForFileExtension(QFileInfo(filePath).suffix().toStdString()) != nullptr;
+}
+} // namespace
+
+FingerprintIndex::FingerprintIndex(QObject* parent)
+    : QObject(parent)
+{
+    pool.setMaxThreadCount(1);
+    connect(this, &FingerprintIndex::fingerprinted, this, &FingerprintIndex::onFingerprinted, Qt::QueuedConnection);
+}
+
+bool FingerprintIndex::load(const QString& filePath)
+{
+    entries.clear();
+    postings.clear();
+    slotPaths.clear();
+    freeSlots.clear();
+    ++generation;
+    path = filePath;
+    dirty = false;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0, version = 0;
+    qint32 count = 0;
+    in >> magic >> version >> count;
+    if (magic != fingerprintsMagic || version != fingerprintsVersion || count < 0) {
+        qDebug() << "FingerprintIndex: ignoring" << path << "(written by another version)";
+        return false;
+    }
+
+    for (qint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        QString libraryPath;
+        quint64 quickHash = 0;
+        Words words;
+        in >> libraryPath >> quickHash >> words;
+        if (in.status() == QDataStream::Ok)
+            insert(libraryPath, quickHash, words);
+    }
+    dirty = false;
+
+    if (in.status() != QDataStream::Ok) {
+        qWarning() << "FingerprintIndex: truncated file" << path;
+        return false;
+    }
+
+    qDebug() << "FingerprintIndex: loaded" << entries.size() << "fingerprints";
+    return true;
+}
+
+bool FingerprintIndex::save()
+{
+    if (!dirty || path.isEmpty())
+        return true;
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << fingerprintsMagic << fingerprintsVersion << qint32(entries.size());
+    for (auto it = entries.cbegin(); it != entries.cend(); ++it)
+        out << it.key() << it->quickHash << it->words;
+
+    if (!file.commit()) {
+        qWarning() << "FingerprintIndex: failed to write" << path;
+        return false;
+    }
+
+    dirty = false;
+    return true;
+}
+
+void FingerprintIndex::link(const QString& libraryPath, Entry& entry)
+{
+    if (!freeSlots.isEmpty()) {
+        entry.slot = freeSlots.takeLast();
+        slotPaths[entry.slot] = libraryPath;
+    } else {
+        entry.slot = static_cast<int>(slotPaths.size());
+        slotPaths.append(libraryPath);
+    }
+
+    const quint32 slotBits = quint32(entry.slot) << PositionBits;
+    for (int position = 0; position < entry.words.size(); ++position) {
+        if (isIndexable(entry.words[position]))
+            postings[entry.words[position]].append(slotBits | quint32(position));
+    }
+}
+
+void FingerprintIndex::unlink(const Entry& entry)
+{
+    const quint32 slotBits = quint32(entry.slot) << PositionBits;
+    for (int position = 0; position < entry.words.size(); ++position) {
+        const auto it = postings.find(entry.words[position]);
+        if (it == postings.end())
+            continue;
+        it->removeOne(slotBits | quint32(position));
+        if (it->isEmpty())
+            postings.erase(it);
+    }
+
+    slotPaths[entry.slot].clear();
+    freeSlots.append(entry.slot);
+}
+
+void FingerprintIndex::insert(const QString& libraryPath, quint64 quickHash, const Words& words)
+{
+    remove(libraryPath);
+
+    Entry entry;
+    entry.quickHash = quickHash;
+    entry.words = words.mid(0, MaxWords);
+    link(libraryPath, entry);
+    entries.insert(libraryPath, entry);
+    dirty = true;
+}
+
+void FingerprintIndex::remove(const QString& libraryPath)
+{
+    const auto it = entries.constFind(libraryPath);
+    if (it == entries.cend())
+        return;
+
+    unlink(*it);
+    entries.erase(it);
+    dirty = true;
+}
+
+void FingerprintIndex::sync(const QHash<QString, quint64>& quickHashes)
+{
+    QStringList gone;
+    for (auto it = entries.cbegin(); it != entries.cend(); ++it) {
+        if (quickHashes.value(it.key()) != it->quickHash)
+            gone.append(it.key());
+    }
+    for (const QString& libraryPath : gone)
+        remove(libraryPath);
+
+    if (!resolver)
+        return;
+
+    // Start over: whatever an earlier sync still had queued is in this one too.
+    pool.clear();
+    ++generation;
+    pending = 0;
+
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    const quint64 batch = generation;
+    for (auto it = quickHashes.cbegin(); it != quickHashes.cend(); ++it) {
+        if (it.value() == 0 || entries.contains(it.key()))
+            continue;
+
+        const QString libraryPath = it.key();
+        const quint64 quickHash = it.value();
+        const QString filePath = resolver(libraryPath);
+        if (!isDecodable(formatManager, filePath))
+            continue;
+        ++pending;
+        pool.start([this, batch, libraryPath, quickHash, filePath] {
+            ThreadPolicy::applyIfChanged(ThreadPolicy::Role::Background);
+            emit fingerprinted(batch, libraryPath, quickHash, fingerprintFile(filePath));
+        });
+    }
+
+    if (pending > 0)
+        qDebug() << "FingerprintIndex: fingerprinting" << pending << "files";
+}
+
+void FingerprintIndex::onFingerprinted(quint64 batch, const QString& libraryPath, quint64 quickHash,
+                                       const Words& words)
+{
+    if (batch != generation)
+        return;
+
+    // A file too short to match anything is still recorded, so it isn't
+    // decoded again on every scan.
+    insert(libraryPath, quickHash, words);
+
+    if (--pending > 0) {
+        if (pending % saveEvery == 0)
+            save();
+        return;
+    }
+
+    qDebug() << "FingerprintIndex:" << entries.size() << "fingerprints";
+    if (!save())
+        qWarning() << "FingerprintIndex: failed to save fingerprints";
+    emit fingerprintsChanged();
+}
+
+FingerprintIndex::Words FingerprintIndex::fingerprintFile(const QString& filePath)
+{
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(juce::File(filePath.toStdString())));
+    if (reader == nullptr || reader->sampleRate <= 0.0) {
+        qWarning() << "FingerprintIndex: can't decode" << filePath;
+        return {};
+    }
+
+    const AcousticFingerprint::Words words = AcousticFingerprint::compute(*reader);
+    return Words(words.cbegin(), words.cend());
+}
+
+QVector<FingerprintIndex::Match> FingerprintIndex::findSameRecording(const Words& words, const QString& except) const
+{
+    // Votes per (slot, alignment); the alignment is biased to stay positive.
+    QHash<quint64, int> votes;
+    const int queryWords = std::min(static_cast<int>(words.size()), MaxWords);
+    for (int i = 0; i < queryWords; ++i) {
+        if (!isIndexable(words[i]))
+            continue;
+
+        const auto it = postings.constFind(words[i]);
+        if (it == postings.cend() || it->size() > CommonWordPostings)
+            continue;
+
+        for (quint32 posting : *it) {
+            const quint64 slot = posting >> PositionBits;
+            const int position = static_cast<int>(posting & (MaxWords - 1));
+            ++votes[slot << 32 | quint32(position - i + MaxWords)];
+        }
+    }
+
+    QVector<QPair<int, quint64>> candidates;
+    for (auto it = votes.cbegin(); it != votes.cend(); ++it) {
+        if (it.value() >= MinVotes)
+            candidates.append({ it.value(), it.key() });
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    QVector<Match> matches;
+    for (int c = 0; c < candidates.size() && c < MaxCandidates; ++c) {
+        const int slot = static_cast<int>(candidates[c].second >> 32);
+        const int offset = static_cast<int>(candidates[c].second & 0xffffffffu) - MaxWords;
+        const QString& libraryPath = slotPaths[slot];
+        if (libraryPath == except || std::any_of(matches.cbegin(), matches.cend(), [&libraryPath](const Match& m) {
+                return m.libraryPath == libraryPath;
+            }))
+            continue;
+
+        const Words& stored = entries.value(libraryPath).words;
+        const float bitErrors = AcousticFingerprint::bitErrorRate(words.constData(), static_cast<int>(words.size()),
+                                                                  stored.constData(), static_cast<int>(stored.size()),
+                                                                  offset);
+        if (bitErrors <= AcousticFingerprint::SameRecordingBitErrors)
+            matches.append({ libraryPath, bitErrors, offset });
+    }
+
+    std::sort(matches.begin(), matches.end(), [](const Match& a, const Match& b) { return a.bitErrors < b.bitErrors; });
+    return matches;
+}
+
+QVector<QStringList> FingerprintIndex::sameRecordingGroups() const
+{
+    // Each file joins the group of the first match already in one.
+    QHash<QString, int> groupOf;
+    QVector<QStringList> groups;
+    for (auto it = entries.cbegin(); it != entries.cend(); ++it) {
+        if (groupOf.contains(it.key()))
+            continue;
+
+        const QVector<Match> matches = findSameRecording(it->words, it.key());
+        if (matches.isEmpty())
+            continue;
+
+        int group = -1;
+        for (const Match& match : matches) {
+            if (groupOf.contains(match.libraryPath)) {
+                group = groupOf.value(match.libraryPath);
+                break;
+            }
+        }
+        if (group < 0) {
+            group = static_cast<int>(groups.size());
+            groups.append({});
+        }
+
+        groupOf.insert(it.key(), group);
+        groups[group].append(it.key());
+        for (const Match& match : matches) {
+            if (!groupOf.contains(match.libraryPath)) {
+                groupOf.insert(match.libraryPath, group);
+                groups[group].append(match.libraryPath);
+            }
+        }
+    }
+
+    for (QStringList& group : groups)
+        group.sort(Qt::CaseInsensitive);
+    return groups;
+}
@@ -0,0 +1,125 @@
+#ifndef FINGERPRINTINDEX_H
+#define FINGERPRINTINDEX_H
+
+#include <QHash>
+#include <QObject>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+
+#include <functional>
+
+// -----------------------------------------------------------------------------
+// FingerprintIndex: the acoustic fingerprint (AcousticFingerprint) of every
+// library file, for spotting the same recording in another codec, bitrate
+// or container, which the content hashes can't.
+//
+// Fingerprints are taken in the background, one file at a time (decoding
+// the first minute is the expensive part), and kept on disk keyed by library
+// path. An entry is dropped when the file's quick hash changes. Files in a
+// format JUCE's basic readers can't decode (mp3 and opus) are skipped.
+//
+// Lookups go through an inverted index from fingerprint word to the files
+// and positions holding it. A re-encode keeps a few percent of its words
+// exactly (every bit the same), and all of those agree on one alignment.
+// Votes per (file, alignment) pick out the candidates, and the bit error
+// rate over that alignment confirms them. A lookup costs one hash probe per
+// query word and a handful of comparisons, well under a millisecond for any
+// library size. Words that are in too many files to say anything (silence,
+// mostly) are not looked up.
+//
+// Everything but fingerprinting runs on the GUI thread.
+// -----------------------------------------------------------------------------
+class FingerprintIndex : public QObject
+{
+    Q_OBJECT
+public:
+    using Words = QVector<quint32>;
+    // Library path -> file on disk.
+    using Resolver = std::function<QString(const QString& libraryPath)>;
+
+    struct Match
+    {
+        QString libraryPath;
+        float bitErrors = 1.0f;   // fraction of differing bits once aligned
+        int offset = 0;           // in words
+    };
+
+    // Postings pack the file's slot above the word's position.
+    static constexpr int PositionBits = 12;
+    static constexpr int MaxWords = 1 << PositionBits;
+    static constexpr int CommonWordPostings = 256;
+    static constexpr int MinVotes = 2;
+    static constexpr int MaxCandidates = 8;
+
+    explicit FingerprintIndex(QObject* parent = nullptr);
+
+    // Read the fingerprints file; starts empty if there is none usable.
+    bool load(const QString& filePath);
+    // Write it back if it changed since load() / the last save().
+    bool save();
+    bool isLoaded() const { return !path.isEmpty(); }
+
+    void setResolver(Resolver newResolver) { resolver = std::move(newResolver); }
+
+    // Forget files not in quickHashes (library path -> quick hash) or whose
+    // hash changed, then fingerprint the ones missing (that can be decoded)
+    // in the background.
+    void sync(const QHash<QString, quint64>& quickHashes);
+
+    void insert(const QString& libraryPath, quint64 quickHash, const Words& words);
+    void remove(const QString& libraryPath);
+
+    int size() const { return static_cast<int>(entries.size()); }
+
+    // Library files that sound like words, best match first; `except` is
+    // left out (the file itself, when it is already indexed).
+    QVector<Match> findSameRecording(const Words& words, const QString& except = {}) const;
+
+    // Files that sound alike, two or more to a group.
+    QVector<QStringList> sameRecordingGroups() const;
+
+    // Fingerprint a file (decodes its first minute); empty if unreadable.
+    static Words fingerprintFile(const QString& filePath);
+
+signals:
+    // A sync() finished fingerprinting.
+    void fingerprintsChanged();
+
+    // Internal: one file fingerprinted on the pool.
+    void fingerprinted(quint64 generation, const QString& libraryPath, quint64 quickHash,
+                       const FingerprintIndex::Words& words);
+
+private slots:
+    void onFingerprinted(quint64 generation, const QString& libraryPath, quint64 quickHash,
+                         const FingerprintIndex::Words& words);
+
+private:
+    struct Entry
+    {
+        quint64 quickHash = 0;
+        int slot = -1;
+        Words words;
+    };
+
+    void link(const QString& libraryPath, Entry& entry);
+    void unlink(const Entry& entry);
+
+    Resolver resolver;
+    QString path;
+    bool dirty = false;
+
+    QHash<QString, Entry> entries;
+    QHash<quint32, QVector<quint32>> postings;   // word -> slot << PositionBits | position
+    QVector<QString> slotPaths;                  // slot -> library path; empty if free
+    QVector<int> freeSlots;
+
+    int pending = 0;
+    quint64 generation = 0;
+
+    // Declared last so it is destroyed first, waiting for a fingerprint in
+    // flight while the rest of the object is still there.
+    QThreadPool pool;
+};
+
+#endif // FINGERPRINTINDEX_H
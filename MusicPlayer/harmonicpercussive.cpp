@@ -0,0 +1,164 @@
+#include "harmonicpercussive.h"
+
+#include <algorithm>
+#include <cmath>
+
+void HarmonicPercussiveSeparator::prepare(int fftSize, int harmonicFrames, int percussiveBins)
+{
+    numBins = std::max(1, fftSize / 2 + 1);
+    timeLength = std::max(1, harmonicFrames) | 1;
+    freqLength = std::max(1, percussiveBins) | 1;
+
+    const size_t bins = static_cast<size_t>(numBins);
+    timeRing.assign(bins * static_cast<size_t>(timeLength), 0.0f);
+    timeSorted.assign(bins * static_cast<size_t>(timeLength), 0.0f);
+    freqSorted.assign(static_cast<size_t>(freqLength), 0.0f);
+    magnitude.assign(bins, 0.0f);
+    harmonicMedian.assign(bins, 0.0f);
+    percussiveMedian.assign(bins, 0.0f);
+    harmonic.assign(bins, 0.0f);
+    percussive.assign(bins, 0.0f);
+
+    reset();
+}
+
+void HarmonicPercussiveSeparator::reset()
+{
+    timeIndex = 0;
+    timeCount = 0;
+    std::fill(harmonic.begin(), harmonic.end(), 0.0f);
+    std::fill(percussive.begin(), percussive.end(), 0.0f);
+}
+
+void HarmonicPercussiveSeparator::process(const float* spectrum)
+{
+    if (numBins == 0 || magnitude.empty())
+        return;
+
+    for (int b = 0; b < numBins; ++b)
+    {
+        const float re = spectrum[2 * b];
+        const float im = spectrum[2 * b + 1];
+        magnitude[static_cast<size_t>(b)] = std::sqrt(re * re + im * im);
+    }
+
+    // Harmonic: per bin, median over the last timeLength frames. Until the
+    // window has filled, the new value is inserted; after that it replaces
+    // the value that drops out.
+    const bool filling = timeCount < timeLength;
+    for (int b = 0; b < numBins; ++b)
+    {
+        float* ring = timeRing.data() + static_cast<size_t>(b) * static_cast<size_t>(timeLength);
+        float* sorted = timeSorted.data() + static_cast<size_t>(b) * static_cast<size_t>(timeLength);
+        const float value = magnitude[static_cast<size_t>(b)];
+
+        if (filling)
+            insertSorted(sorted, timeCount, value);
+        else
+            replaceSorted(sorted, timeLength, ring[timeIndex], value);
+        ring[timeIndex] = value;
+    }
+    if (filling)
+        ++timeCount;
+    timeIndex = (timeIndex + 1) % timeLength;
+
+    for (int b = 0; b < numBins; ++b)
+        harmonicMedian[static_cast<size_t>(b)] = medianOf(timeSorted.data() + static_cast<size_t>(b) * static_cast<size_t>(timeLength),
+                                                          timeCount);
+
+    // Percussive: median over the bins around each one, the window sliding
+    // up the frame (and shrinking at its ends).
+    const int half = freqLength / 2;
+    int count = 0;
+    for (int k = 0; k <= half && k < numBins; ++k)
+        insertSorted(freqSorted.data(), count++, magnitude[static_cast<size_t>(k)]);
+
+    for (int b = 0; b < numBins; ++b)
+    {
+        percussiveMedian[static_cast<size_t>(b)] = medianOf(freqSorted.data(), count);
+
+        const int leaving = b - half;
+        const int entering = b + 1 + half;
+        if (leaving >= 0 && entering < numBins)
+        {
+            replaceSorted(freqSorted.data(), count, magnitude[static_cast<size_t>(leaving)],
+                          magnitude[static_cast<size_t>(entering)]);
+        }
+        else if (leaving >= 0)
+        {
+            eraseSorted(freqSorted.data(), count--, magnitude[static_cast<size_t>(leaving)]);
+        }
+        else if (entering < numBins)
+        {
+            insertSorted(freqSorted.data(), count++, magnitude[static_cast<size_t>(entering)]);
+        }
+    }
+
+    // Wiener masks: each part gets the share of the bin its median's power has.
+    for (int b = 0; b < numBins; ++b)
+    {
+        const size_t i = static_cast<size_t>(b);
+        const float h = harmonicMedian[i] * harmonicMedian[i];
+        const float p = percussiveMedian[i] * percussiveMedian[i];
+        const float total = h + p;
+        const float harmonicShare = total > 1.0e-20f ? h / total : 0.5f;
+
+        harmonic[i] = magnitude[i] * harmonicShare;
+        percussive[i] = magnitude[i] - harmonic[i];
+    }
+}
+
+//============================================================================
+// Sorted windows. `count` is the number of values in the window before the
+// call; the caller keeps track of the new count.
+
+void HarmonicPercussiveSeparator::insertSorted(float* sorted, int count, float value)
+{
+    float* position = std::upper_bound(sorted, sorted + count, value);
+    std::move_backward(position, sorted + count, sorted + count + 1);
+    *position = value;
+}
+
+void HarmonicPercussiveSeparator::eraseSorted(float* sorted, int count, float value)
+{
+    float* position = std::lower_bound(sorted, sorted + count, value);
+    if (position == sorted + count)
+        --position;
+    std::move(position + 1, sorted + count, position);
+}
+
+// Swap one value for another in a full window, shifting only the values that
+// lie between the two.
+void HarmonicPercussiveSeparator::replaceSorted(float* sorted, int count, float oldValue, float newValue)
+{
+    int i = static_cast<int>(std::lower_bound(sorted, sorted + count, oldValue) - sorted);
+    if (i >= count)
+        i = count - 1;
+
+    if (newValue >= oldValue)
+    {
+        while (i + 1 < count && sorted[i + 1] < newValue)
+        {
+            sorted[i] = sorted[i + 1];
+            ++i;
+        }
+    }
+    else
+    {
+        while (i > 0 && sorted[i - 1] > newValue)
+        {
+            sorted[i] = sorted[i - 1];
+            --i;
+        }
+    }
+    sorted[i] = newValue;
+}
+
+float HarmonicPercussiveSeparator::medianOf(const float* sorted, int count)
+{
+    if (count <= 0)
+        return 0.0f;
+    if ((count & 1) != 0)
+        return sorted[count / 2];
+    return 0.5f * (sorted[count / 2 - 1] + sorted[count / 2]);
+}
@@ -0,0 +1,73 @@
+#ifndef HARMONICPERCUSSIVE_H
+#define HARMONICPERCUSSIVE_H
+
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// HarmonicPercussiveSeparator: median-filter harmonic/percussive separation
+// (HPSS) of a stream of STFT frames, one frame at a time.
+//
+// Sustained tones are steady along time in their bin; drum hits are smeared
+// across frequency in their frame. So per bin, the median over the last
+// harmonicFrames frames estimates the harmonic part, and per frame, the
+// median over percussiveBins neighbouring bins the percussive part. Soft
+// (Wiener) masks built from the two split each new frame's magnitudes.
+//
+// Only the frames inside the time window are kept (the history is bounded).
+// Both medians are sliding: each bin keeps its window sorted and swaps the
+// oldest value for the newest in place, and the frequency median walks up
+// the frame dropping one bin and adding one per step. Each frame therefore
+// costs O(bins * window), linear in bins, with no sorting from scratch.
+//
+// prepare() allocates; process() doesn't, so it is safe on the audio thread.
+// The time median only looks back, so harmonic content shows up about half a
+// window late; percussive content is judged within the frame.
+// -----------------------------------------------------------------------------
+class HarmonicPercussiveSeparator
+{
+public:
+    // Frames of fftSize points (fftSize / 2 + 1 bins). Both window lengths
+    // are made odd.
+    void prepare(int fftSize, int harmonicFrames, int percussiveBins);
+
+    // Forget the history.
+    void reset();
+
+    // Split one frame: interleaved re/im for bins 0..fftSize/2, the output
+    // of FftBackend::performRealForward().
+    void process(const float* spectrum);
+
+    int getNumBins() const { return numBins; }
+
+    // Magnitudes of the last frame, split (getNumBins() each).
+    const std::vector<float>& getHarmonic() const { return harmonic; }
+    const std::vector<float>& getPercussive() const { return percussive; }
+
+private:
+    // Small sorted windows, kept in caller-owned storage.
+    static void insertSorted(float* sorted, int count, float value);
+    static void replaceSorted(float* sorted, int count, float oldValue, float newValue);
+    static void eraseSorted(float* sorted, int count, float value);
+    static float medianOf(const float* sorted, int count);
+
+    int numBins = 0;
+    int timeLength = 1;
+    int freqLength = 1;
+
+    // Time median: per bin, the last timeLength magnitudes in arrival order
+    // (a ring sharing one write index) and the same values sorted.
+    std::vector<float> timeRing;
+    std::vector<float> timeSorted;
+    int timeIndex = 0;
+    int timeCount = 0;
+
+    std::vector<float> freqSorted;   // frequency median window
+    std::vector<float> magnitude;    // current frame
+    std::vector<float> harmonicMedian;
+    std::vector<float> percussiveMedian;
+
+    std::vector<float> harmonic;
+    std::vector<float> percussive;
+};
+
+#endif // HARMONICPERCUSSIVE_H
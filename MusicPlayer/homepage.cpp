@@ -1,15 +1,54 @@
 #include <QDir>
+#include <QHash>
 #include <QRandomGenerator>
 #include <qevent.h>
 #include <QInputDialog>
 #include <QMessageBox>
 
+#include <functional>
+
 #include "homepage.h"
 #include "ui_homepage.h"
 #include "helper/qsshelper.h"
 #include "helper/delegatehelper.h"
 #include "centeredicondelegate.h".h"
 
+namespace
+{
+// Bring list's rows in line with names (one row per name, in order, text is
+// the name), touching only rows that come or go: the rest keep their item,
+// with its roles, and the list keeps its scroll position. Returns whether
+// anything changed.
+bool syncRows(QListWidget* list, const QStringList& names,
+              const std::function<QListWidgetItem*(const QString&)>& makeItem)
+{
+    QHash<QString, int> wanted;
+    for (const QString& name : names)
+        ++wanted[name];
+
+    bool changed = false;
+    int row = 0;
+    for (const QString& name : names) {
+        while (row < list->count() && wanted.value(list->item(row)->text()) == 0) {
+            delete list->takeItem(row);
+            changed = true;
+        }
+        if (row < list->count() && list->item(row)->text() == name) {
+            ++row;
+        } else {
+            list->insertItem(row++, makeItem(name));
+            changed = true;
+        }
+        --wanted[name];
+    }
+    while (row < list->count()) {
+        delete list->takeItem(row);
+        changed = true;
+    }
+    return changed;
+}
+} // namespace
+
 
 HomePage::HomePage(QWidget *parent, MediaController *externalMediaController)
     : QWidget(parent)
@@ -81,6 +120,30 @@ HomePage::HomePage(QWidget *parent, MediaController *externalMediaController)
     connect(mediaController, &MediaController::paused, this, &HomePage::handlePause);
     connect(mediaController, &MediaController::playing, this, &HomePage::handleResume);
 
+    // The library is scanned in the background: items point at tracks that
+    // are filled in batch by batch, so repaint as batches land and rebuild
+    // the lists once the folder has been seen in full.
+    LibraryManager& lm = LibraryManager::instance().libraryManager();
+    const auto repaintLists = [this]() {
+        ui->currentTracklist->viewport()->update();
+        ui->listOfTracks->viewport()->update();
+        ui->listOfFavourites->viewport()->update();
+    };
+    connect(&lm, &LibraryManager::tracksScanned, this, repaintLists);
+    connect(&lm, &LibraryManager::scanFinished, this, [this](bool cancelled) {
+        if (!cancelled)
+            reconcileLists();
+    });
+    // Cover thumbnails are made in the background, too.
+    connect(&lm, &LibraryManager::coverArtReady, this, repaintLists);
+    // Tracks added or removed behind our back (or by a download).
+    // Only their rows come and go; the queue keeps its place and the open
+    // playlist stays open.
+    connect(&lm, &LibraryManager::tracksAdded, this, &HomePage::reconcileLists);
+    connect(&lm, &LibraryManager::tracksRemoved, this, &HomePage::reconcileLists);
+    // Retagged files keep their handles; only what is painted changes.
+    connect(&lm, &LibraryManager::tracksChanged, this, repaintLists);
+
     // Define the path to your music folder
     if (mediaController) {
         mediaController->setTracklist(ui->currentTracklist);
@@ -167,35 +230,86 @@ HomePage::HomePage(QWidget *parent, MediaController *externalMediaController)
 
 void HomePage::refreshUI()
 {
-    // 1) Rescan disk & rebuild master playlists
-    LibraryManager& lm = LibraryManager::instance().libraryManager();
-    lm.scanDirectory();
-
-    // 2) Hide any open panels/forms
+    // 1) Hide any open panels/forms
     if (addContentForm)    addContentForm->hide();
     if (playListPanel)     playListPanel->hide();
     if (overlay_)          overlay_->hide();
 
-    // 3) Clear all lists
-    ui->currentTracklist->clear();
-    ui->listOfPlaylists->clear();
-    ui->listOfTracks->clear();
+    // 2) Bring the lists in line with the playlists JSON (LibraryManager
+    //    keeps it and the master playlist up to date; a rescan, if one is
+    //    running, does this again when it finishes)
+    reconcileLists();
+}
 
-    // 4) Repopulate the “Queue” (current tracks) tab
+void HomePage::reconcileLists()
+{
+    LibraryManager& lm = LibraryManager::instance().libraryManager();
+    const QSet<QString> favourites = favouriteNames();
+
+    // 1) The queue: only rows that came or went change. The media
+    //    controller's copy is rebuilt (its tracks pick up the tags read since)
+    //    and keeps its place on the current track
     const QString last = lm.getLastPlaylistPlayed();
-    displayQueueTab(last);
-    if (mediaController) {
+    syncRows(ui->currentTracklist, lm.getTracksFromPlaylist(last),
+             [&](const QString& name) { return makeTrackItem(name, QString(), favourites); });
+    if (mediaController)
         mediaController->initializePlaylist(last);
+
+    // 2) The “Playlists” tab
+    QStringList playlists = lm.getPlaylistNames();
+    playlists.removeAll("Favourites");
+    syncRows(ui->listOfPlaylists, playlists, [](const QString& name) { return new QListWidgetItem(name); });
+
+    // 3) Whichever playlist is open stays open, unless it is gone
+    if (!playlists.contains(shownPlaylist)) {
+        shownPlaylist = "All Songs";
+        ui->listOfTracks->clear();
     }
+    syncRows(ui->listOfTracks, lm.getTracksFromPlaylist(shownPlaylist),
+             [&](const QString& name) { return makeTrackItem(name, shownPlaylist, favourites); });
 
-    // 5) Repopulate the “Playlists” tab
-    displayPlaylistTab();
+    // 4) “Favorites”
+    syncRows(ui->listOfFavourites, lm.getTracksFromPlaylist("Favourites"),
+             [&](const QString& name) { return makeTrackItem(name, QString(), favourites); });
 
-    QDir musicDir(LibraryManager::instance().libraryManager().getCurrentMusicDirectory());
-    displayListOfTracks(musicDir, "All Songs");
+    // 5) Rows that stayed may have been (un)favourited meanwhile
+    for (QListWidget* list : { ui->currentTracklist, ui->listOfTracks }) {
+        for (int i = 0; i < list->count(); ++i)
+            list->item(i)->setData(IsFavouriteRole, favourites.contains(list->item(i)->text().toLower()));
+    }
 
-    // 6) Repopulate “Favorites” if you have that page
-    displayFavouritesTab();
+    // 6) New rows know nothing of what is playing
+    const QString playing = mediaController
+                                ? mediaController->getAudioPlayback()->getCurrentTrackPath()
+                                : QString();
+    if (!playing.isEmpty()) {
+        syncPlayingHighlight(playing);
+        syncPlayIcons(mediaController->isPlaying());
+    }
+}
+
+QSet<QString> HomePage::favouriteNames() const
+{
+    // Lower-cased, as isTrackFavourite() compares them.
+    QSet<QString> favourites;
+    for (const QString& name : LibraryManager::instance().libraryManager().getTracksFromPlaylist("Favourites"))
+        favourites.insert(name.toLower());
+    return favourites;
+}
+
+QListWidgetItem* HomePage::makeTrackItem(const QString& trackName, const QString& playlistName,
+                                         const QSet<QString>& favourites) const
+{
+    QListWidgetItem *item = new QListWidgetItem(trackName);
+    // Save the track's handle for later retrieval
+    const QString filePath = LibraryManager::instance().resolveTrackPath(trackName);
+    const TrackHandle handle = LibraryManager::instance().libraryManager().getTrackFromMasterPlaylist(filePath);
+    item->setData(Qt::UserRole, QVariant::fromValue(handle));
+    if (!playlistName.isEmpty())
+        item->setData(PlaylistRole, playlistName);
+    item->setData(IsPlayingRole, false);
+    item->setData(IsFavouriteRole, favourites.contains(trackName.toLower()));
+    return item;
 }
 
 void HomePage::overflowActionForTrack(const QModelIndex& index, const OverflowCommand action, const QString& trackName)
@@ -345,6 +459,11 @@ void HomePage::handleResume(const QString& trackPath)
 
     toggleDelegatePlayIcon(mediaController, ui->currentTracklist, true);
     toggleDelegatePlayIcon(mediaController, ui->listOfTracks, true);
+
+    // Tracks load asynchronously, so the highlight can only follow once the
+    // new track is actually playing.
+    syncPlayingHighlight(trackPath);
+    syncPlayIcons(true);
 }
 
 HomePage::~HomePage()
@@ -355,27 +474,15 @@ HomePage::~HomePage()
 void HomePage::displayQueueTab(const QString& playlistName){
     LibraryManager::instance().libraryManager().setLastPlaylistPlayed(playlistName);
 
-    QDir musicDir(LibraryManager::instance().libraryManager().getCurrentMusicDirectory());
-
     // Get the list of file names
     qDebug() << "playlistName in displayQueueTab()" << playlistName;
     QStringList trackNames = LibraryManager::instance().getTracksFromPlaylist(playlistName);
     qDebug() << "trackNames in displayQueueTab():" << trackNames;
 
-    // For each track, create an item with the track name and attach the full file path
-    for (const QString &trackName : trackNames) {
-        QListWidgetItem *item = new QListWidgetItem(trackName);
-        // Save the absolute file path for later retrieval
-        QString filePath = musicDir.absoluteFilePath(trackName);
-        Track *track = LibraryManager::instance().libraryManager().getTrackFromMasterPlaylist(filePath);
-        item->setData(Qt::UserRole, QVariant::fromValue(track));
-        item->setData(IsPlayingRole, false);
-
-        bool isFavourite = LibraryManager::instance().libraryManager().isTrackFavourite(track);
-        item->setData(IsFavouriteRole, isFavourite);
-
-        ui->currentTracklist->addItem(item);
-    }
+    // For each track, create an item with the track name and attach its handle
+    const QSet<QString> favourites = favouriteNames();
+    for (const QString &trackName : trackNames)
+        ui->currentTracklist->addItem(makeTrackItem(trackName, QString(), favourites));
 }
 
 void HomePage::displayPlaylistTab(){
@@ -395,17 +502,11 @@ void HomePage::displayFavouritesTab()
 {
     ui->listOfFavourites->clear();
     QStringList favouritesList = LibraryManager::instance().libraryManager().getTracksFromPlaylist("Favourites");
-    QDir musicDir(LibraryManager::instance().libraryManager().getCurrentMusicDirectory());
 
+    const QSet<QString> favourites = favouriteNames();
     for (const QString& favouriteTrack : favouritesList) {
-        QListWidgetItem *item = new QListWidgetItem(favouriteTrack);
         qDebug() << "favouriteTrack in displayPlaylistTab():" << favouriteTrack;
-
-        QString filePath = musicDir.absoluteFilePath(favouriteTrack);
-        Track *track = LibraryManager::instance().libraryManager().getTrackFromMasterPlaylist(filePath);
-        item->setData(Qt::UserRole, QVariant::fromValue(track));
-        item->setData(IsPlayingRole, false);
-        ui->listOfFavourites->addItem(item);
+        ui->listOfFavourites->addItem(makeTrackItem(favouriteTrack, QString(), favourites));
     }
 }
 
@@ -446,11 +547,11 @@ void HomePage::syncPlayingHighlight(const QString& playingPath)
         auto* mdl = list->model();
         for(int i = 0; i < list->count(); ++i) {
             QListWidgetItem* item = list->item(i);
-            // --- pull Track* out of the QVariant ---
-            Track* track = qvariant_cast<Track*>( item->data(Qt::UserRole) );
+            // --- resolve the item's TrackHandle; null once the file is gone ---
+            const QString trackPath = LibraryManager::instance().getTrackPath(item->data(Qt::UserRole).value<TrackHandle>());
             bool isPlay = false;
-            if (track) {
-                QString path = canonical(track->filePath);
+            if (!trackPath.isEmpty()) {
+                QString path = canonical(trackPath);
                 isPlay = (path == target);
             }
             QModelIndex ix = mdl->index(i, 0);
@@ -473,10 +574,10 @@ void HomePage::syncPlayIcons(bool isPlaying)
     auto syncList = [&](QListWidget* list) {
         for (int i = 0; i < list->count(); ++i) {
             QListWidgetItem* item = list->item(i);
-            Track* track = item->data(Qt::UserRole).value<Track*>();
-            if (!track) continue;
+            const QString trackPath = LibraryManager::instance().getTrackPath(item->data(Qt::UserRole).value<TrackHandle>());
+            if (trackPath.isEmpty()) continue;
 
-            bool match = QFileInfo(track->filePath).canonicalFilePath() ==
+            bool match = QFileInfo(trackPath).canonicalFilePath() ==
                          QFileInfo(playingPath).canonicalFilePath();
             item->setData(IsPlayingRole, match && isPlaying);
         }
@@ -491,15 +592,15 @@ void HomePage::syncPlayIcons(bool isPlaying)
 void HomePage::handleFromCurrentTrackList(int row)
 {
     auto* item = ui->currentTracklist->item(row);
-    Track* track = qvariant_cast<Track*>( item->data(Qt::UserRole) );
-    if (!track) return;
+    const QString trackPath = LibraryManager::instance().getTrackPath(item->data(Qt::UserRole).value<TrackHandle>());
+    if (trackPath.isEmpty()) return;
 
     if (!mediaController->loadAndPlayTrack(row)) {
         qDebug() << "Failed to load/play track at" << row;
     }
 
     // now sync the highlight across all lists
-    syncPlayingHighlight(track->filePath);
+    syncPlayingHighlight(trackPath);
     syncPlayIcons(mediaController->isPlaying());
 
     toggleDelegatePlayIcon(mediaController, ui->currentTracklist, mediaController->isPlaying());
@@ -524,8 +625,8 @@ void HomePage::handleFromCurrentTrackList(int row)
 void HomePage::handleFromListOfTracks(int row)
 {
     auto* item = ui->listOfTracks->item(row);
-    Track* track = qvariant_cast<Track*>( item->data(Qt::UserRole) );
-    if (!track) return;
+    const QString trackPath = LibraryManager::instance().getTrackPath(item->data(Qt::UserRole).value<TrackHandle>());
+    if (trackPath.isEmpty()) return;
 
     ui->currentTracklist->clear();
     QString playlistName = ui->listOfTracks->item(row)->data(PlaylistRole).toString();
@@ -537,7 +638,7 @@ void HomePage::handleFromListOfTracks(int row)
         qDebug() << "Failed to load selected track.";
     }
 
-    syncPlayingHighlight(track->filePath);
+    syncPlayingHighlight(trackPath);
     syncPlayIcons(mediaController->isPlaying());
 
     toggleDelegatePlayIcon(mediaController, ui->listOfTracks, mediaController->isPlaying());
@@ -562,8 +663,8 @@ void HomePage::handleFromListOfTracks(int row)
 void HomePage::handleFromFavourites(int row)
 {
     auto* item = ui->listOfFavourites->item(row);
-    Track* track = qvariant_cast<Track*>( item->data(Qt::UserRole) );
-    if (!track) return;
+    const QString trackPath = LibraryManager::instance().getTrackPath(item->data(Qt::UserRole).value<TrackHandle>());
+    if (trackPath.isEmpty()) return;
 
     QString playlistName = "Favourites";
     mediaController->initializePlaylist(playlistName);
@@ -573,7 +674,7 @@ void HomePage::handleFromFavourites(int row)
         qDebug() << "Failed to load selected track.";
     }
 
-    syncPlayingHighlight(track->filePath);
+    syncPlayingHighlight(trackPath);
     syncPlayIcons(mediaController->isPlaying());
 
     toggleDelegatePlayIcon(mediaController, ui->listOfFavourites, mediaController->isPlaying());
@@ -598,29 +699,21 @@ void HomePage::handleFromFavourites(int row)
 void HomePage::playlistItemClicked(const QModelIndex& idx)
 {
     QListWidgetItem *item = ui->listOfPlaylists->item(idx.row());
-    QDir musicDir(LibraryManager::instance().libraryManager().getCurrentMusicDirectory());
 
     ui->listOfTracks->setVisible(true);
     ui->listOfTracks->clear();
 
-    displayListOfTracks(musicDir, item->text());
+    displayListOfTracks(item->text());
 }
 
-void HomePage::displayListOfTracks(QDir musicDir, QString playlistName)
+void HomePage::displayListOfTracks(QString playlistName)
 {
+    shownPlaylist = playlistName;
+
     QStringList tracks = LibraryManager::instance().getTracksFromPlaylist(playlistName);
-    for (const QString& trackName : tracks) {
-        QListWidgetItem *trackItem = new QListWidgetItem(trackName);
-        QString filePath = musicDir.absoluteFilePath(trackName);
-        Track *track = LibraryManager::instance().libraryManager().getTrackFromMasterPlaylist(filePath);
-        trackItem->setData(Qt::UserRole, QVariant::fromValue(track));
-        trackItem->setData(PlaylistRole, playlistName);
-        trackItem->setData(IsPlayingRole, false);
-
-        bool isFavourite = LibraryManager::instance().libraryManager().isTrackFavourite(track);
-        trackItem->setData(IsFavouriteRole, isFavourite);
-        ui->listOfTracks->addItem(trackItem);
-    }
+    const QSet<QString> favourites = favouriteNames();
+    for (const QString& trackName : tracks)
+        ui->listOfTracks->addItem(makeTrackItem(trackName, playlistName, favourites));
 
     // —————————————
     // New: highlight current track if it exists in this list
@@ -637,12 +730,12 @@ void HomePage::onFavouritesIconClicked(const QModelIndex& index)
 {
     if (!index.isValid()) return;
 
-    Track* track = qvariant_cast<Track*>(index.data(Qt::UserRole));
-    if (!track) return;
+    const QString trackPath = LibraryManager::instance().getTrackPath(index.data(Qt::UserRole).value<TrackHandle>());
+    if (trackPath.isEmpty()) return;
 
-    bool isCurrentlyFavourite = LibraryManager::instance().isTrackFavourite(track);
+    bool isCurrentlyFavourite = LibraryManager::instance().isTrackFavourite(trackPath);
 
-    QString trackFileName = QFileInfo(track->filePath).fileName();
+    QString trackFileName = LibraryManager::instance().toLibraryPath(trackPath);
     // Toggle logic
     if (isCurrentlyFavourite) {
         LibraryManager::instance().libraryManager().delTrackFromPlaylist("Favourites", trackFileName);
@@ -1,6 +1,7 @@
 #ifndef HOMEPAGE_H
 #define HOMEPAGE_H
 
+#include <QSet>
 #include <QWidget>
 #include <qdir.h>
 #include <qlistwidget.h>
@@ -57,7 +58,12 @@ private:
     void displayQueueTab(const QString &playlistName);
     void displayPlaylistTab();
     void displayFavouritesTab();
-    void displayListOfTracks(QDir musicDir, QString playlistName);
+    void displayListOfTracks(QString playlistName);
+    void reconcileLists();
+
+    QSet<QString> favouriteNames() const;
+    QListWidgetItem* makeTrackItem(const QString& trackName, const QString& playlistName,
+                                   const QSet<QString>& favourites) const;
 
     bool addToPlaylist(const QStringList &trackPathsList);
     void onPlaylistSelected(const QString& playlistName);
@@ -75,6 +81,9 @@ private:
 
     DisplayPlaylists *playListPanel;
 
+    // The playlist listOfTracks shows.
+    QString shownPlaylist = "All Songs";
+
     void syncPlayingHighlight(const QString& playingPath);
     void syncPlayIcons(bool isPlaying);
     void onFavouritesIconClicked(const QModelIndex& index);
@@ -6,26 +6,83 @@
 #include <QJsonObject>
 #include <QProcess>
 #include <QFile>
+#include <QFileInfo>
 #include <QDateTime>
+#include <QElapsedTimer>
 #include <QMessageBox>
 #include <QRegularExpression>
+#include <QSet>
 
 #include "helper/directoryhelper.h"
+#include "avmetadatareader.h"
+#include "contenthasher.h"
 #include "librarymanager.h"
 
 LibraryManager::LibraryManager(QObject *parent)
     : QObject{parent},
-    masterPlaylist(nullptr),
     settings("FractalWave", "FractalWave")
 {
-    masterPlaylist = new Playlist("All Songs");
     // ensure the file exists at startup
     ensurePlaylistsFileExists();
 
     // Ensure we have tool paths
     if (ffmpegPath_.isEmpty()) ffmpegPath_ = findExecutableInAppDir("ffmpeg/bin", "ffmpeg.exe");
-    if (ffprobePath_.isEmpty()) ffprobePath_ = findExecutableInAppDir("ffmpeg/bin", "ffprobe.exe");
     if (ytdlpPath_.isEmpty())  ytdlpPath_  = findExecutableInAppDir("yt-dlp", "yt-dlp.exe");
+
+    // Metadata is read on the scanner's threads; the results come back here
+    // (queued) on the GUI thread. Files whose size and mtime haven't changed
+    // since they were last read come straight from the cache.
+    scanner.setExtractor([this](const QFileInfo& file, const QString& libraryPath) {
+        const qint64 size = file.size();
+        const qint64 modifiedMs = file.lastModified().toMSecsSinceEpoch();
+
+        Track track;
+        if (metadataCache.lookup(libraryPath, size, modifiedMs, track))
+            return track;
+
+        track = extractMetadataForTrack(file.absoluteFilePath());
+        metadataCache.store(libraryPath, size, modifiedMs, track);
+        return track;
+    });
+    connect(&scanner, &LibraryScanner::batchReady, this, &LibraryManager::onScanBatch);
+    connect(&scanner, &LibraryScanner::finished, this, &LibraryManager::onScanFinished);
+    connect(&scanner, &LibraryScanner::progress, this, [this](quint64 scanId, int done, int found) {
+        if (scanId == activeScanId)
+            emit scanProgress(done, found);
+    });
+
+    // Copies of a track, by audio content. Hashes taken to settle them are
+    // cached with the rest of the track's metadata.
+    contentIndex.setResolver([this](const QString& libraryPath) { return resolveTrackPath(libraryPath); });
+    connect(&contentIndex, &ContentIndex::contentHashed, this, [this](const QString& libraryPath, quint64 contentHash) {
+        metadataCache.setContentHash(libraryPath, contentHash);
+        masterTracks.setContentHash(masterTracks.find(resolveTrackPath(libraryPath)), contentHash);
+    });
+    connect(&contentIndex, &ContentIndex::duplicatesChanged, this, [this] {
+        qDebug() << "Duplicate tracks:" << contentIndex.duplicateGroups().size() << "groups";
+        if (!metadataCache.save())
+            qWarning() << "duplicatesChanged: failed to save metadata cache";
+        emit duplicatesChanged();
+    });
+
+    // Same recording, different bytes; see getSameRecordingGroups().
+    fingerprintIndex.setResolver([this](const QString& libraryPath) { return resolveTrackPath(libraryPath); });
+    connect(&fingerprintIndex, &FingerprintIndex::fingerprintsChanged, this, &LibraryManager::duplicatesChanged);
+
+    // Cover art, by picture; tracks hold its key (artHash).
+    artStore.setDirectory(artDirectoryPath());
+    connect(&artStore, &ArtStore::thumbnailsReady, this, &LibraryManager::coverArtReady);
+
+    // Between scans, changes made to the folder behind our back.
+    connect(&watcher, &LibraryWatcher::filesChanged, this, &LibraryManager::onLibraryFilesChanged);
+
+    // Don't keep the pool busy with a scan nobody will see.
+    connect(qApp, &QCoreApplication::aboutToQuit, this, [this] {
+        scanner.cancel();
+        scanner.waitForDone();
+        artStore.waitForDone();
+        fingerprintIndex.save();
+    });
 }
 
 bool LibraryManager::scanDirectory()
@@ -33,25 +90,273 @@ bool LibraryManager::scanDirectory()
     qDebug() << "Scanning directory";
 
     QString dir;
-    if (!readMusicFolder(dir))
+    if (!readMusicFolder(dir) || !validateDirectory(dir))
+        return false;
 
     currentMusicDirectory = dir;
     settings.setValue("musicFolder", dir);
+    libraryRoots = readLibraryRoots(dir);
+
+    if (!metadataCache.isLoaded())
+        metadataCache.load(metadataCacheFilePath());
+    if (!fingerprintIndex.isLoaded())
+        fingerprintIndex.load(fingerprintsFilePath());
+    if (watcher.getRoots() != libraryRoots)
+        watcher.watch(libraryRoots);
+
+    // 1) Walk every root and extract metadata on the worker pool (the
+    //    watcher is already collecting changes, against the listing the
+    //    scan hands it when it is done);
+    // 2) the playlists JSON is pruned once the scan has seen every file
+    //    (onScanFinished).
+    activeScanId = scanner.start(libraryRoots);
+    emit scanStarted();
+    return true;
+}
 
+void LibraryManager::cancelScan()
+{
+    scanner.cancel();
+}
 
-    // 2) Prune per‑saved playlists JSON
-    QJsonObject root;
-    if (loadJson(root)) {
-        // 1) Gather audio files and populate master playlist
-        QStringList fileList = listAudioFiles(dir);
-        if (!populateMasterPlaylist(fileList, root))
-            return false;
+QVector<LibraryRoot> LibraryManager::readLibraryRoots(const QString& primaryDir)
+{
+    QVector<LibraryRoot> roots;
+
+    LibraryRoot primary;
+    primary.path = primaryDir;
+    primary.include = settings.value("library/include").toStringList();
+    primary.exclude = settings.value("library/exclude").toStringList();
+    roots.append(primary);
+
+    // An extra root whose disk isn't mounted is kept: the scan finds nothing
+    // there, so its tracks drop out of "All Songs" until the disk comes back,
+    // but prunePlaylists() leaves them in the other playlists.
+    const int count = settings.beginReadArray("library/roots");
+    for (int i = 0; i < count; ++i) {
+        settings.setArrayIndex(i);
+        LibraryRoot root;
+        root.id = settings.value("id").toString();
+        root.path = settings.value("path").toString();
+        root.include = settings.value("include").toStringList();
+        root.exclude = settings.value("exclude").toStringList();
+        if (root.id.isEmpty() || root.path.isEmpty()) {
+            qWarning() << "Skipping malformed library root" << i;
+            continue;
+        }
+        if (!QDir(root.path).exists())
+            qDebug() << "Library root not available:" << root.id << root.path;
+        roots.append(root);
+    }
+    settings.endArray();
+
+    for (LibraryRoot& root : roots)
+        root.compileGlobs();
+    return roots;
+}
 
-        prunePlaylists(root, dir);
+bool LibraryManager::setLibraryRoots(const QVector<LibraryRoot>& roots)
+{
+    if (roots.isEmpty() || !roots.first().isPrimary())
+        return false;
+
+    const LibraryRoot& primary = roots.first();
+    settings.setValue("musicFolder", primary.path);
+    settings.setValue("library/include", primary.include);
+    settings.setValue("library/exclude", primary.exclude);
+
+    settings.beginWriteArray("library/roots", static_cast<int>(roots.size() - 1));
+    for (int i = 1; i < roots.size(); ++i) {
+        settings.setArrayIndex(i - 1);
+        settings.setValue("id", roots[i].id);
+        settings.setValue("path", roots[i].path);
+        settings.setValue("include", roots[i].include);
+        settings.setValue("exclude", roots[i].exclude);
     }
+    settings.endArray();
 
-    return true;
+    return scanDirectory();
+}
+
+QString LibraryManager::resolveTrackPath(const QString& libraryPath) const
+{
+    return LibraryRoot::resolve(libraryRoots, libraryPath);
 }
+
+QString LibraryManager::toLibraryPath(const QString& filePath) const
+{
+    return LibraryRoot::toLibraryPath(libraryRoots, filePath);
+}
+
+void LibraryManager::onScanBatch(quint64 scanId, const QVector<Track>& tracks)
+{
+    if (scanId != activeScanId && !pendingUpdates.contains(scanId))
+        return;
+
+    // Updated in place, so the handles the UI holds stay valid.
+    for (const Track& track : tracks) {
+        contentIndex.insert(toLibraryPath(track.filePath), track.quickHash, track.contentHash);
+        masterTracks.insert(track);
+    }
+
+    emit tracksScanned(static_cast<int>(tracks.size()));
+}
+
+void LibraryManager::onScanFinished(quint64 scanId, bool cancelled, const QStringList& fileNames,
+                                    const LibraryScanner::Folders& folders)
+{
+    if (pendingUpdates.contains(scanId)) {
+        finishUpdate(pendingUpdates.take(scanId));
+        return;
+    }
+
+    if (scanId != activeScanId)
+        return;
+
+    if (!cancelled) {
+        // Drop what is no longer under the roots (including placeholders for
+        // playlist entries whose files are gone).
+        QSet<QString> seen;
+        seen.reserve(fileNames.size());
+        for (const QString& fileName : fileNames)
+            seen.insert(resolveTrackPath(fileName));
+
+        masterTracks.removeIf([&seen](const QString& filePath) { return !seen.contains(filePath); });
+
+        // What the scan listed is what the watcher compares changes with.
+        watcher.setBaseline(folders);
+
+        QJsonObject root;
+        if (loadJson(root)) {
+            populateMasterPlaylist(fileNames, root);
+            prunePlaylists(root);
+            if (!saveJson(root))
+                qWarning() << "onScanFinished: failed to save playlists JSON";
+        }
+
+        const QSet<QString> libraryPaths(fileNames.cbegin(), fileNames.cend());
+        metadataCache.retainOnly(libraryPaths);
+        contentIndex.retainOnly(libraryPaths);
+        contentIndex.verifyCandidates();
+        fingerprintIndex.sync(quickHashesByLibraryPath());
+
+        QSet<quint64> artHashes;
+        masterTracks.forEach([this, &artHashes](TrackHandle handle) {
+            if (const quint64 artHash = masterTracks.artHash(handle))
+                artHashes.insert(artHash);
+        });
+        artStore.retainOnly(artHashes);
+
+        masterTracks.squeeze();
+        qDebug() << "Library:" << masterTracks.size() << "tracks in"
+                 << masterTracks.memoryUsage() / 1024 << "KiB";
+    }
+
+    // Keep what a cancelled scan did read, too.
+    if (!metadataCache.save())
+        qWarning() << "onScanFinished: failed to save metadata cache";
+
+    emit scanFinished(cancelled);
+}
+
+void LibraryManager::onLibraryFilesChanged(const QStringList& added, const QStringList& removed,
+                                           const QStringList& modified)
+{
+    if (!removed.isEmpty()) {
+        const QStringList gonePaths = absolutePaths(removed);
+        const QSet<QString> gone(gonePaths.cbegin(), gonePaths.cend());
+        masterTracks.removeIf([&gone](const QString& filePath) { return gone.contains(filePath); });
+        for (const QString& libraryPath : removed) {
+            contentIndex.remove(libraryPath);
+            fingerprintIndex.remove(libraryPath);
+        }
+
+        QJsonObject root;
+        if (loadJson(root)) {
+            prunePlaylists(root);
+            if (!saveJson(root))
+                qWarning() << "onLibraryFilesChanged: failed to save playlists JSON";
+        }
+
+        emit tracksRemoved(gonePaths);
+    }
+
+    updateTracks(added, modified);
+}
+
+void LibraryManager::updateTracks(const QStringList& added, const QStringList& modified)
+{
+    if (added.isEmpty() && modified.isEmpty())
+        return;
+
+    // The batches land in onScanBatch like a scan's; finishUpdate() does the rest.
+    const quint64 id = scanner.update(libraryRoots, added + modified);
+    pendingUpdates.insert(id, PendingUpdate { added, modified });
+}
+
+void LibraryManager::finishUpdate(const PendingUpdate& update)
+{
+    if (!update.added.isEmpty()) {
+        QJsonObject root;
+        if (loadJson(root)) {
+            QStringList allSongs = getTracksFromPlaylist("All Songs");
+            for (const QString& fileName : update.added) {
+                if (!allSongs.contains(fileName))
+                    allSongs.append(fileName);
+            }
+            populateMasterPlaylist(allSongs, root);
+            if (!saveJson(root))
+                qWarning() << "finishUpdate: failed to save playlists JSON";
+        }
+    }
+
+    if (!metadataCache.save())
+        qWarning() << "finishUpdate: failed to save metadata cache";
+    contentIndex.verifyCandidates();
+    fingerprintIndex.sync(quickHashesByLibraryPath());
+
+    if (!update.added.isEmpty())
+        emit tracksAdded(absolutePaths(update.added));
+    if (!update.modified.isEmpty())
+        emit tracksChanged(absolutePaths(update.modified));
+}
+
+QHash<QString, quint64> LibraryManager::quickHashesByLibraryPath() const
+{
+    QHash<QString, quint64> quickHashes;
+    quickHashes.reserve(masterTracks.size());
+    masterTracks.forEach([this, &quickHashes](TrackHandle handle) {
+        if (const quint64 quickHash = masterTracks.quickHash(handle))
+            quickHashes.insert(toLibraryPath(masterTracks.filePath(handle)), quickHash);
+    });
+    return quickHashes;
+}
+
+QStringList LibraryManager::absolutePaths(const QStringList& libraryPaths) const
+{
+    QStringList paths;
+    paths.reserve(libraryPaths.size());
+    for (const QString& libraryPath : libraryPaths)
+        paths.append(resolveTrackPath(libraryPath));
+    return paths;
+}
+
+TrackHandle LibraryManager::getTrackFromMasterPlaylist(const QString& trackPath)
+{
+    const TrackHandle handle = masterTracks.find(trackPath);
+    if (!handle.isNull())
+        return handle;
+
+    // Nothing that could be scanned, so nothing to hold a place for.
+    if (trackPath.isEmpty() || !QDir::isAbsolutePath(trackPath))
+        return {};
+
+    Track placeholder;
+    placeholder.filePath = trackPath;
+    placeholder.title = QFileInfo(trackPath).completeBaseName();
+    return masterTracks.insert(placeholder);
+}
+
 bool LibraryManager::readMusicFolder(QString &outDir)
 {
     outDir = settings.value("musicFolder", "").toString();
@@ -76,26 +381,69 @@ bool LibraryManager::validateDirectory(const QString &dir)
 
 bool LibraryManager::populateMasterPlaylist(const QStringList &fileNames, QJsonObject &root)
 {
-    // 1) Clear & refill in‑memory playlist
-    masterPlaylist->clear();
-    masterPlaylist->setName("All Songs");
-    if (fileNames.isEmpty())
-        return false;
+    // The tracks themselves arrived batch by batch; record the folder's
+    // contents as the "All Songs" playlist.
+    QStringList sorted = fileNames;
+    sorted.sort(Qt::CaseInsensitive);
+
+    QJsonArray arr;
+    for (const QString& fileName : sorted)
+        arr.append(fileName);
+
+    QJsonObject pls = root.value("playlists").toObject();
+    pls["All Songs"] = arr;
+    root["playlists"] = pls;
+
+    return !fileNames.isEmpty();
+}
+
+QString LibraryManager::retrieveCoverImagePath(const QString& trackName) const
+{
+    // Cover art is saved next to playlists.json as "<title>.jpg" (see
+    // downloadCoverArt).
+    QString dataDir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    return dataDir + "/" + trackName + ".jpg";
+}
+
+Track LibraryManager::extractMetadataForTrack(const QString& filePath)
+{
+    Track track;
+    track.filePath = filePath;
+    track.title    = QFileInfo(filePath).completeBaseName();
+
+    QByteArray embeddedArt;
+    if (!AvMetadataReader::read(filePath, track, &embeddedArt, &track.quickHash))
+        return track;
+
+    // A cover downloaded with the track wins; otherwise use the one in the
+    // file. Either way only its thumbnails go into the art store.
+    const QString coverImagePath = retrieveCoverImagePath(QFileInfo(filePath).baseName());
+    if (QFile::exists(coverImagePath))
+        track.artHash = artStore.addFile(coverImagePath);
+    if (track.artHash == 0)
+        track.artHash = artStore.add(embeddedArt);
+
+    return track;
+}
 
-    QDir d(currentMusicDirectory);
-  
-void LibraryManager::prunePlaylists(QJsonObject &root, const QString &musicDir)
+void LibraryManager::prunePlaylists(QJsonObject &root)
 {
     QJsonObject pls = root.value("playlists").toObject();
     bool modified = false;
-    QDir d(musicDir);
+
+    // Tracks on a root that isn't mounted right now are kept.
+    QVector<bool> mounted;
+    for (const LibraryRoot& libraryRoot : libraryRoots)
+        mounted.append(QDir(libraryRoot.path).exists());
 
     for (const QString &name : pls.keys()) {
         QJsonArray oldArr = pls.value(name).toArray();
         QJsonArray newArr;
         for (const QJsonValue &v : oldArr) {
             QString trackName = v.toString();
-            if (d.exists(trackName))
+            QString relativePath;
+            const int index = LibraryRoot::findRoot(libraryRoots, trackName, relativePath);
+            if (index >= 0 && (!mounted[index] || QFileInfo::exists(libraryRoots[index].absoluteFilePath(relativePath))))
                 newArr.append(trackName);
             else
                 modified = true;
@@ -119,6 +467,26 @@ QString LibraryManager::playlistsFilePath() const
     return dataDir + "/playlists.json";
 }
 
+QString LibraryManager::metadataCacheFilePath() const
+{
+    QString dataDir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(dataDir);
+    return dataDir + "/metadata.cache";
+}
+
+QString LibraryManager::fingerprintsFilePath() const
+{
+    QString dataDir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(dataDir);
+    return dataDir + "/fingerprints.bin";
+}
+
+QString LibraryManager::artDirectoryPath() const
+{
+    QString dataDir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    return dataDir + "/art";
+}
+
 bool LibraryManager::ensurePlaylistsFileExists()
 {
     QString path = playlistsFilePath();
@@ -205,6 +573,7 @@ bool LibraryManager::addTrackToDIr(const QString& youtubeUrl)
                              ? inputPath.left(dotIndex) + ".ogg"
                              : inputPath + ".ogg";
 
+    if (!remuxVideo(inputPath, outputPath)) {
         QMessageBox::critical(nullptr, tr("FFmpeg remux failed"),
                               tr("Video file doesn't exist or is malformed."));
         return false;
@@ -223,8 +592,44 @@ bool LibraryManager::addTrackToDIr(const QString& youtubeUrl)
         }
     }
 
-    // trigger a rescan so the master playlist picks it up
-    scanDirectory();
+    // The same audio may already be here under another title (a re-upload,
+    // a renamed file).
+    const QString copy = contentIndex.findCopyOf(outputPath);
+    if (!copy.isEmpty()) {
+        QMessageBox::warning(nullptr,
+                             tr("Duplicate Track"),
+                             tr("This track is already in your library as \"%1\".").arg(copy)
+                             );
+        QFile::remove(outputPath);
+        QFile::remove(retrieveCoverImagePath(QFileInfo(outputPath).baseName()));
+        return false;
+    }
+
+    // ... or the same recording at another bitrate or in another container,
+    // which may be wanted, so ask.
+    const QString libraryPath = toLibraryPath(outputPath);
+    const FingerprintIndex::Words fingerprint = FingerprintIndex::fingerprintFile(outputPath);
+    QElapsedTimer lookup;
+    lookup.start();
+    const QVector<FingerprintIndex::Match> sameRecording = fingerprintIndex.findSameRecording(fingerprint, libraryPath);
+    qDebug() << "addTrackToDIr: fingerprint lookup over" << fingerprintIndex.size() << "tracks took"
+             << lookup.nsecsElapsed() / 1000 << "us";
+    if (!sameRecording.isEmpty()) {
+        const auto answer = QMessageBox::question(nullptr,
+                                                  tr("Possible Duplicate"),
+                                                  tr("This sounds like \"%1\", already in your library.\n"
+                                                     "Keep the new download anyway?").arg(sameRecording.first().libraryPath)
+                                                  );
+        if (answer != QMessageBox::Yes) {
+            QFile::remove(outputPath);
+            QFile::remove(retrieveCoverImagePath(QFileInfo(outputPath).baseName()));
+            return false;
+        }
+    }
+    fingerprintIndex.insert(libraryPath, ContentHasher::quickHash(outputPath), fingerprint);
+
+    // read just the new track; the rest of the library hasn't changed
+    updateTracks({ libraryPath }, {});
     return true;
 }
 
@@ -389,7 +794,6 @@ bool LibraryManager::addTrackToPlaylist(const QString& playlistName, const QStri
     pls[playlistName] = arr;
     root["playlists"]   = pls;
 
-    scanDirectory();
     return saveJson(root);
 }
 
@@ -439,26 +843,22 @@ bool LibraryManager::delTrackFromPlaylist(const QString& playlistName, const QSt
     }
 
     qDebug() << "Track" << trackName << "removed from playlist" << playlistName;
-    scanDirectory();
     return true;
 }
 
 bool LibraryManager::delTrackFromDir(const QString& trackName)
 {
-    QDir dir(currentMusicDirectory);
-    QString trackPath = dir.absoluteFilePath(trackName);
+    QString trackPath = resolveTrackPath(trackName);
 
     QFileInfo trackInfo(trackPath);
-    if (!trackInfo.exists() || !trackInfo.isFile()) {
-        qWarning() << "Track not found:" << trackPath;
+    if (trackPath.isEmpty() || !trackInfo.exists() || !trackInfo.isFile()) {
+        qWarning() << "Track not found:" << trackName;
         return false;
     }
 
-    // Confirm it's inside the current music directory
-    QDir musicDir(currentMusicDirectory);
-    QString relativePath = musicDir.relativeFilePath(trackPath);
-    if (relativePath.startsWith("..")) {
-        qWarning() << "Track is not inside the current music directory:" << trackPath;
+    // Confirm it's inside one of the library roots
+    if (toLibraryPath(trackPath).isEmpty()) {
+        qWarning() << "Track is not inside the library:" << trackPath;
         return false;
     }
 
@@ -475,8 +875,18 @@ bool LibraryManager::delTrackFromDir(const QString& trackName)
         QFile::remove(coverImagePath); // Best-effort, non-fatal if it fails
     }
 
-    // Refresh library (this prunes any playlists containing this track)
-    scanDirectory();
+    // Forget the track and prune every playlist containing it; nothing else
+    // in the folder changed, so there is no need to rescan.
+    masterTracks.remove(trackPath);
+    contentIndex.remove(toLibraryPath(trackPath));
+    fingerprintIndex.remove(toLibraryPath(trackPath));
+
+    QJsonObject root;
+    if (loadJson(root)) {
+        prunePlaylists(root);
+        if (!saveJson(root))
+            qWarning() << "delTrackFromDir: failed to save playlists JSON";
+    }
 
     qDebug() << "Deleted track and cover image successfully:" << trackPath;
     return true;
@@ -669,12 +1079,10 @@ bool LibraryManager::deletePlaylist(const QString& playlistName)
     return true;
 }
 
-bool LibraryManager::isTrackFavourite(Track* track)
+bool LibraryManager::isTrackFavourite(const QString& trackPath)
 {
-    if (!track) return false;
-
-    QString fileName = QFileInfo(track->filePath).fileName();
+    QString trackName = toLibraryPath(trackPath);
 
     QStringList favourites = getTracksFromPlaylist("Favourites");
-    return favourites.contains(fileName, Qt::CaseInsensitive);
+    return favourites.contains(trackName, Qt::CaseInsensitive);
 }
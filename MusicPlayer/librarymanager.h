@@ -1,9 +1,18 @@
 #ifndef LIBRARYMANAGER_H
 #define LIBRARYMANAGER_H
 
-#include "playlist.h"
+#include "artstore.h"
+#include "contentindex.h"
+#include "fingerprintindex.h"
+#include "libraryroot.h"
+#include "libraryscanner.h"
+#include "librarywatcher.h"
+#include "trackstore.h"
+#include "metadatacache.h"
+#include <QHash>
 #include <QObject>
 #include <QSettings>
+#include <QVector>
 
 class LibraryManager : public QObject
 {
@@ -26,15 +35,19 @@ public:
         return LibraryManager::instance();
     }
 
-    /// Reads last folder from QSettings, scans it, and fills masterPlaylist.
-    /// Returns true if the directory existed and contains at least one track.
+    /// Reads the library roots from QSettings and starts scanning them in
+    /// the background, cancelling any scan in progress. masterTracks fills in
+    /// batch by batch (tracksScanned); the playlists JSON is brought up to
+    /// date when the scan ends (scanFinished).
+    /// Returns true if the directory existed and a scan was started.
     bool scanDirectory();
+    void cancelScan();
+    bool isScanning() const { return scanner.isScanning(); }
 
     bool readMusicFolder(QString &outDir);
     bool validateDirectory(const QString &dir);
-    QStringList listAudioFiles(const QString &dir);
     bool populateMasterPlaylist(const QStringList &fileNames, QJsonObject &root);
-    void prunePlaylists(QJsonObject &root, const QString &musicDir);
+    void prunePlaylists(QJsonObject &root);
     /// Make sure the JSON file exists on disk. Returns true on success.
     bool ensurePlaylistsFileExists();
 
@@ -47,17 +60,29 @@ public:
     bool addTrackToDIr(const QString& youtubeUrl);
     bool delTrackFromDir(const QString& trackPath);
 
-    Playlist& getMasterPlaylist()         {return *masterPlaylist;}
-    Track* getTrackFromMasterPlaylist(const QString& trackPath)
-    {
-        for (Track &track : masterPlaylist->getTracks()) {
-            if (track.filePath == trackPath)
-            {
-                return &track;
-            }
-        }
-        return nullptr;
-    }
+    /// Every track under the library roots, by absolute path.
+    const TrackStore& getMasterTracks() const { return masterTracks; }
+    /// A track the scan hasn't reached yet gets a placeholder (file name as
+    /// title) that the scan fills in when it gets there. Null for an empty or
+    /// relative path, e.g. a library path whose root is gone didn't resolve.
+    /// The handle outlives rescans; it only goes stale once the file is gone.
+    TrackHandle getTrackFromMasterPlaylist(const QString& trackPath);
+    /// False if the track has been removed since the handle was taken.
+    bool getTrack(TrackHandle handle, Track& track) const { return masterTracks.get(handle, track); }
+    /// Empty if the track has been removed since the handle was taken.
+    QString getTrackPath(TrackHandle handle) const { return masterTracks.filePath(handle); }
+    /// The track's cover art, scaled to at least size px across; null if it
+    /// has none or its thumbnails aren't ready yet (coverArtReady).
+    QPixmap getCoverArt(TrackHandle handle, int size) { return artStore.thumbnail(masterTracks.artHash(handle), size); }
+
+    /// The primary root first ("musicFolder"), then the extra ones.
+    const QVector<LibraryRoot>& getLibraryRoots() const { return libraryRoots; }
+    /// Store the roots (the first one is the primary) and rescan them.
+    bool setLibraryRoots(const QVector<LibraryRoot>& roots);
+
+    /// Library path (what playlists hold) <-> file on disk; see LibraryRoot.
+    QString resolveTrackPath(const QString& libraryPath) const;
+    QString toLibraryPath(const QString& filePath) const;
 
     const QString& getCurrentMusicDirectory() {
         return currentMusicDirectory;
@@ -85,8 +110,41 @@ public:
     bool renamePlaylist(const QString& oldName,
                         const QString& newName);
 
-    bool isTrackFavourite(Track* track) ;
+    bool isTrackFavourite(const QString& trackPath) ;
+
+    /// Library paths of files holding the same audio, two or more to a
+    /// group, for cleaning up. Settled in the background after each scan
+    /// (duplicatesChanged).
+    QVector<QStringList> getDuplicateGroups() const { return contentIndex.duplicateGroups(); }
+    /// Library paths of files that sound like the same recording (another
+    /// bitrate, codec or container), by acoustic fingerprint. Fingerprints
+    /// are taken in the background after each scan (duplicatesChanged).
+    QVector<QStringList> getSameRecordingGroups() const { return fingerprintIndex.sameRecordingGroups(); }
 signals:
+    void scanStarted();
+    void scanProgress(int done, int found);
+    /// A batch of tracks was added to or updated in masterTracks.
+    void tracksScanned(int count);
+    /// masterTracks and the playlists JSON now match the folder (unless
+    /// cancelled). Handles to tracks that are gone now resolve to null.
+    void scanFinished(bool cancelled);
+
+    /// Changes seen between scans (absolute paths), already applied to
+    /// masterTracks and the playlists JSON. After tracksRemoved, handles to
+    /// the removed tracks resolve to null.
+    void tracksAdded(const QStringList& filePaths);
+    void tracksRemoved(const QStringList& filePaths);
+    void tracksChanged(const QStringList& filePaths);
+
+    void duplicatesChanged();
+    /// Thumbnails of some track's cover art were just stored.
+    void coverArtReady();
+
+private slots:
+    void onScanBatch(quint64 scanId, const QVector<Track>& tracks);
+    void onScanFinished(quint64 scanId, bool cancelled, const QStringList& fileNames,
+                        const LibraryScanner::Folders& folders);
+    void onLibraryFilesChanged(const QStringList& added, const QStringList& removed, const QStringList& modified);
 
 private:
     // only instance() may create one
@@ -95,17 +153,43 @@ private:
 
     QSettings settings;
 
-    Playlist *masterPlaylist;
+    TrackStore masterTracks;
     QString currentMusicDirectory;
+    QVector<LibraryRoot> libraryRoots;
     QString lastPlaylistPlayed;
 
+    LibraryScanner scanner;
+    quint64 activeScanId = 0;
+    MetadataCache metadataCache;
+    ContentIndex contentIndex;
+    FingerprintIndex fingerprintIndex;
+    ArtStore artStore;
+
+    // Files re-read without a full scan, by the id of the scanner update.
+    struct PendingUpdate
+    {
+        QStringList added;
+        QStringList modified;
+    };
+    QHash<quint64, PendingUpdate> pendingUpdates;
+    LibraryWatcher watcher;
+
+    QVector<LibraryRoot> readLibraryRoots(const QString& primaryDir);
+    void updateTracks(const QStringList& added, const QStringList& modified);
+    void finishUpdate(const PendingUpdate& update);
+    QStringList absolutePaths(const QStringList& libraryPaths) const;
+
     QString playlistsFilePath() const;
-    /// Extract title / artist / album / coverImage from an audio file
-    QString retrieveCoverImagePath(const QString& trackName);
+    QString metadataCacheFilePath() const;
+    QString fingerprintsFilePath() const;
+    QString artDirectoryPath() const;
+    QHash<QString, quint64> quickHashesByLibraryPath() const;
+    /// Extract title / artist / album / cover art from an audio file.
+    /// Called from the scanner's worker threads.
+    QString retrieveCoverImagePath(const QString& trackName) const;
     Track extractMetadataForTrack(const QString& filePath);
 
     QString ffmpegPath_;
-    QString ffprobePath_;
     QString ytdlpPath_;
 
     QString getOutputFilename(const QString& ytdlpPath,
@@ -0,0 +1,123 @@
+#include "libraryroot.h"
+
+#include <QDir>
+
+namespace
+{
+void compile(const QStringList& globs, QList<QRegularExpression>& patterns, QList<bool>& wholePath)
+{
+    patterns.clear();
+    wholePath.clear();
+    for (const QString& rawGlob : globs) {
+        const QString glob = QDir::fromNativeSeparators(rawGlob.trimmed());
+        if (glob.isEmpty())
+            continue;
+
+        patterns.append(QRegularExpression(QRegularExpression::wildcardToRegularExpression(glob),
+                                           QRegularExpression::CaseInsensitiveOption));
+        wholePath.append(glob.contains('/'));
+    }
+}
+} // namespace
+
+void LibraryRoot::compileGlobs()
+{
+    compile(include, includePatterns, includeWholePath);
+    compile(exclude, excludePatterns, excludeWholePath);
+}
+
+bool LibraryRoot::matchesAny(const QList<QRegularExpression>& patterns, const QList<bool>& matchWholePath,
+                             const QString& relativePath)
+{
+    const QString name = relativePath.section('/', -1);
+    for (int i = 0; i < patterns.size(); ++i) {
+        if (patterns[i].match(matchWholePath[i] ? relativePath : name).hasMatch())
+            return true;
+    }
+    return false;
+}
+
+bool LibraryRoot::isExcluded(const QString& relativePath) const
+{
+    return matchesAny(excludePatterns, excludeWholePath, relativePath);
+}
+
+bool LibraryRoot::isIncluded(const QString& relativeFilePath) const
+{
+    return includePatterns.isEmpty() || matchesAny(includePatterns, includeWholePath, relativeFilePath);
+}
+
+QString LibraryRoot::libraryPath(const QString& relativePath) const
+{
+    return isPrimary() ? relativePath : id + ':' + relativePath;
+}
+
+QString LibraryRoot::absoluteFilePath(const QString& relativePath) const
+{
+    return QDir(path).absoluteFilePath(relativePath);
+}
+
+int LibraryRoot::findRoot(const QVector<LibraryRoot>& roots, const QString& libraryPath, QString& relativePath)
+{
+    // Relative paths never contain ':' on Windows, and hardly ever elsewhere;
+    // a name that does is taken as relative if no root has that id.
+    const int colon = libraryPath.indexOf(':');
+    if (colon > 0) {
+        const QString id = libraryPath.left(colon);
+        for (int i = 0; i < roots.size(); ++i) {
+            if (roots[i].id == id) {
+                relativePath = libraryPath.mid(colon + 1);
+                return i;
+            }
+        }
+    }
+
+    for (int i = 0; i < roots.size(); ++i) {
+        if (roots[i].isPrimary()) {
+            relativePath = libraryPath;
+            return i;
+        }
+    }
+    return -1;
+}
+
+QString LibraryRoot::resolve(const QVector<LibraryRoot>& roots, const QString& libraryPath)
+{
+    QString relativePath;
+    const int index = findRoot(roots, libraryPath, relativePath);
+    return index >= 0 ? roots[index].absoluteFilePath(relativePath) : QString();
+}
+
+QString LibraryRoot::toLibraryPath(const QVector<LibraryRoot>& roots, const QString& filePath)
+{
+    for (const LibraryRoot& root : roots) {
+        const QString relativePath = QDir(root.path).relativeFilePath(filePath);
+        if (!relativePath.startsWith("..") && !QDir::isAbsolutePath(relativePath))
+            return root.libraryPath(relativePath);
+    }
+    return {};
+}
+
+QStringList LibraryRoot::canonicalPaths(const QVector<LibraryRoot>& roots)
+{
+    QStringList paths;
+    for (const LibraryRoot& root : roots)
+        paths.append(QFileInfo(root.path).canonicalFilePath());
+    return paths;
+}
+
+bool LibraryRoot::isReachedOtherwise(const QStringList& canonicalRoots, const QFileInfo& dir)
+{
+    const QString canonical = dir.canonicalFilePath();
+    if (canonical.isEmpty())
+        return false;
+
+    if (!dir.isSymLink() && !dir.isJunction())
+        return canonicalRoots.contains(canonical);
+
+    for (const QString& rootPath : canonicalRoots) {
+        if (!rootPath.isEmpty() && (canonical == rootPath || canonical.startsWith(rootPath + u'/')))
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,77 @@
+#ifndef LIBRARYROOT_H
+#define LIBRARYROOT_H
+
+#include <QFileInfo>
+#include <QList>
+#include <QRegularExpression>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// -----------------------------------------------------------------------------
+// LibraryRoot: one folder the library is built from, walked recursively.
+//
+// Playlists, the metadata cache and the watcher name a file by its library
+// path: its path relative to its root, with '/' separators, prefixed "<id>:"
+// for every root but the primary one (the "musicFolder" setting, whose id is
+// empty, so playlists written before there were several roots still work).
+// Moving a root to another disk therefore only means changing its path.
+//
+// include / exclude are globs ('*', '?', '[...]'). A glob without a '/' is
+// matched against a file's or folder's name, one with a '/' against its whole
+// relative path, so "Podcasts" skips that folder anywhere and "Live/*.wav"
+// only those files. An excluded folder isn't descended into. When include is
+// empty every audio file is taken.
+// -----------------------------------------------------------------------------
+struct LibraryRoot
+{
+    QString id;
+    QString path;
+    QStringList include;
+    QStringList exclude;
+
+    bool isPrimary() const { return id.isEmpty(); }
+
+    // Build the matchers for include / exclude; call after changing them.
+    void compileGlobs();
+
+    bool isExcluded(const QString& relativePath) const;
+    bool isIncluded(const QString& relativeFilePath) const;
+
+    QString libraryPath(const QString& relativePath) const;
+    QString absoluteFilePath(const QString& relativePath) const;
+
+    bool operator==(const LibraryRoot& other) const
+    {
+        return id == other.id && path == other.path && include == other.include && exclude == other.exclude;
+    }
+    bool operator!=(const LibraryRoot& other) const { return !(*this == other); }
+
+    // The absolute path of a library path; empty if its root isn't known.
+    static QString resolve(const QVector<LibraryRoot>& roots, const QString& libraryPath);
+
+    // The library path of a file; empty if it lies outside every root.
+    static QString toLibraryPath(const QVector<LibraryRoot>& roots, const QString& filePath);
+
+    // Split a library path into its root's index and the relative path.
+    static int findRoot(const QVector<LibraryRoot>& roots, const QString& libraryPath, QString& relativePath);
+
+    // The roots' canonical paths (empty for a root that isn't there).
+    static QStringList canonicalPaths(const QVector<LibraryRoot>& roots);
+
+    // Whether a folder met while walking a root is left to another way in:
+    // a symlink (or junction) to somewhere under a root, which is walked by
+    // its real path, or another root, which is walked as itself. Parallel
+    // walks then list every file under the same library path whichever
+    // folder they reach first.
+    static bool isReachedOtherwise(const QStringList& canonicalRoots, const QFileInfo& dir);
+
+private:
+    static bool matchesAny(const QList<QRegularExpression>& patterns, const QList<bool>& matchWholePath,
+                           const QString& relativePath);
+
+    QList<QRegularExpression> includePatterns, excludePatterns;
+    QList<bool> includeWholePath, excludeWholePath;
+};
+
+#endif // LIBRARYROOT_H
@@ -0,0 +1,258 @@
+#include "libraryscanner.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QMutex>
+#include <QSet>
+
+#include <atomic>
+
+#include "threadpolicy.h"
+
+// One scan's state, shared by its tasks. fileNames, folders and visitedDirs
+// are written by every listing task, under the mutex; fileNames and folders
+// are read only by whichever task finishes last, after the pendingTasks
+// countdown.
+struct LibraryScanner::Scan
+{
+    quint64 id = 0;
+    QVector<LibraryRoot> roots;
+    QStringList canonicalRoots;
+
+    QMutex mutex;
+    QStringList fileNames;
+    Folders folders;
+    QSet<QString> visitedDirs;   // canonical paths
+
+    std::atomic<bool> cancelled { false };
+    std::atomic<int> pendingTasks { 0 };
+    std::atomic<int> found { 0 };
+    std::atomic<int> done { 0 };
+};
+
+LibraryScanner::LibraryScanner(QObject* parent)
+    : QObject(parent)
+{
+}
+
+LibraryScanner::~LibraryScanner()
+{
+    cancel();
+    pool.waitForDone();
+}
+
+QStringList LibraryScanner::audioFileFilters()
+{
+    return { "*.mp3", "*.wav", "*.flac", "*.ogg", "*.opus" };
+}
+
+std::shared_ptr<LibraryScanner::Scan> LibraryScanner::makeScan(const QVector<LibraryRoot>& roots)
+{
+    auto scan = std::make_shared<Scan>();
+    scan->id = nextScanId++;
+    scan->roots = roots;
+    scan->canonicalRoots = LibraryRoot::canonicalPaths(roots);
+    return scan;
+}
+
+quint64 LibraryScanner::start(const QVector<LibraryRoot>& roots)
+{
+    cancel();
+
+    auto scan = makeScan(roots);
+    current = scan;
+
+    qDebug() << "LibraryScanner: scan" << scan->id << "of" << roots.size() << "roots"
+             << "on" << pool.maxThreadCount() << "threads";
+
+    // Every root is its own tree of tasks. Holding a count while they are
+    // queued keeps a quick root from finishing the scan before the next
+    // one has started.
+    scan->pendingTasks.fetch_add(1);
+    for (int i = 0; i < roots.size(); ++i)
+    {
+        const QString rootPath = roots[i].path;
+        submit(scan, [this, scan, i, rootPath] { listDirectory(scan, i, rootPath); });
+    }
+    pool.start([this, scan] { taskDone(scan); });
+
+    return scan->id;
+}
+
+quint64 LibraryScanner::update(const QVector<LibraryRoot>& roots, const QStringList& libraryPaths)
+{
+    auto scan = makeScan(roots);
+    submit(scan, [this, scan, libraryPaths] { listFiles(scan, libraryPaths); });
+    return scan->id;
+}
+
+void LibraryScanner::cancel()
+{
+    if (current)
+        current->cancelled.store(true);
+}
+
+bool LibraryScanner::isScanning() const
+{
+    return current && current->pendingTasks.load() > 0;
+}
+
+//============================================================================
+// Tasks. Every task is counted in pendingTasks before it is queued, and a
+// listing task queues its subfolders' and its batches' tasks while it is
+// itself still counted, so the count only reaches zero once the whole scan
+// is over.
+
+void LibraryScanner::submit(const std::shared_ptr<Scan>& scan, std::function<void()> task)
+{
+    scan->pendingTasks.fetch_add(1);
+    pool.start([this, scan, task = std::move(task)] {
+        ThreadPolicy::applyIfChanged(ThreadPolicy::Role::Background);
+        if (!scan->cancelled.load())
+            task();
+        taskDone(scan);
+    });
+}
+
+void LibraryScanner::taskDone(const std::shared_ptr<Scan>& scan)
+{
+    if (scan->pendingTasks.fetch_sub(1) != 1)
+        return;
+
+    const bool cancelled = scan->cancelled.load();
+    qDebug() << "LibraryScanner: scan" << scan->id << (cancelled ? "cancelled after" : "found")
+             << scan->done.load() << "of" << scan->found.load() << "tracks";
+    emit finished(scan->id, cancelled, cancelled ? QStringList() : scan->fileNames,
+                  cancelled ? Folders() : scan->folders);
+}
+
+void LibraryScanner::listDirectory(const std::shared_ptr<Scan>& scan, int rootIndex, const QString& dirPath)
+{
+    // Once per real folder: the same one reached through a symlink (or a
+    // symlink loop) is skipped. Symlinks into the roots never get here, so
+    // the race only decides between ways in from outside them.
+    const QString canonical = QFileInfo(dirPath).canonicalFilePath();
+    {
+        const QMutexLocker locker(&scan->mutex);
+        if (canonical.isEmpty() || scan->visitedDirs.contains(canonical))
+            return;
+        scan->visitedDirs.insert(canonical);
+    }
+
+    const LibraryRoot& root = scan->roots[rootIndex];
+    const QDir rootDir(root.path);
+    const QStringList audioFilters = audioFileFilters();
+
+    Folder folder;
+    folder.root = rootIndex;
+    folder.canonicalPath = canonical;
+
+    Batch batch;
+    batch.reserve(BatchSize);
+
+    QDirIterator it(dirPath, QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot);
+    while (it.hasNext())
+    {
+        if (scan->cancelled.load())
+            return;
+
+        it.next();
+        const QFileInfo info = it.fileInfo();
+        const QString relativePath = rootDir.relativeFilePath(info.filePath());
+        if (root.isExcluded(relativePath))
+            continue;
+
+        if (info.isDir())
+        {
+            if (LibraryRoot::isReachedOtherwise(scan->canonicalRoots, info))
+                continue;
+            const QString subdirPath = info.filePath();
+            folder.subfolders.append(subdirPath);
+            submit(scan, [this, scan, rootIndex, subdirPath] { listDirectory(scan, rootIndex, subdirPath); });
+            continue;
+        }
+
+        if (!QDir::match(audioFilters, info.fileName()) || !root.isIncluded(relativePath))
+            continue;
+
+        const QString libraryPath = root.libraryPath(relativePath);
+        folder.files.insert(libraryPath, FileStamp { info.size(), info.lastModified().toMSecsSinceEpoch() });
+        addToBatch(scan, batch, { info, libraryPath, root.absoluteFilePath(relativePath) });
+    }
+
+    {
+        const QMutexLocker locker(&scan->mutex);
+        scan->folders.insert(dirPath, folder);
+    }
+
+    if (!batch.isEmpty())
+        submit(scan, [this, scan, batch] { extractBatch(scan, batch); });
+}
+
+void LibraryScanner::listFiles(const std::shared_ptr<Scan>& scan, const QStringList& libraryPaths)
+{
+    Batch batch;
+    batch.reserve(BatchSize);
+
+    for (const QString& libraryPath : libraryPaths)
+    {
+        QString relativePath;
+        const int rootIndex = LibraryRoot::findRoot(scan->roots, libraryPath, relativePath);
+        if (rootIndex < 0)
+            continue;
+
+        const QString filePath = scan->roots[rootIndex].absoluteFilePath(relativePath);
+        const QFileInfo info(filePath);
+        if (info.isFile())
+            addToBatch(scan, batch, { info, libraryPath, filePath });
+    }
+
+    if (!batch.isEmpty())
+        submit(scan, [this, scan, batch] { extractBatch(scan, batch); });
+}
+
+// Hands a full batch to its own task.
+void LibraryScanner::addToBatch(const std::shared_ptr<Scan>& scan, Batch& batch, FoundFile file)
+{
+    {
+        const QMutexLocker locker(&scan->mutex);
+        scan->fileNames.append(file.libraryPath);
+    }
+    batch.append(std::move(file));
+    scan->found.fetch_add(1);
+
+    if (batch.size() == BatchSize)
+    {
+        submit(scan, [this, scan, batch] { extractBatch(scan, batch); });
+        batch.clear();
+    }
+}
+
+void LibraryScanner::extractBatch(const std::shared_ptr<Scan>& scan, const Batch& batch)
+{
+    QVector<Track> tracks;
+    tracks.reserve(batch.size());
+
+    for (const FoundFile& file : batch)
+    {
+        if (scan->cancelled.load())
+            return;
+
+        Track track;
+        if (extractor)
+            track = extractor(file.info, file.libraryPath);
+        else
+            track.title = file.info.completeBaseName();
+
+        // Spelled the way the UI resolves library paths to look tracks up.
+        track.filePath = file.filePath;
+        tracks.append(track);
+    }
+
+    const int extracted = static_cast<int>(tracks.size());
+    const int done = scan->done.fetch_add(extracted) + extracted;
+    emit batchReady(scan->id, tracks);
+    emit progress(scan->id, done, scan->found.load());
+}
@@ -0,0 +1,139 @@
+#ifndef LIBRARYSCANNER_H
+#define LIBRARYSCANNER_H
+
+#include <QFileInfo>
+#include <QHash>
+#include <QObject>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+
+#include <functional>
+#include <memory>
+
+#include "libraryroot.h"
+#include "track.h"
+
+// -----------------------------------------------------------------------------
+// LibraryScanner: finds the audio files under the library roots and reads
+// their metadata on a pool of worker threads, so the GUI thread never waits
+// on the disk or on the metadata tool.
+//
+// Every folder is listed by its own task, which queues a task per subfolder,
+// so the roots and their subtrees are walked in parallel (two disks at once,
+// and many artist/album folders per disk). Files are handed out in batches
+// as they are found; each batch is extracted by its own task, so extraction
+// starts before the walk is done and runs on every core.
+//
+// Folders reached through symlinks are followed, but each real folder is
+// walked once, which also breaks symlink loops. The roots' include/exclude
+// globs apply as LibraryRoot describes.
+//
+// Alongside the files, a scan reports every folder it listed, with its audio
+// files' sizes and mtimes as the listing had them and the subfolders it went
+// into, so the watcher starts from what the scan saw instead of walking the
+// roots again.
+//
+// Results come back as signals, delivered on the receiver's thread like any
+// queued signal:
+//
+//   batchReady - a batch of Tracks, in no particular order
+//   progress   - tracks extracted so far, files found so far
+//   finished   - the scan is over; the library path of every file it found,
+//                or cancelled if it was stopped early
+//
+// Every scan has an id, carried by all of its signals. Starting a scan cancels
+// the one running, whose remaining signals the receiver can tell apart by id.
+// -----------------------------------------------------------------------------
+class LibraryScanner : public QObject
+{
+    Q_OBJECT
+public:
+    // Reads one file's metadata; called on the worker threads, concurrently.
+    // The QFileInfo comes from the directory listing, so its size and mtime
+    // usually cost no extra stat.
+    using Extractor = std::function<Track(const QFileInfo& file, const QString& libraryPath)>;
+
+    static constexpr int BatchSize = 32;
+
+    struct FileStamp
+    {
+        qint64 size = 0;
+        qint64 modifiedMs = 0;
+
+        bool operator==(const FileStamp& other) const
+        {
+            return size == other.size && modifiedMs == other.modifiedMs;
+        }
+    };
+
+    // One listed folder: its audio files (by library path) and the folders
+    // under it.
+    struct Folder
+    {
+        int root = 0;           // index into the roots
+        QString canonicalPath;
+        QHash<QString, FileStamp> files;
+        QStringList subfolders;
+    };
+
+    // By folder path, spelled as the walk reached it.
+    using Folders = QHash<QString, Folder>;
+
+    explicit LibraryScanner(QObject* parent = nullptr);
+    ~LibraryScanner() override;
+
+    void setExtractor(Extractor newExtractor) { extractor = std::move(newExtractor); }
+
+    // Scan the roots, cancelling any scan in progress. Returns the new id.
+    quint64 start(const QVector<LibraryRoot>& roots);
+
+    // Read just these files (library paths) again, e.g. ones a watcher saw
+    // appear or change. Reports like a scan with its own id, but runs
+    // alongside a full scan instead of cancelling it.
+    quint64 update(const QVector<LibraryRoot>& roots, const QStringList& libraryPaths);
+
+    // Stop the full scan in progress; it still reports finished (cancelled).
+    void cancel();
+
+    bool isScanning() const;
+
+    // Block until every task has returned (cancel first to make it quick).
+    void waitForDone() { pool.waitForDone(); }
+
+    static QStringList audioFileFilters();
+
+signals:
+    void batchReady(quint64 scanId, const QVector<Track>& tracks);
+    void progress(quint64 scanId, int done, int found);
+    // folders is empty for update() and for a cancelled scan.
+    void finished(quint64 scanId, bool cancelled, const QStringList& fileNames,
+                  const LibraryScanner::Folders& folders);
+
+private:
+    struct Scan;
+
+    // A file found and waiting in a batch.
+    struct FoundFile
+    {
+        QFileInfo info;
+        QString libraryPath;
+        QString filePath;   // spelled the way LibraryRoot::resolve() spells it
+    };
+    using Batch = QList<FoundFile>;
+
+    std::shared_ptr<Scan> makeScan(const QVector<LibraryRoot>& roots);
+    void listDirectory(const std::shared_ptr<Scan>& scan, int rootIndex, const QString& dirPath);
+    void listFiles(const std::shared_ptr<Scan>& scan, const QStringList& libraryPaths);
+    void addToBatch(const std::shared_ptr<Scan>& scan, Batch& batch, FoundFile file);
+    void extractBatch(const std::shared_ptr<Scan>& scan, const Batch& batch);
+    void submit(const std::shared_ptr<Scan>& scan, std::function<void()> task);
+    void taskDone(const std::shared_ptr<Scan>& scan);
+
+    QThreadPool pool;
+    Extractor extractor;
+    std::shared_ptr<Scan> current;
+    quint64 nextScanId = 1;
+};
+
+#endif // LIBRARYSCANNER_H
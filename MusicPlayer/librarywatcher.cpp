@@ -0,0 +1,497 @@
+#include "librarywatcher.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QSet>
+#include <QThread>
+
+#ifdef Q_OS_WIN
+ #include <windows.h>
+#endif
+
+#include "threadpolicy.h"
+
+namespace
+{
+// List each folder asked for, and walk in full the subfolders under them
+// that aren't known yet (skip holds the canonical paths of those that are:
+// they are watched, and listed themselves when they change). The scanner's
+// rules decide what counts.
+void listFolders(const QVector<LibraryRoot>& roots, const QVector<LibraryWatcher::FolderRef>& asked,
+                 const QSet<QString>& skip, LibraryWatcher::Folders& found)
+{
+    const QStringList audioFilters = LibraryScanner::audioFileFilters();
+    const QStringList canonicalRoots = LibraryRoot::canonicalPaths(roots);
+    QSet<QString> visited;
+    QVector<LibraryWatcher::FolderRef> pending;
+
+    const auto listFolder = [&](const LibraryWatcher::FolderRef& ref, const QString& canonical) {
+        visited.insert(canonical);
+
+        const LibraryRoot& root = roots[ref.root];
+        const QDir rootDir(root.path);
+        LibraryWatcher::Folder folder;
+        folder.root = ref.root;
+        folder.canonicalPath = canonical;
+
+        QDirIterator it(ref.path, QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot);
+        while (it.hasNext()) {
+            it.next();
+            const QFileInfo info = it.fileInfo();
+            const QString relativePath = rootDir.relativeFilePath(info.filePath());
+            if (root.isExcluded(relativePath))
+                continue;
+
+            if (info.isDir()) {
+                if (LibraryRoot::isReachedOtherwise(canonicalRoots, info))
+                    continue;
+                folder.subfolders.append(info.filePath());
+                pending.append({ info.filePath(), ref.root });
+                continue;
+            }
+
+            if (!QDir::match(audioFilters, info.fileName()) || !root.isIncluded(relativePath))
+                continue;
+
+            folder.files.insert(root.libraryPath(relativePath),
+                                LibraryWatcher::FileStamp { info.size(), info.lastModified().toMSecsSinceEpoch() });
+        }
+        found.insert(ref.path, folder);
+    };
+
+    for (const LibraryWatcher::FolderRef& ref : asked) {
+        const QString canonical = QFileInfo(ref.path).canonicalFilePath();
+        if (!canonical.isEmpty() && !visited.contains(canonical))
+            listFolder(ref, canonical);
+    }
+    while (!pending.isEmpty()) {
+        const LibraryWatcher::FolderRef ref = pending.takeLast();
+        const QString canonical = QFileInfo(ref.path).canonicalFilePath();
+        if (canonical.isEmpty() || visited.contains(canonical) || skip.contains(canonical))
+            continue;
+        listFolder(ref, canonical);
+    }
+}
+} // namespace
+
+#ifdef Q_OS_WIN
+// One root's recursive ReadDirectoryChangesW, read on a thread of its own.
+// What it reads goes to the watcher on the GUI thread, tagged with the
+// generation it was started for.
+class LibraryWatcher::RootWatch : public QThread
+{
+public:
+    RootWatch(LibraryWatcher* ownerWatcher, int rootIndex, const QString& rootPath, quint64 watchGeneration)
+        : owner(ownerWatcher), root(rootIndex), startedFor(watchGeneration)
+    {
+        directory = CreateFileW(reinterpret_cast<LPCWSTR>(QDir::toNativeSeparators(rootPath).utf16()),
+                                FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+                                nullptr);
+        stopEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+        ioEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+        if (directory == INVALID_HANDLE_VALUE)
+            qWarning() << "LibraryWatcher: can't watch" << rootPath << "- error" << GetLastError();
+    }
+
+    ~RootWatch() override
+    {
+        SetEvent(stopEvent);
+        wait();
+        if (directory != INVALID_HANDLE_VALUE)
+            CloseHandle(directory);
+        CloseHandle(ioEvent);
+        CloseHandle(stopEvent);
+    }
+
+    bool isOpen() const { return directory != INVALID_HANDLE_VALUE; }
+
+protected:
+    void run() override
+    {
+        ThreadPolicy::applyIfChanged(ThreadPolicy::Role::Background);
+
+        constexpr DWORD Filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME
+                                 | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE;
+        const HANDLE events[] = { stopEvent, ioEvent };
+
+        for (;;) {
+            OVERLAPPED overlapped {};
+            overlapped.hEvent = ioEvent;
+            ResetEvent(ioEvent);
+            if (!ReadDirectoryChangesW(directory, buffer, sizeof(buffer), TRUE, Filter, nullptr, &overlapped,
+                                       nullptr)) {
+                qWarning() << "LibraryWatcher: stopped watching root" << root << "- error" << GetLastError();
+                return;
+            }
+
+            DWORD bytes = 0;
+            if (WaitForMultipleObjects(2, events, FALSE, INFINITE) != WAIT_OBJECT_0 + 1) {
+                CancelIoEx(directory, &overlapped);
+                GetOverlappedResult(directory, &overlapped, &bytes, TRUE);
+                return;
+            }
+
+            // No bytes (or ERROR_NOTIFY_ENUM_DIR) means the buffer overflowed
+            // and which entries changed is lost.
+            QStringList relativePaths;
+            const bool overflowed = !GetOverlappedResult(directory, &overlapped, &bytes, FALSE) || bytes == 0;
+            if (!overflowed) {
+                const auto* bytesRead = reinterpret_cast<const char*>(buffer);
+                for (DWORD offset = 0;;) {
+                    const auto* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(bytesRead + offset);
+                    const QString name = QString::fromWCharArray(info->FileName,
+                                                                 int(info->FileNameLength / sizeof(WCHAR)));
+                    relativePaths.append(QDir::fromNativeSeparators(name));
+                    if (info->NextEntryOffset == 0)
+                        break;
+                    offset += info->NextEntryOffset;
+                }
+            }
+
+            LibraryWatcher* const watcher = owner;
+            const int rootIndex = root;
+            const quint64 generation = startedFor;
+            QMetaObject::invokeMethod(
+                owner,
+                [watcher, rootIndex, generation, relativePaths, overflowed] {
+                    if (generation == watcher->generation)
+                        watcher->onRootChanged(rootIndex, relativePaths, overflowed);
+                },
+                Qt::QueuedConnection);
+        }
+    }
+
+private:
+    LibraryWatcher* owner;
+    int root;
+    quint64 startedFor;
+    HANDLE directory = INVALID_HANDLE_VALUE;
+    HANDLE stopEvent = nullptr;
+    HANDLE ioEvent = nullptr;
+    DWORD buffer[16 * 1024];    // 64 KiB, DWORD-aligned as the API needs
+};
+#else
+class LibraryWatcher::RootWatch
+{
+};
+#endif
+
+LibraryWatcher::LibraryWatcher(QObject* parent)
+    : QObject(parent)
+{
+    // One listing at a time, so they land in the order they were taken.
+    pool.setMaxThreadCount(1);
+
+    debounce.setSingleShot(true);
+    debounce.setInterval(DebounceMs);
+    pollTimer.setInterval(PollMs);
+
+    connect(&watcher, &QFileSystemWatcher::directoryChanged, this, &LibraryWatcher::onDirectoryChanged);
+    connect(&debounce, &QTimer::timeout, this, &LibraryWatcher::listChanged);
+    connect(&pollTimer, &QTimer::timeout, this, &LibraryWatcher::poll);
+    connect(this, &LibraryWatcher::listingReady, this, &LibraryWatcher::onListingReady, Qt::QueuedConnection);
+}
+
+LibraryWatcher::~LibraryWatcher()
+{
+    stop();
+}
+
+void LibraryWatcher::watch(const QVector<LibraryRoot>& newRoots)
+{
+    stop();
+
+    roots = newRoots;
+    canonicalRoots = LibraryRoot::canonicalPaths(roots);
+
+#ifdef Q_OS_WIN
+    // Watching starts now, not when the scan is done, so nothing changed
+    // while it runs is missed.
+    for (int i = 0; i < roots.size(); ++i) {
+        auto rootWatch = std::make_unique<RootWatch>(this, i, roots[i].path, generation);
+        if (!rootWatch->isOpen())
+            continue;
+        rootWatch->start();
+        rootWatches.push_back(std::move(rootWatch));
+    }
+#endif
+}
+
+void LibraryWatcher::setBaseline(const Folders& folders)
+{
+    // Stale folders from an earlier baseline stop being watched; the rest
+    // are followed as listings come and go from here on.
+    const QStringList watched = watcher.directories();
+    QStringList stale;
+    for (const QString& dirPath : watched) {
+        if (!folders.contains(dirPath))
+            stale.append(dirPath);
+    }
+    if (!stale.isEmpty())
+        watcher.removePaths(stale);
+
+    QStringList newFolders;
+    knownCanonical.clear();
+    for (auto it = folders.cbegin(); it != folders.cend(); ++it) {
+        knownCanonical.insert(it->canonicalPath);
+        if (!known.contains(it.key()) && !isSeenByRootWatch(*it))
+            newFolders.append(it.key());
+    }
+    known = folders;
+    haveBaseline = true;
+    watchFolders(newFolders);
+
+    // A root that lost track of its changes before now is listed whole.
+    const QSet<int> lostTrack = overflowedRoots;
+    overflowedRoots.clear();
+    for (const int root : lostTrack)
+        markRootChanged(root);
+
+    if (!changed.isEmpty())
+        debounce.start();
+}
+
+void LibraryWatcher::stop()
+{
+    rootWatches.clear();
+    debounce.stop();
+    pollTimer.stop();
+    if (!watcher.directories().isEmpty())
+        watcher.removePaths(watcher.directories());
+
+    roots.clear();
+    canonicalRoots.clear();
+    known.clear();
+    knownCanonical.clear();
+    changed.clear();
+    overflowedRoots.clear();
+    unwatched.clear();
+    haveBaseline = false;
+    ++generation;   // drop listings still in flight
+}
+
+void LibraryWatcher::onDirectoryChanged(const QString& dirPath)
+{
+    changed.insert(dirPath);
+    debounce.start();
+}
+
+void LibraryWatcher::onRootChanged(int root, const QStringList& relativePaths, bool overflowed)
+{
+    if (overflowed) {
+        if (haveBaseline)
+            markRootChanged(root);
+        else
+            overflowedRoots.insert(root);
+    } else {
+        // The folder an entry is in is what changed; a folder that isn't
+        // known yet is taken up by the nearest one that is, in listChanged().
+        const QDir rootDir(roots[root].path);
+        for (const QString& relativePath : relativePaths) {
+            const qsizetype slash = relativePath.lastIndexOf(u'/');
+            changed.insert(slash < 0 ? roots[root].path : rootDir.filePath(relativePath.left(slash)));
+        }
+    }
+
+    if (haveBaseline)
+        debounce.start();
+}
+
+void LibraryWatcher::markRootChanged(int root)
+{
+    for (auto it = known.cbegin(); it != known.cend(); ++it) {
+        if (it->root == root)
+            changed.insert(it.key());
+    }
+}
+
+bool LibraryWatcher::isSeenByRootWatch(const Folder& folder) const
+{
+#ifdef Q_OS_WIN
+    // The root's handle sees what is physically under the root, not what a
+    // symlink or junction leads to elsewhere.
+    const QString& canonicalRoot = canonicalRoots.value(folder.root);
+    return !canonicalRoot.isEmpty()
+           && (folder.canonicalPath == canonicalRoot || folder.canonicalPath.startsWith(canonicalRoot + u'/'));
+#else
+    Q_UNUSED(folder);
+    return false;
+#endif
+}
+
+void LibraryWatcher::poll()
+{
+    // Watches may have been freed since; whichever still fail stay polled.
+    const QStringList polled(unwatched.cbegin(), unwatched.cend());
+    const QStringList failed = watcher.addPaths(polled);
+    unwatched = QSet<QString>(failed.cbegin(), failed.cend());
+    if (unwatched.isEmpty())
+        pollTimer.stop();
+
+    // Nothing said whether these changed, so list them all.
+    changed.unite(QSet<QString>(polled.cbegin(), polled.cend()));
+    listChanged();
+}
+
+void LibraryWatcher::listChanged()
+{
+    // Held until there is something to compare with.
+    if (!haveBaseline)
+        return;
+
+    QVector<FolderRef> folders;
+    QSet<QString> asked;
+    for (QString dirPath : changed) {
+        // A folder too new to be known is found by listing the nearest one
+        // above it that is.
+        auto it = known.constFind(dirPath);
+        while (it == known.cend()) {
+            const qsizetype slash = dirPath.lastIndexOf(u'/');
+            if (slash <= 0)
+                break;
+            dirPath.truncate(slash);
+            it = known.constFind(dirPath);
+        }
+        if (it != known.cend() && !asked.contains(dirPath)) {
+            asked.insert(dirPath);
+            folders.append({ dirPath, it->root });
+        }
+    }
+    changed.clear();
+
+    if (!folders.isEmpty())
+        list(folders);
+}
+
+void LibraryWatcher::list(const QVector<FolderRef>& folders)
+{
+    const quint64 listing = generation;
+    const QVector<LibraryRoot> listedRoots = roots;
+    const QSet<QString> skip = knownCanonical;
+    QStringList asked;
+    for (const FolderRef& folder : folders)
+        asked.append(folder.path);
+
+    pool.start([this, listing, listedRoots, folders, skip, asked] {
+        ThreadPolicy::applyIfChanged(ThreadPolicy::Role::Background);
+
+        Folders found;
+        listFolders(listedRoots, folders, skip, found);
+
+        emit listingReady(listing, asked, found);
+    });
+}
+
+void LibraryWatcher::dropFolder(const QString& dirPath, QStringList& removedFiles, QStringList& droppedFolders)
+{
+    if (!known.contains(dirPath))
+        return;
+
+    const Folder folder = known.take(dirPath);
+    knownCanonical.remove(folder.canonicalPath);
+    droppedFolders.append(dirPath);
+    for (auto it = folder.files.cbegin(); it != folder.files.cend(); ++it)
+        removedFiles.append(it.key());
+    for (const QString& subfolder : folder.subfolders)
+        dropFolder(subfolder, removedFiles, droppedFolders);
+}
+
+void LibraryWatcher::watchFolders(const QStringList& dirPaths)
+{
+    if (dirPaths.isEmpty())
+        return;
+
+    const QStringList failed = watcher.addPaths(dirPaths);
+    if (failed.isEmpty())
+        return;
+
+    if (unwatched.isEmpty())
+        qWarning() << "LibraryWatcher: can't watch" << failed.size() << "folders, e.g." << failed.first()
+                   << "- polling them every" << PollMs / 1000 << "s";
+    unwatched.unite(QSet<QString>(failed.cbegin(), failed.cend()));
+    if (!pollTimer.isActive())
+        pollTimer.start();
+}
+
+void LibraryWatcher::onListingReady(quint64 listing, const QStringList& asked, const Folders& found)
+{
+    if (listing != generation)
+        return;
+
+    QStringList addedFiles, removedFiles, modifiedFiles;
+    QStringList droppedFolders, newFolders;
+
+    // A folder that is gone, or gone from the folder it was in, takes
+    // everything under it along.
+    for (const QString& dirPath : asked) {
+        const auto before = known.constFind(dirPath);
+        if (before == known.cend())
+            continue;
+        const auto now = found.constFind(dirPath);
+        if (now == found.cend()) {
+            dropFolder(dirPath, removedFiles, droppedFolders);
+            continue;
+        }
+        const QStringList subfolders = before->subfolders;
+        for (const QString& subfolder : subfolders) {
+            if (!now->subfolders.contains(subfolder))
+                dropFolder(subfolder, removedFiles, droppedFolders);
+        }
+    }
+
+    // Every folder listed replaces what was known of it.
+    for (auto folder = found.cbegin(); folder != found.cend(); ++folder) {
+        const auto before = known.constFind(folder.key());
+        if (before == known.cend()) {
+            newFolders.append(folder.key());
+            for (auto it = folder->files.cbegin(); it != folder->files.cend(); ++it)
+                addedFiles.append(it.key());
+        } else {
+            for (auto it = folder->files.cbegin(); it != folder->files.cend(); ++it) {
+                const auto previous = before->files.constFind(it.key());
+                if (previous == before->files.cend())
+                    addedFiles.append(it.key());
+                else if (!(*previous == *it))
+                    modifiedFiles.append(it.key());
+            }
+            for (auto it = before->files.cbegin(); it != before->files.cend(); ++it) {
+                if (!folder->files.contains(it.key()))
+                    removedFiles.append(it.key());
+            }
+            knownCanonical.remove(before->canonicalPath);
+        }
+        known.insert(folder.key(), *folder);
+        knownCanonical.insert(folder->canonicalPath);
+    }
+
+    // Follow the folders as they come and go (those a root's handle doesn't
+    // already see).
+    if (!droppedFolders.isEmpty()) {
+        const QStringList watchedList = watcher.directories();
+        const QSet<QString> watched(watchedList.cbegin(), watchedList.cend());
+        QStringList unwatch;
+        for (const QString& dirPath : droppedFolders) {
+            unwatched.remove(dirPath);
+            if (watched.contains(dirPath))
+                unwatch.append(dirPath);
+        }
+        if (!unwatch.isEmpty())
+            watcher.removePaths(unwatch);
+    }
+    QStringList toWatch;
+    for (const QString& dirPath : newFolders) {
+        if (!isSeenByRootWatch(known.value(dirPath)))
+            toWatch.append(dirPath);
+    }
+    watchFolders(toWatch);
+
+    if (addedFiles.isEmpty() && removedFiles.isEmpty() && modifiedFiles.isEmpty())
+        return;
+
+    qDebug() << "LibraryWatcher:" << addedFiles.size() << "added," << removedFiles.size() << "removed,"
+             << modifiedFiles.size() << "modified";
+    emit filesChanged(addedFiles, removedFiles, modifiedFiles);
+}
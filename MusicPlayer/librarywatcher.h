@@ -0,0 +1,125 @@
+#ifndef LIBRARYWATCHER_H
+#define LIBRARYWATCHER_H
+
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVector>
+
+#include <memory>
+#include <vector>
+
+#include "libraryroot.h"
+#include "libraryscanner.h"
+
+// -----------------------------------------------------------------------------
+// LibraryWatcher: notices audio files appearing, disappearing and changing
+// under the library roots while the app runs, whoever changes them.
+//
+// On Windows each root gets one recursive ReadDirectoryChangesW handle, on a
+// thread of its own, from watch() on; it names the entries that changed, and
+// their folders are what changed. Elsewhere QFileSystemWatcher (inotify)
+// watches every known folder and says only which one changed. Either way the
+// notifications come once per file touched, so they are debounced: once the
+// roots have been quiet for DebounceMs the folders that changed are listed
+// again (off the GUI thread, with the scanner's rules) and compared with
+// what was known of them by library path, size and mtime. Subfolders that
+// are new are walked in full; those that are gone take their files with
+// them. The difference comes out as one filesChanged().
+//
+// What is known starts from the full scan's own listing (setBaseline()), not
+// from a walk of its own. Changes seen before it arrives are held and listed
+// against it, so on Windows nothing that happens while the scan runs or
+// after it is lost. On other systems folders are only watched once they are
+// known.
+//
+// Folders a root's handle doesn't see (reached through a symlink or
+// junction to outside the root) are watched with QFileSystemWatcher on
+// Windows too. Folders past the system's watch limit
+// (fs.inotify.max_user_watches, or the handles Windows allows) are polled
+// instead: every PollMs they are listed as if they had changed, and watching
+// them is tried again.
+// -----------------------------------------------------------------------------
+class LibraryWatcher : public QObject
+{
+    Q_OBJECT
+public:
+    using FileStamp = LibraryScanner::FileStamp;
+    using Folder = LibraryScanner::Folder;
+    using Folders = LibraryScanner::Folders;
+
+    // A folder to list, and the root it is under.
+    struct FolderRef
+    {
+        QString path;
+        int root = 0;
+    };
+
+    static constexpr int DebounceMs = 750;
+    static constexpr int PollMs = 30000;
+
+    explicit LibraryWatcher(QObject* parent = nullptr);
+    ~LibraryWatcher() override;
+
+    // Watch these roots instead of whatever was watched before. Nothing is
+    // reported until setBaseline().
+    void watch(const QVector<LibraryRoot>& newRoots);
+    void stop();
+
+    // What a full scan of the roots listed; changes are reported against it.
+    void setBaseline(const Folders& folders);
+
+    const QVector<LibraryRoot>& getRoots() const { return roots; }
+
+signals:
+    // Library paths.
+    void filesChanged(const QStringList& added, const QStringList& removed, const QStringList& modified);
+
+    // Internal: a listing of the folders asked for (and any new ones under
+    // them) finished on the pool.
+    void listingReady(quint64 generation, const QStringList& asked, const LibraryWatcher::Folders& found);
+
+private slots:
+    void onDirectoryChanged(const QString& dirPath);
+    void onListingReady(quint64 generation, const QStringList& asked, const LibraryWatcher::Folders& found);
+
+private:
+    class RootWatch;
+
+    // A root's handle saw these entries (relative paths) change; overflowed
+    // if it lost track of which.
+    void onRootChanged(int root, const QStringList& relativePaths, bool overflowed);
+    void markRootChanged(int root);
+
+    void listChanged();
+    void list(const QVector<FolderRef>& folders);
+    void dropFolder(const QString& dirPath, QStringList& removedFiles, QStringList& droppedFolders);
+    void watchFolders(const QStringList& dirPaths);
+    bool isSeenByRootWatch(const Folder& folder) const;
+    void poll();
+
+    QFileSystemWatcher watcher;
+    std::vector<std::unique_ptr<RootWatch>> rootWatches;
+    QTimer debounce;
+    QTimer pollTimer;
+
+    QVector<LibraryRoot> roots;
+    QStringList canonicalRoots;
+    Folders known;
+    QSet<QString> knownCanonical;
+    QSet<QString> changed;      // folders to list at the end of the debounce
+    QSet<int> overflowedRoots;  // lost track before there was a baseline
+    QSet<QString> unwatched;    // past the watch limit, so polled
+    bool haveBaseline = false;
+    quint64 generation = 0;
+
+    // Declared last so it is destroyed first, waiting for a listing in flight
+    // while the rest of the object is still there.
+    QThreadPool pool;
+};
+
+#endif // LIBRARYWATCHER_H
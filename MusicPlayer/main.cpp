@@ -4,7 +4,7 @@
 
 int main(int argc, char *argv[])
 {
-    qRegisterMetaType<Track*>("Track");
+    qRegisterMetaType<TrackHandle>("TrackHandle");
     // Set up Windows unhandled exception handler
     SetUnhandledExceptionFilter([](EXCEPTION_POINTERS* exceptionInfo) -> LONG {
         qCritical() << "Unhandled exception caught! Code:" << exceptionInfo->ExceptionRecord->ExceptionCode;
@@ -11,11 +11,14 @@ MediaController::MediaController(QObject* parent) :
     // No extra initialization is needed here.
     currentTracklistManager = new CurrentTracklistManager();
     audioPlayback = new AudioPlayback();
+    audioPlayback->setStateListener([this](const AudioPlayback::StateEvent& event) {
+        handleStateEvent(event);
+    });
 }
 
 MediaController::~MediaController()
 {
-    // Cleanup if necessary (nothing explicit needed in this case).
+    audioPlayback->setStateListener(nullptr);
     delete currentTracklistManager;
     delete audioPlayback;
 }
@@ -55,19 +58,65 @@ bool MediaController::loadAndPlayTrack(int index)
     // }
     qDebug().noquote() << "audioPlayback->getCurrentTrackPath():" << audioPlayback->getCurrentTrackPath()
                        << "\ncurrentTrack.filePath:" << currentTrack.filePath;
-    if (audioPlayback->getCurrentTrackPath() == currentTrack.filePath) {
+    // Clicking the loaded track toggles it, unless another load is still in
+    // flight: then this click is the latest and reloads it.
+    if (audioPlayback->getCurrentTrackPath() == currentTrack.filePath
+        && audioPlayback->getPendingTrackPath().isEmpty()) {
         this->togglePause();
         return true;
     }
 
-    // Load and play the track using AudioPlayback's replaceTrack() method.
-    if (!audioPlayback->replaceTrack(currentTrack.filePath)) {
-        qDebug() << "Failed to reolace track:" << currentTrack.filePath;
-        return false;
-    }
+    // Load and play the track off the GUI thread. If the user clicks another
+    // track before this one is ready, only the later click gets through.
+    // playing() or trackLoadFailed() follow from the state events.
+    audioPlayback->replaceTrackAsync(currentTrack.filePath, [this](bool ok) {
+        if (ok)
+            prefetchNeighbours();
+    });
     return true;
 }
 
+void MediaController::handleStateEvent(const AudioPlayback::StateEvent& event)
+{
+    switch (event.type)
+    {
+    case AudioPlayback::StateEvent::Loaded:
+        emit trackLoaded(event.trackPath);
+        break;
+    case AudioPlayback::StateEvent::Started:
+        emit playing(event.trackPath);
+        break;
+    case AudioPlayback::StateEvent::Paused:
+        emit paused(event.trackPath);
+        break;
+    case AudioPlayback::StateEvent::Ended:
+        // Carry on through the queue and stop after its last track.
+        if (currentTracklistManager->getCurrentIndex() + 1 < currentTracklistManager->getCurrentPlaylist().size()) {
+            nextTrack();
+        } else {
+            emit paused(event.trackPath);
+        }
+        break;
+    case AudioPlayback::StateEvent::Error:
+        qDebug() << "Failed to load track:" << event.trackPath;
+        emit trackLoadFailed(event.trackPath);
+        break;
+    }
+}
+
+void MediaController::prefetchNeighbours()
+{
+    const Playlist& playlist = currentTracklistManager->getCurrentPlaylist();
+    const int count = playlist.size();
+    if (count <= 1)
+        return;
+
+    // Upcoming track first: it is the most likely next switch.
+    const int current = currentTracklistManager->getCurrentIndex();
+    audioPlayback->prefetchTrack(playlist.at((current + 1) % count).filePath);
+    audioPlayback->prefetchTrack(playlist.at((current - 1 + count) % count).filePath);
+}
+
 bool MediaController::nextTrack()
 {
     // Advance the playlist.
@@ -20,7 +20,9 @@ public:
     // method for focusing on current tracklist item
     void focusCurrentTracklisstItem(int index);
 
-    // Loads and plays the track at the given index.
+    // Starts loading the track at the given index in the background and plays
+    // it once ready; emits playing() or trackLoadFailed(). A newer request
+    // supersedes one still loading. Returns false if the index is invalid.
     bool loadAndPlayTrack(int index);
 
     // Moves to the next track and plays it.
@@ -45,24 +47,31 @@ public:
         return audioPlayback->isPlaying();
     }
 
+    // playing() / paused() follow once the audio thread has carried it out.
     void togglePause()
     {
-        if (audioPlayback->isPlaying()){
+        if (audioPlayback->isPlaying())
             audioPlayback->stop();
-            emit paused(audioPlayback->getCurrentTrackPath());
-        }
         else
-        {
             audioPlayback->play();
-            emit playing(audioPlayback->getCurrentTrackPath());
-        }
     }
 
 signals:
+    // Emitted when playback has actually started or paused (after the fade),
+    // whoever asked for it.
     void paused(const QString& trackPath = nullptr);
     void playing(const QString& trackPath = nullptr);
+    void trackLoaded(const QString& trackPath);
+    void trackLoadFailed(const QString& trackPath);
 
 private:
+    // Reacts to AudioPlayback's state events (Qt thread): re-emits them as
+    // signals and moves on to the next track when one ends.
+    void handleStateEvent(const AudioPlayback::StateEvent& event);
+
+    // Warm the decoded-audio cache with the tracks either side of the current one.
+    void prefetchNeighbours();
+
     CurrentTracklistManager *currentTracklistManager;
     AudioPlayback *audioPlayback;
     QListWidget *tracklist;
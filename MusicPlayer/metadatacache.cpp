@@ -0,0 +1,150 @@
+#include "metadatacache.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QFile>
+#include <QSaveFile>
+
+namespace
+{
+constexpr quint32 cacheMagic = 0x46574d43;   // "FWMC"
+constexpr quint32 cacheVersion = 5;   // 2: embedded art, libavformat tags; 3: library paths; 4: hashes; 5: art hash
+
+QDataStream& operator<<(QDataStream& out, const Track& track)
+{
+    return out << track.title << track.artist << track.album << track.artHash
+               << track.durationMs << track.codec
+               << qint32(track.sampleRate) << qint32(track.channels) << qint32(track.bitRate)
+               << track.quickHash << track.contentHash;
+}
+
+QDataStream& operator>>(QDataStream& in, Track& track)
+{
+    qint32 sampleRate = 0, channels = 0, bitRate = 0;
+    in >> track.title >> track.artist >> track.album >> track.artHash
+       >> track.durationMs >> track.codec
+       >> sampleRate >> channels >> bitRate
+       >> track.quickHash >> track.contentHash;
+    track.sampleRate = sampleRate;
+    track.channels = channels;
+    track.bitRate = bitRate;
+    return in;
+}
+} // namespace
+
+bool MetadataCache::load(const QString& cacheFilePath)
+{
+    QWriteLocker locker(&lock);
+    entries.clear();
+    path = cacheFilePath;
+    dirty = false;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0, version = 0;
+    qint32 count = 0;
+    in >> magic >> version >> count;
+    if (magic != cacheMagic || version != cacheVersion || count < 0) {
+        qDebug() << "MetadataCache: ignoring" << path << "(written by another version)";
+        return false;
+    }
+
+    entries.reserve(count);
+    for (qint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        QString libraryPath;
+        Entry entry;
+        in >> libraryPath >> entry.size >> entry.modifiedMs >> entry.track;
+        entries.insert(libraryPath, entry);
+    }
+
+    if (in.status() != QDataStream::Ok) {
+        qWarning() << "MetadataCache: truncated cache file" << path;
+        entries.clear();
+        return false;
+    }
+
+    qDebug() << "MetadataCache: loaded" << entries.size() << "entries";
+    return true;
+}
+
+bool MetadataCache::save()
+{
+    QWriteLocker locker(&lock);
+    if (!dirty || path.isEmpty())
+        return true;
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << cacheMagic << cacheVersion << qint32(entries.size());
+    for (auto it = entries.cbegin(); it != entries.cend(); ++it)
+        out << it.key() << it->size << it->modifiedMs << it->track;
+
+    if (!file.commit()) {
+        qWarning() << "MetadataCache: failed to write" << path;
+        return false;
+    }
+
+    dirty = false;
+    return true;
+}
+
+int MetadataCache::size() const
+{
+    QReadLocker locker(&lock);
+    return static_cast<int>(entries.size());
+}
+
+bool MetadataCache::lookup(const QString& libraryPath, qint64 size, qint64 modifiedMs, Track& out) const
+{
+    QReadLocker locker(&lock);
+    const auto it = entries.constFind(libraryPath);
+    if (it == entries.cend() || it->size != size || it->modifiedMs != modifiedMs)
+        return false;
+
+    out = it->track;
+    return true;
+}
+
+void MetadataCache::store(const QString& libraryPath, qint64 size, qint64 modifiedMs, const Track& track)
+{
+    QWriteLocker locker(&lock);
+    Entry& entry = entries[libraryPath];
+    entry.size = size;
+    entry.modifiedMs = modifiedMs;
+    entry.track = track;
+    entry.track.filePath.clear();
+    dirty = true;
+}
+
+void MetadataCache::setContentHash(const QString& libraryPath, quint64 contentHash)
+{
+    QWriteLocker locker(&lock);
+    const auto it = entries.find(libraryPath);
+    if (it == entries.end() || it->track.contentHash == contentHash)
+        return;
+
+    it->track.contentHash = contentHash;
+    dirty = true;
+}
+
+void MetadataCache::retainOnly(const QSet<QString>& libraryPaths)
+{
+    QWriteLocker locker(&lock);
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (libraryPaths.contains(it.key())) {
+            ++it;
+        } else {
+            it = entries.erase(it);
+            dirty = true;
+        }
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef METADATACACHE_H
+#define METADATACACHE_H
+
+#include <QHash>
+#include <QReadWriteLock>
+#include <QSet>
+#include <QString>
+
+#include "track.h"
+
+// -----------------------------------------------------------------------------
+// MetadataCache: the metadata of every file in the library, kept on disk
+// between runs so a rescan only has to stat the files.
+//
+// Entries are keyed by the file's library path (see LibraryRoot), so the
+// cache survives a root moving to another disk, and remember the size and
+// modification time the file had when it was read; an entry is only used
+// while both still match, so edited or replaced files are read again.
+//
+// The file is a small binary stream (magic, version, entries); one written by
+// another version is ignored. lookup() and store() may be called from the
+// scanner's threads concurrently; load(), retainOnly() and save() run on the
+// GUI thread.
+// -----------------------------------------------------------------------------
+class MetadataCache
+{
+public:
+    // Read the cache file; starts empty if there is none usable.
+    bool load(const QString& cacheFilePath);
+
+    // Write the cache back if it changed since load() / the last save().
+    bool save();
+
+    bool isLoaded() const { return !path.isEmpty(); }
+    int size() const;
+
+    // The cached track for this file, if it still has this size and mtime.
+    // filePath is left empty; the caller knows where the file is.
+    bool lookup(const QString& libraryPath, qint64 size, qint64 modifiedMs, Track& out) const;
+    void store(const QString& libraryPath, qint64 size, qint64 modifiedMs, const Track& track);
+
+    // Record a content hash taken after the entry was stored.
+    void setContentHash(const QString& libraryPath, quint64 contentHash);
+
+    // Forget files that are gone.
+    void retainOnly(const QSet<QString>& libraryPaths);
+
+private:
+    struct Entry
+    {
+        qint64 size = 0;
+        qint64 modifiedMs = 0;
+        Track track;
+    };
+
+    mutable QReadWriteLock lock;
+    QHash<QString, Entry> entries;
+    QString path;
+    bool dirty = false;
+};
+
+#endif // METADATACACHE_H
@@ -0,0 +1,103 @@
+#ifndef PLAYBACKCLOCK_H
+#define PLAYBACKCLOCK_H
+
+#include <juce_core/juce_core.h>
+
+#include <atomic>
+#include <cstdint>
+
+// -----------------------------------------------------------------------------
+// PlaybackClock: where playback is, published once per audio block so that
+// readers never have to touch the transport.
+//
+// The audio thread publishes a timestamp: a track position in samples, the
+// host time (high resolution ticks) at which that sample is heard, and the
+// rate at which the position advances (track samples per second: the sample
+// rate times the playback speed, 0 while paused). Readers extrapolate from it
+// to "now", so a UI repainting at the display rate moves smoothly between
+// audio blocks instead of stepping once per buffer.
+//
+// The fields are kept consistent with a sequence lock: the writer bumps
+// the sequence to odd, writes, and bumps it back to even; a reader retries
+// whenever it saw an odd sequence or the sequence changed under it. The writer
+// never waits, so it is safe on the audio thread. There must be only one.
+// -----------------------------------------------------------------------------
+class PlaybackClock
+{
+public:
+    struct Timestamp
+    {
+        juce::int64 samplePosition = 0;   // track position, in samples
+        juce::int64 hostTicks = 0;        // when that sample is heard
+        double sampleRate = 0.0;          // 0: nothing published yet
+        double rate = 0.0;                // track samples per second of host time
+        int blockSamples = 0;             // length of the block that published it
+    };
+
+    // Audio thread (the single writer).
+    void publish(const Timestamp& stamp) noexcept
+    {
+        const uint32_t seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        samplePosition.store(stamp.samplePosition, std::memory_order_relaxed);
+        hostTicks.store(stamp.hostTicks, std::memory_order_relaxed);
+        sampleRate.store(stamp.sampleRate, std::memory_order_relaxed);
+        rate.store(stamp.rate, std::memory_order_relaxed);
+        blockSamples.store(stamp.blockSamples, std::memory_order_relaxed);
+
+        sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    // Any thread. Spins only while a publish is in progress (a few stores).
+    Timestamp read() const noexcept
+    {
+        Timestamp stamp;
+        for (;;)
+        {
+            const uint32_t before = sequence.load(std::memory_order_acquire);
+            if ((before & 1u) != 0)
+                continue;
+
+            stamp.samplePosition = samplePosition.load(std::memory_order_relaxed);
+            stamp.hostTicks      = hostTicks.load(std::memory_order_relaxed);
+            stamp.sampleRate     = sampleRate.load(std::memory_order_relaxed);
+            stamp.rate           = rate.load(std::memory_order_relaxed);
+            stamp.blockSamples   = blockSamples.load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == before)
+                return stamp;
+        }
+    }
+
+    bool hasTimestamp() const noexcept { return read().sampleRate > 0.0; }
+
+    // Position in seconds at the given host time, extrapolated from the last
+    // timestamp (backwards too: the timestamp usually lies a little in the
+    // future). Extrapolation stops two blocks past it, so a device that stops
+    // calling back doesn't leave the position running away.
+    double getPositionSeconds(juce::int64 nowTicks = juce::Time::getHighResolutionTicks()) const noexcept
+    {
+        const Timestamp stamp = read();
+        if (stamp.sampleRate <= 0.0)
+            return 0.0;
+
+        const double elapsed = juce::jmin(juce::Time::highResolutionTicksToSeconds(nowTicks - stamp.hostTicks),
+                                          2.0 * stamp.blockSamples / stamp.sampleRate);
+
+        const double position = static_cast<double>(stamp.samplePosition) + stamp.rate * elapsed;
+        return juce::jmax(0.0, position / stamp.sampleRate);
+    }
+
+private:
+    std::atomic<uint32_t> sequence { 0 };
+    std::atomic<juce::int64> samplePosition { 0 };
+    std::atomic<juce::int64> hostTicks { 0 };
+    std::atomic<double> sampleRate { 0.0 };
+    std::atomic<double> rate { 0.0 };
+    std::atomic<int> blockSamples { 0 };
+};
+
+#endif // PLAYBACKCLOCK_H
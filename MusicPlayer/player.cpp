@@ -1,6 +1,7 @@
 #include "player.h"
 #include "ui_player.h"
 #include "helper/qsshelper.h"
+#include <QScreen>
 
 Player::Player(QWidget *parent, MediaController *externalMediaController)
     : QFrame(parent)
@@ -14,11 +15,11 @@ Player::Player(QWidget *parent, MediaController *externalMediaController)
 {
     ui->setupUi(this);
 
-    // Timer to continuously check if audio is loaded
     audioPlayback = mediaController->getAudioPlayback();
-    audioCheckTimer = new QTimer(this);
-    connect(audioCheckTimer, &QTimer::timeout, this, &Player::checkAudioState);
-    audioCheckTimer->start(100);  // Check every 100 ms
+
+    // Shown while a track is loaded; AudioPlayback reports when that changes.
+    connect(mediaController, &MediaController::trackLoaded, this, &Player::updateVisibility);
+    connect(mediaController, &MediaController::trackLoadFailed, this, &Player::updateVisibility);
 
     setUpPlayer();
 }
@@ -61,29 +62,44 @@ void Player::setUpPlayer(){
     connect(ui->seekSlider, &QSlider::sliderPressed, this, &Player::onSeekSliderPressed);
     connect(ui->seekSlider, &QSlider::sliderReleased, this, &Player::onSeekSliderReleased);
 
-    // In your Player class, declare a QTimer pointer (e.g., updateTimer) as a member.
+    // Playback speed for rehearsal; pitch is kept.
+    for (double speed : { 0.5, 0.75, 0.9, 1.0, 1.1, 1.25, 1.5, 2.0 })
+        ui->speedCombo->addItem(QString("%1x").arg(speed), speed);
+    ui->speedCombo->setCurrentIndex(ui->speedCombo->findData(audioPlayback->getPlaybackSpeed()));
+    ui->speedCombo->setCursor(Qt::PointingHandCursor);
+    connect(ui->speedCombo, &QComboBox::currentIndexChanged, this, &Player::onSpeedChanged);
+
+    // The position comes from the playback clock, which is extrapolated to
+    // the moment it is read, so repainting once per display refresh is
+    // smooth and anything faster would never be seen. It only runs while
+    // something is playing.
     updateTimer = new QTimer(this);
+    updateTimer->setTimerType(Qt::PreciseTimer);
     connect(updateTimer, &QTimer::timeout, this, &Player::updateSeekSlider);
-    updateTimer->start(0); // update every 200 ms
+    if (QScreen *display = screen())
+        connect(display, &QScreen::refreshRateChanged, this, &Player::updateSeekSliderInterval);
+    updateSeekSliderInterval();
     ui->seekSlider->setMaximum(10000); // Increase resolution
 
+    connect(mediaController, &MediaController::playing, updateTimer, qOverload<>(&QTimer::start));
+    connect(mediaController, &MediaController::paused, updateTimer, &QTimer::stop);
+
 
     qDebug() << "player frame x position:" << this->pos().rx();
     qDebug() << "player frame y position:" << this->pos().ry();
 }
 
-void Player::checkAudioState()
+void Player::updateSeekSliderInterval()
 {
-    if (audioPlayback && audioPlayback->hasAudioLoaded())
-    {
-        // Show the QFrame when audio is loaded
-        this->setVisible(true);
-    }
-    else
-    {
-        // Hide the QFrame when no audio is loaded
-        this->setVisible(false);
-    }
+    const QScreen *display = screen();
+    const qreal refreshRate = (display != nullptr && display->refreshRate() > 0.0) ? display->refreshRate() : 60.0;
+    updateTimer->setInterval(qMax(1, qRound(1000.0 / refreshRate)));
+}
+
+void Player::updateVisibility()
+{
+    // Show the QFrame while audio is loaded, hide it otherwise.
+    this->setVisible(audioPlayback && audioPlayback->hasAudioLoaded());
 }
 
 void Player::onPrevButtonClicked()
@@ -116,6 +132,14 @@ void Player::onNextButtonClicked()
     mediaController->nextTrack();
 }
 
+void Player::onSpeedChanged(int index)
+{
+    if (!audioPlayback || index < 0)
+        return;
+
+    audioPlayback->setPlaybackSpeed(ui->speedCombo->itemData(index).toDouble());
+}
+
 // Slot: When the user starts dragging the slider.
 void Player::onSeekSliderPressed()
 {
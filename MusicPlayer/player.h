@@ -20,7 +20,7 @@ public:
     ~Player();
 
 private slots:
-    void checkAudioState();
+    void updateVisibility();
     void onPrevButtonClicked();
     void onPlayButtonClicked();  // Slot for button press
     void onNextButtonClicked();
@@ -28,12 +28,13 @@ private slots:
     // Slot: When the user starts dragging the slider.
     void onSeekSliderPressed();
     void updateSeekSlider();
+    // Matches the slider timer to the display's refresh rate.
+    void updateSeekSliderInterval();
+    void onSpeedChanged(int index);
 
 private:
     Ui::Player *ui;
 
-    QTimer *audioCheckTimer; // For continuously checking audio state
-
     QPushButton *play;
     QPushButton *previous;
     QPushButton *next;
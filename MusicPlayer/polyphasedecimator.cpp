@@ -0,0 +1,84 @@
+#include "polyphasedecimator.h"
+
+#include <juce_dsp/juce_dsp.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+// Kaiser beta for roughly 80 dB of stopband rejection: anything folded back
+// into the kept band lands well below what the visualizer can show.
+constexpr double kaiserBeta = 8.0;
+} // namespace
+
+void PolyphaseDecimator::prepare(int newFactor, double inputRate, int tapsPerPhase)
+{
+    factor = juce::jmax(1, newFactor);
+    numTaps = factor * juce::jmax(1, tapsPerPhase);
+    outputRate = inputRate / factor;
+
+    // Windowed sinc with its cutoff at the output Nyquist.
+    std::vector<double> window(static_cast<size_t>(numTaps));
+    juce::dsp::WindowingFunction<double>::fillWindowingTables(window.data(), window.size(),
+                                                              juce::dsp::WindowingFunction<double>::kaiser,
+                                                              false, kaiserBeta);
+
+    const double cutoff = 1.0 / factor;   // fraction of the input Nyquist
+    const double centre = (numTaps - 1) / 2.0;
+    const double pi = juce::MathConstants<double>::pi;
+
+    std::vector<double> impulse(static_cast<size_t>(numTaps));
+    double sum = 0.0;
+    for (int k = 0; k < numTaps; ++k)
+    {
+        const double t = k - centre;
+        const double x = pi * cutoff * t;
+        const double sinc = t == 0.0 ? 1.0 : std::sin(x) / x;
+        impulse[static_cast<size_t>(k)] = cutoff * sinc * window[static_cast<size_t>(k)];
+        sum += impulse[static_cast<size_t>(k)];
+    }
+
+    // Unity gain at DC, stored newest-last to match the history.
+    taps.resize(static_cast<size_t>(numTaps));
+    for (int k = 0; k < numTaps; ++k)
+        taps[static_cast<size_t>(k)] = static_cast<float>(impulse[static_cast<size_t>(numTaps - 1 - k)] / sum);
+
+    history.assign(static_cast<size_t>(numTaps * 2), 0.0f);
+    reset();
+}
+
+void PolyphaseDecimator::reset()
+{
+    std::fill(history.begin(), history.end(), 0.0f);
+    writeIndex = 0;
+    phase = 0;
+}
+
+int PolyphaseDecimator::process(const float* input, int numSamples, float* output)
+{
+    if (history.empty())
+        return 0;
+
+    int written = 0;
+    for (int i = 0; i < numSamples; ++i)
+    {
+        history[static_cast<size_t>(writeIndex)] = input[i];
+        history[static_cast<size_t>(writeIndex + numTaps)] = input[i];
+        if (++writeIndex == numTaps)
+            writeIndex = 0;
+
+        if (++phase < factor)
+            continue;
+        phase = 0;
+
+        // The last numTaps samples, oldest first, start where the next write goes.
+        const float* recent = history.data() + writeIndex;
+        float acc = 0.0f;
+        for (int k = 0; k < numTaps; ++k)
+            acc += taps[static_cast<size_t>(k)] * recent[k];
+
+        output[written++] = acc;
+    }
+    return written;
+}
@@ -0,0 +1,51 @@
+#ifndef POLYPHASEDECIMATOR_H
+#define POLYPHASEDECIMATOR_H
+
+#include <juce_core/juce_core.h>
+
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// PolyphaseDecimator: low-pass filters a mono stream and keeps every Nth
+// sample, for analysis that only needs the bottom of the spectrum.
+//
+// The filter is a Kaiser-windowed sinc of factor * tapsPerPhase taps with its
+// cutoff at the output Nyquist. Only the outputs that are kept are computed:
+// each one is the sum of the filter's `factor` polyphase branches, so the cost
+// is tapsPerPhase multiply-adds per input sample whatever the factor. The
+// history is stored twice over, so every output is a single contiguous dot
+// product the compiler can vectorise.
+//
+// prepare() allocates; process() doesn't, so it is safe on the audio thread.
+// -----------------------------------------------------------------------------
+class PolyphaseDecimator
+{
+public:
+    // Design for keeping one sample in `factor` of a stream at inputRate.
+    void prepare(int factor, double inputRate, int tapsPerPhase = 10);
+
+    // Clear the history and restart the output phase.
+    void reset();
+
+    // Filter numSamples input samples and write the kept ones to output.
+    // Returns how many were written: at most numSamples / factor + 1.
+    int process(const float* input, int numSamples, float* output);
+
+    int getFactor() const { return factor; }
+    double getOutputRate() const { return outputRate; }
+
+    // Delay the filter adds, in input samples.
+    int getLatency() const { return (numTaps - 1) / 2; }
+
+private:
+    int factor = 1;
+    int numTaps = 1;
+    double outputRate = 0.0;
+
+    std::vector<float> taps;      // time-reversed, so taps[k] meets history[k]
+    std::vector<float> history;   // numTaps samples, written twice
+    int writeIndex = 0;
+    int phase = 0;                // input samples since the last output
+};
+
+#endif // POLYPHASEDECIMATOR_H
@@ -0,0 +1,381 @@
+#include "resamplersource.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+// Zeroth-order modified Bessel function of the first kind, for the Kaiser window.
+double besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    const double halfX = 0.5 * x;
+
+    for (int k = 1; k < 50; ++k)
+    {
+        term *= halfX / k;
+        const double squared = term * term;
+        sum += squared;
+        if (squared < sum * 1e-12)
+            break;
+    }
+    return sum;
+}
+} // namespace
+
+//============================================================================
+// SincTable: one row of windowed-sinc taps per fractional phase, plus a final
+// row for phase 1.0 so the renderer can interpolate between neighbours.
+void ResamplerSource::SincTable::build(int numTaps, double cutoff, double kaiserBeta)
+{
+    taps = numTaps;
+    coefficients.assign(static_cast<size_t>((NumPhases + 1) * taps), 0.0f);
+
+    const double halfWidth = taps / 2.0;
+    const double windowNorm = besselI0(kaiserBeta);
+    const double pi = juce::MathConstants<double>::pi;
+
+    for (int phase = 0; phase <= NumPhases; ++phase)
+    {
+        const double frac = static_cast<double>(phase) / NumPhases;
+        float* rowData = coefficients.data() + phase * taps;
+        double sum = 0.0;
+
+        for (int k = 0; k < taps; ++k)
+        {
+            const double t = k - (taps / 2 - 1) - frac;
+            const double x = pi * cutoff * t;
+            const double sinc = t == 0.0 ? 1.0 : std::sin(x) / x;
+
+            const double r = t / halfWidth;
+            const double window = std::abs(r) >= 1.0 ? 0.0 : besselI0(kaiserBeta * std::sqrt(1.0 - r * r)) / windowNorm;
+
+            const double value = cutoff * sinc * window;
+            rowData[k] = static_cast<float>(value);
+            sum += value;
+        }
+
+        // Unity gain at DC for every phase.
+        if (sum != 0.0)
+            for (int k = 0; k < taps; ++k)
+                rowData[k] = static_cast<float>(rowData[k] / sum);
+    }
+}
+
+const char* ResamplerSource::getQualityName(Quality q)
+{
+    switch (q)
+    {
+        case Linear:   return "Linear";
+        case Lagrange: return "Lagrange";
+        case SincFast: return "Sinc (fast)";
+        case SincBest: return "Sinc (best)";
+        default:       return "";
+    }
+}
+
+void ResamplerSource::setSource(juce::PositionableAudioSource* newSource, double newSourceSampleRate)
+{
+    source = newSource;
+    sourceSampleRate = newSourceSampleRate;
+    nextOutputPosition = 0;
+    step = 1.0;
+    buffered = 0;
+}
+
+void ResamplerSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    // Keep our place if the device rate changes under a playing track.
+    const double inputPosition = static_cast<double>(nextOutputPosition) * step;
+
+    outputSampleRate = sampleRate;
+    step = (sourceSampleRate > 0.0 && sampleRate > 0.0) ? sourceSampleRate / sampleRate : 1.0;
+
+    if (source != nullptr)
+        source->prepareToPlay(static_cast<int>(std::ceil(samplesPerBlockExpected * step)), sourceSampleRate);
+
+    load.store(0.0f, std::memory_order_relaxed);
+
+    if (isPassThrough())
+        return;
+
+    // When downsampling, everything above the new Nyquist must go: the cutoff
+    // drops with the ratio and the kernels get longer to keep their steepness.
+    const double bandwidth = juce::jmin(1.0, 1.0 / step);
+    const int tapScale = static_cast<int>(std::ceil(1.0 / bandwidth));
+
+    fastTable.build(FastTaps * tapScale, bandwidth * 0.90, 6.0);
+    bestTable.build(BestTaps * tapScale, bandwidth * 0.96, 9.0);
+
+    history = bestTable.taps / 2 - 1;
+    lookahead = bestTable.taps / 2;
+    maxChunk = juce::jmax(256, samplesPerBlockExpected);
+
+    const int capacity = history + static_cast<int>(std::ceil(maxChunk * step)) + lookahead + 2;
+    input.setSize(MaxChannels, capacity, false, true, false);
+
+    nextOutputPosition = static_cast<juce::int64>(inputPosition / step);
+    seekInput(inputPosition);
+}
+
+void ResamplerSource::releaseResources()
+{
+    if (source != nullptr)
+        source->releaseResources();
+}
+
+void ResamplerSource::setNextReadPosition(juce::int64 newPosition)
+{
+    nextOutputPosition = newPosition;
+
+    if (isPassThrough())
+    {
+        if (source != nullptr)
+            source->setNextReadPosition(newPosition);
+        return;
+    }
+
+    seekInput(static_cast<double>(newPosition) * step);
+}
+
+juce::int64 ResamplerSource::getNextReadPosition() const
+{
+    if (source == nullptr)
+        return 0;
+    if (isPassThrough())
+        return source->getNextReadPosition();
+
+    const juce::int64 length = getTotalLength();
+    return (isLooping() && length > 0) ? nextOutputPosition % length : nextOutputPosition;
+}
+
+juce::int64 ResamplerSource::getTotalLength() const
+{
+    if (source == nullptr)
+        return 0;
+    if (isPassThrough())
+        return source->getTotalLength();
+
+    return static_cast<juce::int64>(static_cast<double>(source->getTotalLength()) / step);
+}
+
+bool ResamplerSource::isLooping() const
+{
+    return source != nullptr && source->isLooping();
+}
+
+void ResamplerSource::setLooping(bool shouldLoop)
+{
+    if (source != nullptr)
+        source->setLooping(shouldLoop);
+}
+
+//============================================================================
+// seekInput: the buffer always starts `history` samples before the read
+// position. Those are read from the file too, so a seek doesn't ring; only
+// the part before the start of the track is zero.
+void ResamplerSource::seekInput(double inputPosition)
+{
+    const juce::int64 whole = static_cast<juce::int64>(std::floor(inputPosition));
+    const juce::int64 start = whole - history;
+    const int zeros = static_cast<int>(juce::jmax<juce::int64>(0, -start));
+
+    for (int ch = 0; ch < input.getNumChannels(); ++ch)
+        juce::FloatVectorOperations::clear(input.getWritePointer(ch), zeros);
+
+    buffered = zeros;
+    readPosition = history + (inputPosition - static_cast<double>(whole));
+
+    if (source != nullptr)
+        source->setNextReadPosition(juce::jmax<juce::int64>(0, start));
+}
+
+void ResamplerSource::fillInput(int samplesNeeded)
+{
+    samplesNeeded = juce::jmin(samplesNeeded, input.getNumSamples());
+    if (buffered >= samplesNeeded)
+        return;
+
+    const juce::AudioSourceChannelInfo info(&input, buffered, samplesNeeded - buffered);
+    source->getNextAudioBlock(info);
+    buffered = samplesNeeded;
+}
+
+void ResamplerSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    if (source == nullptr)
+    {
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+
+    if (isPassThrough())
+    {
+        source->getNextAudioBlock(bufferToFill);
+        return;
+    }
+
+    const juce::int64 startTicks = juce::Time::getHighResolutionTicks();
+    const Quality currentQuality = getQuality();
+
+    auto* buffer = bufferToFill.buffer;
+    const int numChannels = juce::jmin(MaxChannels, buffer->getNumChannels());
+    float* outputs[MaxChannels] = {};
+
+    for (int done = 0; done < bufferToFill.numSamples;)
+    {
+        const int numSamples = juce::jmin(maxChunk, bufferToFill.numSamples - done);
+
+        // Enough input for the last output sample of this chunk plus the kernel's right half.
+        const double lastPosition = readPosition + (numSamples - 1) * step;
+        fillInput(static_cast<int>(lastPosition) + lookahead + 1);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            outputs[ch] = buffer->getWritePointer(ch, bufferToFill.startSample + done);
+
+        render(outputs, numChannels, numSamples, currentQuality);
+        discardConsumedInput();
+        done += numSamples;
+    }
+
+    for (int ch = numChannels; ch < buffer->getNumChannels(); ++ch)
+        buffer->clear(ch, bufferToFill.startSample, bufferToFill.numSamples);
+
+    nextOutputPosition += bufferToFill.numSamples;
+    recordLoad(juce::Time::getHighResolutionTicks() - startTicks, bufferToFill.numSamples);
+}
+
+//============================================================================
+// render: numSamples outputs per channel starting at readPosition, then
+// advance it. Every channel walks the same positions.
+void ResamplerSource::render(float* const* output, int numChannels, int numSamples, Quality q)
+{
+    const SincTable* table = q == SincBest ? &bestTable : (q == SincFast ? &fastTable : nullptr);
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        const float* in = input.getReadPointer(juce::jmin(ch, input.getNumChannels() - 1));
+        float* out = output[ch];
+        double position = readPosition;
+
+        if (q == Linear)
+        {
+            for (int s = 0; s < numSamples; ++s, position += step)
+            {
+                const int i = static_cast<int>(position);
+                const float f = static_cast<float>(position - i);
+                out[s] = in[i] + f * (in[i + 1] - in[i]);
+            }
+        }
+        else if (q == Lagrange)
+        {
+            for (int s = 0; s < numSamples; ++s, position += step)
+            {
+                const int i = static_cast<int>(position);
+                const float f = static_cast<float>(position - i);
+
+                const float fm1 = f - 1.0f;
+                const float fm2 = f - 2.0f;
+                const float fp1 = f + 1.0f;
+
+                out[s] = in[i - 1] * (-f * fm1 * fm2 / 6.0f)
+                       + in[i]     * (fp1 * fm1 * fm2 / 2.0f)
+                       + in[i + 1] * (-fp1 * f * fm2 / 2.0f)
+                       + in[i + 2] * (fp1 * f * fm1 / 6.0f);
+            }
+        }
+        else
+        {
+            const int taps = table->taps;
+            const int leftTaps = taps / 2 - 1;
+
+            for (int s = 0; s < numSamples; ++s, position += step)
+            {
+                const int i = static_cast<int>(position);
+                const float phase = static_cast<float>((position - i) * NumPhases);
+                const int row = juce::jmin(static_cast<int>(phase), NumPhases - 1);
+                const float blend = phase - static_cast<float>(row);
+
+                const float* h0 = table->row(row);
+                const float* h1 = table->row(row + 1);
+                const float* x = in + i - leftTaps;
+
+                // Two independent dot products; the compiler vectorises both.
+                float acc0 = 0.0f, acc1 = 0.0f;
+                for (int k = 0; k < taps; ++k)
+                {
+                    acc0 += x[k] * h0[k];
+                    acc1 += x[k] * h1[k];
+                }
+                out[s] = acc0 + blend * (acc1 - acc0);
+            }
+        }
+    }
+
+    readPosition += numSamples * step;
+}
+
+void ResamplerSource::discardConsumedInput()
+{
+    const int consumed = juce::jmin(static_cast<int>(readPosition) - history, buffered);
+    if (consumed <= 0)
+        return;
+
+    const int remaining = buffered - consumed;
+    for (int ch = 0; ch < input.getNumChannels(); ++ch)
+    {
+        float* data = input.getWritePointer(ch);
+        std::memmove(data, data + consumed, static_cast<size_t>(remaining) * sizeof(float));
+    }
+
+    buffered = remaining;
+    readPosition -= consumed;
+}
+
+void ResamplerSource::recordLoad(juce::int64 ticks, int numSamples)
+{
+    const double periodSeconds = numSamples / outputSampleRate;
+    const float fraction = static_cast<float>(juce::Time::highResolutionTicksToSeconds(ticks) / periodSeconds);
+
+    const float previous = load.load(std::memory_order_relaxed);
+    load.store(previous + 0.05f * (fraction - previous), std::memory_order_relaxed);
+}
+
+//============================================================================
+// measureCostPerChannelSecond: render a stretch of looping noise through a
+// private instance and divide the time taken by the channel-seconds produced.
+double ResamplerSource::measureCostPerChannelSecond(Quality q, double sourceRate, double outputRate,
+                                                    double secondsToRender)
+{
+    juce::AudioBuffer<float> noise(MaxChannels, static_cast<int>(sourceRate * 2.0));
+    juce::Random random(0x5eed);
+    for (int ch = 0; ch < noise.getNumChannels(); ++ch)
+        for (int i = 0; i < noise.getNumSamples(); ++i)
+            noise.setSample(ch, i, random.nextFloat() * 2.0f - 1.0f);
+
+    juce::MemoryAudioSource noiseSource(noise, false, true);
+
+    ResamplerSource resampler;
+    resampler.setSource(&noiseSource, sourceRate);
+    resampler.setQuality(q);
+
+    constexpr int blockSize = 512;
+    resampler.prepareToPlay(blockSize, outputRate);
+
+    juce::AudioBuffer<float> block(MaxChannels, blockSize);
+    const juce::int64 totalSamples = static_cast<juce::int64>(secondsToRender * outputRate);
+
+    const juce::int64 startTicks = juce::Time::getHighResolutionTicks();
+    for (juce::int64 rendered = 0; rendered < totalSamples; rendered += blockSize)
+    {
+        const juce::AudioSourceChannelInfo info(&block, 0, blockSize);
+        resampler.getNextAudioBlock(info);
+    }
+    const double elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+
+    resampler.releaseResources();
+
+    const double channelSeconds = static_cast<double>(totalSamples) / outputRate * MaxChannels;
+    return elapsed / channelSeconds;
+}
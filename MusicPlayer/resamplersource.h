@@ -0,0 +1,103 @@
+#ifndef RESAMPLERSOURCE_H
+#define RESAMPLERSOURCE_H
+
+#include <juce_audio_basics/juce_audio_basics.h>
+
+#include <atomic>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// ResamplerSource: converts a track from its file rate to the device rate
+// below the transport, so the transport, the effects and the analyzer all run
+// at the true device rate and the transport never resamples on its own.
+//
+// Positions (getNextReadPosition, getTotalLength) are in output samples, which
+// is what the transport expects from a source it doesn't correct.
+//
+// Quality tiers, cheapest first:
+//   Linear    - 2-point linear interpolation, no anti-aliasing
+//   Lagrange  - 4-point cubic Lagrange, no anti-aliasing
+//   SincFast  - polyphase windowed sinc, 16 taps (scaled up when downsampling)
+//   SincBest  - polyphase windowed sinc, 64 taps (scaled up when downsampling)
+//
+// The tier can be switched at any time; the audio thread picks it up at the
+// start of the next block. All tables are built in prepareToPlay(), so the
+// callback never allocates. When the rates match it is a straight pass-through.
+// -----------------------------------------------------------------------------
+class ResamplerSource : public juce::PositionableAudioSource
+{
+public:
+    enum Quality { Linear = 0, Lagrange, SincFast, SincBest, NumQualities };
+
+    ResamplerSource() = default;
+
+    // Source to read from (not owned) and the rate its samples are at.
+    // Call only while nothing is pulling audio from this object.
+    void setSource(juce::PositionableAudioSource* newSource, double newSourceSampleRate);
+
+    void setQuality(Quality newQuality) { quality.store(newQuality, std::memory_order_relaxed); }
+    Quality getQuality() const { return static_cast<Quality>(quality.load(std::memory_order_relaxed)); }
+    static const char* getQualityName(Quality q);
+
+    // Smoothed share of the buffer period spent resampling (0..1).
+    float getLoad() const { return load.load(std::memory_order_relaxed); }
+
+    // CPU seconds one tier spends per channel-second of output, measured on
+    // noise run through a fresh instance.
+    static double measureCostPerChannelSecond(Quality q, double sourceRate, double outputRate,
+                                              double secondsToRender = 10.0);
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    void setNextReadPosition(juce::int64 newPosition) override;
+    juce::int64 getNextReadPosition() const override;
+    juce::int64 getTotalLength() const override;
+    bool isLooping() const override;
+    void setLooping(bool shouldLoop) override;
+
+private:
+    static constexpr int MaxChannels = 2;
+    static constexpr int NumPhases = 256;
+    static constexpr int FastTaps = 16;
+    static constexpr int BestTaps = 64;
+
+    struct SincTable
+    {
+        int taps = 0;
+        std::vector<float> coefficients;  // (NumPhases + 1) rows of `taps`
+
+        void build(int numTaps, double cutoff, double kaiserBeta);
+        const float* row(int phase) const { return coefficients.data() + phase * taps; }
+    };
+
+    bool isPassThrough() const { return source == nullptr || outputSampleRate <= 0.0 || sourceSampleRate == outputSampleRate; }
+
+    // Restart the input buffer so the next output sample is at inputPosition.
+    void seekInput(double inputPosition);
+    void fillInput(int samplesNeeded);
+    void render(float* const* output, int numChannels, int numSamples, Quality q);
+    void discardConsumedInput();
+    void recordLoad(juce::int64 ticks, int numSamples);
+
+    juce::PositionableAudioSource* source = nullptr;
+    double sourceSampleRate = 0.0;
+    double outputSampleRate = 0.0;
+    double step = 1.0;                  // input samples per output sample
+
+    SincTable fastTable, bestTable;
+    int history = 0;                    // input samples kept before the read position
+    int lookahead = 0;                  // input samples needed after it
+    int maxChunk = 0;                   // output samples rendered per input refill
+
+    juce::AudioBuffer<float> input;
+    int buffered = 0;                   // valid samples in `input`
+    double readPosition = 0.0;          // fractional index into `input`
+    juce::int64 nextOutputPosition = 0;
+
+    std::atomic<int> quality { SincFast };
+    std::atomic<float> load { 0.0f };
+};
+
+#endif // RESAMPLERSOURCE_H
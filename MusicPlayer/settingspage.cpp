@@ -1,6 +1,12 @@
 #include <QFileDialog>
+#include <QFileInfo>
+#include <QLabel>
+#include <QMessageBox>
+#include <QVBoxLayout>
 #include <QSettings>
 
+#include <algorithm>
+
 
 #include "settingspage.h"
 #include "librarymanager.h"
@@ -19,8 +25,383 @@ SettingsPage::SettingsPage(QWidget *parent, MediaController *externalMediaContro
         const QString cur = mediaController->currentMusicFolder();
         ui->selectDir->setText(cur.isEmpty() ? tr("Choose Music Folder…") : cur);
         ui->currentDir->setText("Current Dir: "+ LibraryManager::instance().libraryManager().getCurrentMusicDirectory());
+
+        populateAudioDeviceControls();
+        setupEffectsControls();
+        connect(ui->deviceTypeCombo, &QComboBox::currentIndexChanged, this, &SettingsPage::onDeviceTypeChanged);
+
+        // Poll the callback telemetry; the audio thread only ever writes atomics.
+        connect(&telemetryTimer, &QTimer::timeout, this, &SettingsPage::refreshTelemetry);
+        telemetryTimer.start(500);
+    }
+
+    // Library scans run in the background; show how far along one is.
+    LibraryManager& lm = LibraryManager::instance().libraryManager();
+    if (lm.isScanning())
+        ui->scanStatusLabel->setText(tr("Scanning…"));
+    ui->cancelScanBtn->setEnabled(lm.isScanning());
+    connect(&lm, &LibraryManager::scanStarted, this, [this]() {
+        ui->scanStatusLabel->setText(tr("Scanning…"));
+        ui->cancelScanBtn->setEnabled(true);
+    });
+    connect(&lm, &LibraryManager::scanProgress, this, [this](int done, int found) {
+        ui->scanStatusLabel->setText(tr("Scanning… %1 of %2 tracks").arg(done).arg(found));
+    });
+    connect(&lm, &LibraryManager::scanFinished, this, [this](bool cancelled) {
+        const int count = LibraryManager::instance().getMasterTracks().size();
+        ui->scanStatusLabel->setText(cancelled ? tr("Scan cancelled")
+                                               : tr("%1 tracks").arg(count));
+        ui->cancelScanBtn->setEnabled(false);
+    });
+
+    populateLibraryRoots();
+    connect(ui->libraryRootsList, &QListWidget::currentRowChanged, this, &SettingsPage::onLibraryRootSelected);
+    connect(ui->includeEdit, &QLineEdit::editingFinished, this, &SettingsPage::storeRootGlobs);
+    connect(ui->excludeEdit, &QLineEdit::editingFinished, this, &SettingsPage::storeRootGlobs);
+}
+
+namespace
+{
+QStringList splitGlobs(const QString& text)
+{
+    QStringList globs = text.split(';', Qt::SkipEmptyParts);
+    for (QString& glob : globs)
+        glob = glob.trimmed();
+    globs.removeAll(QString());
+    return globs;
+}
+} // namespace
+
+void SettingsPage::populateLibraryRoots()
+{
+    editedRoots = LibraryManager::instance().getLibraryRoots();
+    if (editedRoots.isEmpty()) {
+        // Not scanned yet; start from the music folder alone.
+        LibraryRoot primary;
+        primary.path = LibraryManager::instance().getCurrentMusicDirectory();
+        editedRoots.append(primary);
+    }
+
+    const QSignalBlocker blocker(ui->libraryRootsList);
+    ui->libraryRootsList->clear();
+    for (const LibraryRoot& root : editedRoots) {
+        ui->libraryRootsList->addItem(root.isPrimary() ? tr("%1 (music folder)").arg(root.path)
+                                                       : root.path);
+    }
+    ui->libraryRootsList->setCurrentRow(0);
+    onLibraryRootSelected(0);
+}
+
+void SettingsPage::onLibraryRootSelected(int row)
+{
+    const bool valid = row >= 0 && row < editedRoots.size();
+    ui->includeEdit->setEnabled(valid);
+    ui->excludeEdit->setEnabled(valid);
+    // The music folder is changed with "Select Music Folder", not removed.
+    ui->removeRootBtn->setEnabled(valid && !editedRoots[row].isPrimary());
+
+    ui->includeEdit->setText(valid ? editedRoots[row].include.join("; ") : QString());
+    ui->excludeEdit->setText(valid ? editedRoots[row].exclude.join("; ") : QString());
+}
+
+void SettingsPage::storeRootGlobs()
+{
+    const int row = ui->libraryRootsList->currentRow();
+    if (row < 0 || row >= editedRoots.size())
+        return;
+
+    editedRoots[row].include = splitGlobs(ui->includeEdit->text());
+    editedRoots[row].exclude = splitGlobs(ui->excludeEdit->text());
+}
+
+void SettingsPage::on_addRootBtn_clicked()
+{
+    QString dir = QFileDialog::getExistingDirectory(
+        this,
+        tr("Add Library Folder"),
+        QDir::homePath(),
+        QFileDialog::ShowDirsOnly | QFileDialog::DontResolveSymlinks
+        );
+    if (dir.isEmpty())
+        return;
+
+    for (const LibraryRoot& root : editedRoots) {
+        if (QDir(root.path) == QDir(dir)) {
+            QMessageBox::information(this, tr("Library Folders"), tr("That folder is already in the library."));
+            return;
+        }
+    }
+
+    // The id prefixes this root's tracks in the playlists, so it must be
+    // unique and stay put; the folder's name makes it readable.
+    QString base = QFileInfo(dir).fileName().remove(':').trimmed();
+    if (base.isEmpty())
+        base = "root";
+    QString id = base;
+    for (int n = 2; std::any_of(editedRoots.cbegin(), editedRoots.cend(),
+                                [&id](const LibraryRoot& root) { return root.id == id; }); ++n)
+        id = base + '-' + QString::number(n);
+
+    LibraryRoot root;
+    root.id = id;
+    root.path = dir;
+    editedRoots.append(root);
+
+    ui->libraryRootsList->addItem(dir);
+    ui->libraryRootsList->setCurrentRow(static_cast<int>(editedRoots.size() - 1));
+}
+
+void SettingsPage::on_removeRootBtn_clicked()
+{
+    const int row = ui->libraryRootsList->currentRow();
+    if (row < 0 || row >= editedRoots.size() || editedRoots[row].isPrimary())
+        return;
+
+    editedRoots.removeAt(row);
+    delete ui->libraryRootsList->takeItem(row);
+}
+
+void SettingsPage::on_applyLibraryBtn_clicked()
+{
+    storeRootGlobs();
+    if (!LibraryManager::instance().setLibraryRoots(editedRoots))
+        QMessageBox::warning(this, tr("Library Folders"), tr("The music folder doesn't exist; nothing was scanned."));
+    populateLibraryRoots();
+}
+
+void SettingsPage::populateAudioDeviceControls()
+{
+    AudioPlayback* playback = mediaController->getAudioPlayback();
+    const AudioDeviceSettings active = playback->getActiveDeviceSettings();
+
+    const QSignalBlocker blocker(ui->deviceTypeCombo);
+    ui->deviceTypeCombo->clear();
+    ui->deviceTypeCombo->addItems(playback->getAvailableDeviceTypes());
+    ui->deviceTypeCombo->setCurrentText(active.deviceType);
+
+    populateOutputDevices(active.deviceType, active.outputDevice);
+    populateRateAndBufferCombos();
+
+    // Resampling quality applies straight away; no need to reopen the device.
+    if (ui->resamplerCombo->count() == 0) {
+        for (int q = 0; q < ResamplerSource::NumQualities; ++q)
+            ui->resamplerCombo->addItem(ResamplerSource::getQualityName(static_cast<ResamplerSource::Quality>(q)), q);
+        ui->resamplerCombo->setCurrentIndex(static_cast<int>(playback->getResamplerQuality()));
+
+        connect(ui->resamplerCombo, &QComboBox::currentIndexChanged, this, [playback, this](int index) {
+            playback->setResamplerQuality(static_cast<ResamplerSource::Quality>(ui->resamplerCombo->itemData(index).toInt()));
+        });
+
+        // Thread policy changes reopen the device so its thread starts under them.
+        const ThreadPolicy::Settings policy = playback->getThreadPolicy();
+        ui->threadPolicyCheck->setChecked(policy.enabled);
+        ui->pinThreadsCheck->setChecked(policy.pinThreads);
+        ui->pinThreadsCheck->setEnabled(policy.enabled);
+
+        auto applyThreadPolicy = [playback, this] {
+            ThreadPolicy::Settings settings = playback->getThreadPolicy();
+            settings.enabled = ui->threadPolicyCheck->isChecked();
+            settings.pinThreads = ui->pinThreadsCheck->isChecked();
+            ui->pinThreadsCheck->setEnabled(settings.enabled);
+            playback->setThreadPolicy(settings);
+        };
+        connect(ui->threadPolicyCheck, &QCheckBox::toggled, this, applyThreadPolicy);
+        connect(ui->pinThreadsCheck, &QCheckBox::toggled, this, applyThreadPolicy);
+
+        // Band analysis for the visualizer; switches at the next audio block.
+        for (int m = 0; m < SpectrumAnalyzer::NumModes; ++m)
+            ui->analysisModeCombo->addItem(SpectrumAnalyzer::getModeName(static_cast<SpectrumAnalyzer::Mode>(m)), m);
+        ui->analysisModeCombo->setCurrentIndex(static_cast<int>(playback->getAnalysisMode()));
+
+        connect(ui->analysisModeCombo, &QComboBox::currentIndexChanged, this, [playback, this](int index) {
+            playback->setAnalysisMode(static_cast<SpectrumAnalyzer::Mode>(ui->analysisModeCombo->itemData(index).toInt()));
+        });
+
+        ui->separationCheck->setChecked(playback->isSeparationEnabled());
+        connect(ui->separationCheck, &QCheckBox::toggled, this, [playback](bool checked) {
+            playback->setSeparationEnabled(checked);
+        });
+    }
+}
+
+void SettingsPage::populateOutputDevices(const QString& deviceType, const QString& selected)
+{
+    ui->outputDeviceCombo->clear();
+    ui->outputDeviceCombo->addItems(mediaController->getAudioPlayback()->getAvailableOutputDevices(deviceType));
+    if (!selected.isEmpty())
+        ui->outputDeviceCombo->setCurrentText(selected);
+}
+
+void SettingsPage::populateRateAndBufferCombos()
+{
+    AudioPlayback* playback = mediaController->getAudioPlayback();
+    const AudioDeviceSettings active = playback->getActiveDeviceSettings();
+
+    // Rates and buffer sizes are what the currently open device supports;
+    // they are refreshed after Apply opens a different one.
+    ui->sampleRateCombo->clear();
+    for (double rate : playback->getAvailableSampleRates()) {
+        ui->sampleRateCombo->addItem(QString("%1 Hz").arg(rate, 0, 'f', 0), rate);
+        if (qFuzzyCompare(rate, active.sampleRate))
+            ui->sampleRateCombo->setCurrentIndex(ui->sampleRateCombo->count() - 1);
+    }
+
+    ui->bufferSizeCombo->clear();
+    for (int size : playback->getAvailableBufferSizes()) {
+        const double ms = active.sampleRate > 0.0 ? 1000.0 * size / active.sampleRate : 0.0;
+        ui->bufferSizeCombo->addItem(QString("%1 samples (%2 ms)").arg(size).arg(ms, 0, 'f', 1), size);
+        if (size == active.bufferSize)
+            ui->bufferSizeCombo->setCurrentIndex(ui->bufferSizeCombo->count() - 1);
     }
+}
+
+void SettingsPage::setupEffectsControls()
+{
+    AudioPlayback* playback = mediaController->getAudioPlayback();
+    DspParameters& params = playback->getDspParameters();
+
+    // One vertical slider per EQ band, in whole dB.
+    for (int b = 0; b < DspParameters::NumEqBands; ++b) {
+        const float frequency = DspParameters::eqFrequencies[b];
+
+        auto* column = new QVBoxLayout();
+        auto* slider = new QSlider(Qt::Vertical, ui->effectsGroup);
+        slider->setRange(-static_cast<int>(DspParameters::maxEqGainDb), static_cast<int>(DspParameters::maxEqGainDb));
+        slider->setValue(qRound(params.eqGainDb[b].load()));
+        slider->setMinimumHeight(100);
+
+        auto* label = new QLabel(frequency >= 1000.0f ? QString("%1k").arg(frequency / 1000.0f)
+                                                      : QString::number(qRound(frequency)),
+                                 ui->effectsGroup);
+        label->setAlignment(Qt::AlignCenter);
+
+        column->addWidget(slider, 0, Qt::AlignHCenter);
+        column->addWidget(label);
+        ui->eqBandLayout->addLayout(column);
 
+        connect(slider, &QSlider::valueChanged, this, [playback, b](int value) {
+            playback->getDspParameters().eqGainDb[b].store(static_cast<float>(value));
+            playback->saveDspSettings();
+        });
+        eqSliders[b] = slider;
+    }
+
+    ui->eqEnabledCheck->setChecked(params.eqEnabled.load());
+    ui->widenerEnabledCheck->setChecked(params.widenerEnabled.load());
+    ui->widthSlider->setValue(qRound(params.stereoWidth.load() * 100.0f));
+    ui->limiterEnabledCheck->setChecked(params.limiterEnabled.load());
+    ui->limiterThresholdSlider->setValue(qRound(params.limiterThresholdDb.load()));
+
+    connect(ui->eqEnabledCheck, &QCheckBox::toggled, this, [playback](bool on) {
+        playback->getDspParameters().eqEnabled.store(on);
+        playback->saveDspSettings();
+    });
+    connect(ui->widenerEnabledCheck, &QCheckBox::toggled, this, [playback](bool on) {
+        playback->getDspParameters().widenerEnabled.store(on);
+        playback->saveDspSettings();
+    });
+    connect(ui->widthSlider, &QSlider::valueChanged, this, [playback](int percent) {
+        playback->getDspParameters().stereoWidth.store(percent / 100.0f);
+        playback->saveDspSettings();
+    });
+    connect(ui->limiterEnabledCheck, &QCheckBox::toggled, this, [playback](bool on) {
+        playback->getDspParameters().limiterEnabled.store(on);
+        playback->saveDspSettings();
+    });
+    connect(ui->limiterThresholdSlider, &QSlider::valueChanged, this, [playback](int db) {
+        playback->getDspParameters().limiterThresholdDb.store(static_cast<float>(db));
+        playback->saveDspSettings();
+    });
+}
+
+void SettingsPage::on_eqFlatBtn_clicked()
+{
+    for (QSlider* slider : eqSliders)
+        if (slider)
+            slider->setValue(0);
+}
+
+void SettingsPage::onDeviceTypeChanged(int index)
+{
+    if (index < 0)
+        return;
+    populateOutputDevices(ui->deviceTypeCombo->itemText(index), QString());
+}
+
+void SettingsPage::on_applyAudioBtn_clicked()
+{
+    AudioDeviceSettings requested;
+    requested.deviceType   = ui->deviceTypeCombo->currentText();
+    requested.outputDevice = ui->outputDeviceCombo->currentText();
+    requested.sampleRate   = ui->sampleRateCombo->currentData().toDouble();
+    requested.bufferSize   = ui->bufferSizeCombo->currentData().toInt();
+
+    // A new driver type has its own rates and buffer sizes; let it pick
+    // defaults rather than forcing values from the previous device.
+    if (requested.deviceType != mediaController->getAudioPlayback()->getActiveDeviceSettings().deviceType) {
+        requested.sampleRate = 0.0;
+        requested.bufferSize = 0;
+    }
+
+    QString error;
+    if (!mediaController->getAudioPlayback()->applyDeviceSettings(requested, error)) {
+        QMessageBox::warning(this, tr("Audio Device"), tr("Could not open the audio device:\n%1").arg(error));
+        populateAudioDeviceControls();
+        return;
+    }
+
+    // Persist what the device actually accepted, not just what was asked for.
+    mediaController->getAudioPlayback()->getActiveDeviceSettings().save();
+    populateAudioDeviceControls();
+}
+
+void SettingsPage::refreshTelemetry()
+{
+    if (!isVisible())
+        return;
+
+    AudioPlayback* playback = mediaController->getAudioPlayback();
+    const CallbackTelemetry::Snapshot t = playback->getTelemetry();
+
+    ui->cpuLoadLabel->setText(QString("%1% of %2 ms (worst %3 ms)")
+                                  .arg(t.cpuLoad * 100.0f, 0, 'f', 1)
+                                  .arg(t.bufferPeriodMs, 0, 'f', 2)
+                                  .arg(t.maxDurationMs, 0, 'f', 2));
+
+    const int driverXRuns = playback->getDeviceXRunCount();
+    ui->xrunLabel->setText(QString("%1 overruns, %2 late callbacks%3")
+                               .arg(t.overruns)
+                               .arg(t.lateCallbacks)
+                               .arg(driverXRuns >= 0 ? QString(", driver: %1").arg(driverXRuns) : QString()));
+
+    // One text bar per 10% of the buffer period, scaled to the busiest bucket.
+    uint32_t peak = 1;
+    for (uint32_t count : t.histogram)
+        peak = std::max(peak, count);
+
+    QStringList rows;
+    for (int i = 0; i < CallbackTelemetry::NumBuckets; ++i) {
+        const QString range = i < CallbackTelemetry::NumBuckets - 1
+                                  ? QString("%1-%2%").arg(i * 10, 3).arg((i + 1) * 10, 3)
+                                  : QString("  >100%");
+        const int bar = static_cast<int>(20.0 * t.histogram[i] / peak);
+        rows << QString("%1 %2 %3").arg(range, QString(bar, QChar('#')).leftJustified(20)).arg(t.histogram[i]);
+    }
+    ui->callbackHistogramLabel->setText(rows.join('\n'));
+
+    // What the audio thread was actually granted when the device started.
+    const ThreadPolicy::Report thread = playback->getAudioThreadReport();
+    ui->audioThreadLabel->setText(QString::fromStdString(thread.details.toStdString())
+                                  + (thread.privilegeMissing ? tr(" (not permitted for this user)") : QString()));
+
+    // Per-stage cost of resampling and effects, as a share of the same buffer period.
+    const DspChainSource::StageLoads loads = playback->getDspStageLoads();
+    QStringList costs;
+    costs << QString("Resampler %1%").arg(playback->getResamplerLoad() * 100.0f, 0, 'f', 2);
+    for (int stage = 0; stage < DspChainSource::NumStages; ++stage)
+        costs << QString("%1 %2%").arg(DspChainSource::getStageName(static_cast<DspChainSource::Stage>(stage)))
+                                   .arg(loads[stage] * 100.0f, 0, 'f', 2);
+    ui->dspCostLabel->setText(costs.join("   "));
 }
 
 void SettingsPage::on_selectDir_clicked()
@@ -53,6 +434,12 @@ void SettingsPage::on_selectDir_clicked()
     ui->selectDir->setText(dir);
 
     LibraryManager::instance().scanDirectory();
+    populateLibraryRoots();
+}
+
+void SettingsPage::on_cancelScanBtn_clicked()
+{
+    LibraryManager::instance().cancelScan();
 }
 
 SettingsPage::~SettingsPage()
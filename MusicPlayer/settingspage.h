@@ -3,7 +3,13 @@
 
 #include <QWidget>
 #include <QDir>
+#include <QTimer>
+#include <QSlider>
+#include <QVector>
 
+#include <array>
+
+#include "libraryroot.h"
 #include "mediacontroller.h"
 
 namespace Ui {
@@ -22,11 +28,35 @@ public:
 
 private slots:
     void on_selectDir_clicked();
+    void on_cancelScanBtn_clicked();
+    void on_addRootBtn_clicked();
+    void on_removeRootBtn_clicked();
+    void on_applyLibraryBtn_clicked();
+    void onLibraryRootSelected(int row);
+    void storeRootGlobs();
+    void on_applyAudioBtn_clicked();
+    void onDeviceTypeChanged(int index);
+    void refreshTelemetry();
+    void on_eqFlatBtn_clicked();
 
 private:
+    // Fill the device combos from what the driver reports, selecting the active setup.
+    void populateAudioDeviceControls();
+    void populateOutputDevices(const QString& deviceType, const QString& selected);
+    void populateRateAndBufferCombos();
+
+    // Show the library roots; edits stay in editedRoots until applied.
+    void populateLibraryRoots();
+
+    // Build the EQ sliders and wire every effect control to the DspParameters.
+    void setupEffectsControls();
+
     Ui::SettingsPage *ui;
     MediaController *mediaController;
     QDir currentMusicFolder;
+    QTimer telemetryTimer;
+    std::array<QSlider*, DspParameters::NumEqBands> eqSliders {};
+    QVector<LibraryRoot> editedRoots;   // the primary root first
 };
 
 #endif // SETTINGSPAGE_H
@@ -0,0 +1,399 @@
+#include "spectrumanalyzer.h"
+
+#include <algorithm>
+#include <cmath>
+
+SpectrumAnalyzer::SpectrumAnalyzer()
+    : fft(FftBackend::createFastestOrJuce(fftOrder)),
+    fftInput(fftSize, 0.0f),
+    fftData(fftSize * 2, 0.0f),  // FFT requires an array of size 2*fftSize.
+    fftWindow(fftSize, 0.0f),
+    frequencyBands{},
+    lowFft(FftBackend::createFastestOrJuce(lowFftOrder)),
+    highFft(FftBackend::createFastestOrJuce(highFftOrder)),
+    lowInput(lowFftSize, 0.0f),
+    lowData(lowFftSize * 2, 0.0f),
+    lowWindow(lowFftSize, 0.0f),
+    highInput(highFftSize, 0.0f),
+    highData(highFftSize * 2, 0.0f),
+    highWindow(highFftSize, 0.0f)
+{
+    // Initialize Hann windows for the FFTs.
+    fillHannWindow(fftWindow);
+    fillHannWindow(lowWindow);
+    fillHannWindow(highWindow);
+
+    prepareMultirate();
+
+    // Percussive medians span roughly 100 Hz of bins (5.4-5.9 Hz each in the
+    // 8192-point and decimated spectra) and 400 Hz in the short high one.
+    separator.prepare(fftSize, harmonicFrames, 17);
+    lowSeparator.prepare(lowFftSize, harmonicFrames, 17);
+    highSeparator.prepare(highFftSize, harmonicFrames, 9);
+}
+
+void SpectrumAnalyzer::fillHannWindow(std::vector<float>& window)
+{
+    const size_t size = window.size();
+    for (size_t i = 0; i < size; ++i)
+        window[i] = 0.5f * (1.0f - std::cos(2.0f * juce::MathConstants<float>::pi * i / (size - 1)));
+}
+
+const char* SpectrumAnalyzer::getModeName(Mode mode)
+{
+    switch (mode)
+    {
+        case Fft:        return "FFT (8192)";
+        case Filterbank: return "Filterbank (low latency)";
+        case Multirate:  return "Multirate (decimated)";
+        case NumModes:   break;
+    }
+    return "";
+}
+
+void SpectrumAnalyzer::prepare(double newSampleRate)
+{
+    if (newSampleRate > 0.0)
+        sampleRate = newSampleRate;
+
+    useFastestFfts();
+    prepareFilterbank();
+    prepareMultirate();
+}
+
+// The constructor doesn't wait for the FFT backends to be measured; once a
+// size has been, its engine is swapped for the winner here.
+void SpectrumAnalyzer::useFastestFfts()
+{
+    for (std::unique_ptr<FftBackend>* engine : { &fft, &lowFft, &highFft })
+    {
+        const int order = (*engine)->getOrder();
+        if (FftBackend::isFastestKnown(order) && (*engine)->getKind() != FftBackend::getFastest(order))
+            *engine = FftBackend::createFastest(order);
+    }
+}
+
+void SpectrumAnalyzer::prepareFilterbank()
+{
+    std::array<BandFilterbank<NumBands>::BandEdges, NumBands> edges {};
+    BandLevels levelScales {};
+    for (int band = 0; band < NumBands; ++band)
+    {
+        edges[band] = { bandRanges[band].min, bandRanges[band].max };
+
+        // Read what the FFT mode reads for a sine at the filter's centre.
+        const double high = juce::jmin(0.45 * sampleRate, static_cast<double>(bandRanges[band].max));
+        levelScales[band] = getFftToneLevel(band, std::sqrt(bandRanges[band].min * high));
+    }
+
+    filterbank.prepare(edges, sampleRate, levelScales);
+    filterbankReady = false;
+}
+
+void SpectrumAnalyzer::prepareMultirate()
+{
+    // Largest power-of-two factor that leaves at least 2.4 kHz, so the 500 Hz
+    // top of the low bands stays inside the decimator's passband (about 3 kHz
+    // at 48 kHz and 96 kHz, 2.8 kHz at 44.1 kHz).
+    int factor = 1;
+    while (factor < 64 && sampleRate / (factor * 2) >= 2400.0)
+        factor *= 2;
+
+    decimator.prepare(factor, sampleRate);
+    lowBuffer.clear();
+    highBuffer.clear();
+}
+
+void SpectrumAnalyzer::reset()
+{
+    sampleBuffer.clear();
+    decimator.reset();
+    lowBuffer.clear();
+    highBuffer.clear();
+    filterbank.reset();
+    filterbankReady = false;
+    frequencyBands.fill(0.0f);
+
+    separator.reset();
+    lowSeparator.reset();
+    highSeparator.reset();
+    separation = Separation();
+    separationUpdated = false;
+    samplesSinceSeparation = 0;
+}
+
+void SpectrumAnalyzer::pushSamples(const float* samples, int numSamples)
+{
+    // Switching modes starts the new one from silence.
+    const Mode newMode = requestedMode.load(std::memory_order_relaxed);
+    if (newMode != mode)
+    {
+        mode = newMode;
+        reset();
+    }
+
+    // Separation also restarts from an empty history.
+    const bool separate = separationRequested.load(std::memory_order_relaxed);
+    if (separate != separationActive)
+    {
+        separationActive = separate;
+        separator.reset();
+        lowSeparator.reset();
+        highSeparator.reset();
+        separation = Separation();
+        samplesSinceSeparation = 0;
+    }
+
+    if (samples == nullptr || numSamples <= 0)
+        return;
+
+    if (separationActive)
+        samplesSinceSeparation += numSamples;
+
+    if (mode == Filterbank)
+    {
+        filterbank.process(samples, numSamples);
+        filterbankReady = true;
+    }
+    else if (mode == Multirate)
+    {
+        // Decimate in chunks the scratch buffer can always hold.
+        const int chunkSize = (static_cast<int>(decimated.size()) - 1) * decimator.getFactor();
+        for (int offset = 0; offset < numSamples; offset += chunkSize)
+        {
+            const int chunk = juce::jmin(chunkSize, numSamples - offset);
+            const int produced = decimator.process(samples + offset, chunk, decimated.data());
+            lowBuffer.pushSamples(decimated.data(), static_cast<size_t>(produced));
+        }
+
+        highBuffer.pushSamples(samples, static_cast<size_t>(numSamples));
+    }
+    else
+    {
+        sampleBuffer.pushSamples(samples, static_cast<size_t>(numSamples));
+    }
+}
+
+bool SpectrumAnalyzer::isReady() const
+{
+    if (mode == Filterbank)
+        return filterbankReady;
+
+    if (mode == Multirate)
+        return lowBuffer.size() >= static_cast<size_t>(lowFftSize)
+               && highBuffer.size() >= static_cast<size_t>(highFftSize);
+
+    return sampleBuffer.size() >= static_cast<size_t>(fftSize);
+}
+
+//============================================================================
+// performFFT: Captures fftSize samples from sampleBuffer, applies windowing,
+// performs an FFT, and analyzes frequency bands.
+void SpectrumAnalyzer::performFFT()
+{
+    separationUpdated = false;
+
+    if (mode == Filterbank)
+    {
+        filterbank.getLevels(frequencyBands);
+        filterbankReady = false;
+        return;
+    }
+
+    if (mode == Multirate)
+    {
+        performMultirate();
+        return;
+    }
+
+    if (!transform(*fft, sampleBuffer, fftWindow, fftInput, fftData))
+        return;
+
+    // Analyze frequency bands.
+    analyzeFrequencyBands(fftData, fftSize, sampleRate, 0, NumBands, 1.0f);
+
+    if (separationDue())
+    {
+        separation.harmonicEnergy = 0.0f;
+        separation.percussiveEnergy = 0.0f;
+        separateBands(separator, fftData, fftSize, sampleRate, 0, NumBands, 1.0f);
+        samplesSinceSeparation = 0;
+        separationUpdated = true;
+    }
+}
+
+//============================================================================
+// performMultirate: the low bands from the decimated window, the high bands
+// from the short full-rate one.
+void SpectrumAnalyzer::performMultirate()
+{
+    if (!transform(*lowFft, lowBuffer, lowWindow, lowInput, lowData)
+        || !transform(*highFft, highBuffer, highWindow, highInput, highData))
+        return;
+
+    // A tone's peak bin grows with the FFT size and its band's bin count
+    // with size / rate, so a band average of the decimated spectrum reads
+    // 1 / decimation of the full-rate one. At 44.1/48 kHz (1 in 16) that
+    // matches the Fft mode bin for bin; at 88.2/96 kHz (1 in 32) the bass is
+    // resolved twice as finely and bands of a few bins can differ a little.
+    // Bands 14-15 span many bins at either size, so they need no scaling.
+    const float lowScale = static_cast<float>(decimator.getFactor());
+
+    analyzeFrequencyBands(lowData, lowFftSize, decimator.getOutputRate(), 0, multirateLowBands, lowScale);
+    analyzeFrequencyBands(highData, highFftSize, sampleRate, multirateLowBands, NumBands, 1.0f);
+
+    if (separationDue())
+    {
+        separation.harmonicEnergy = 0.0f;
+        separation.percussiveEnergy = 0.0f;
+        separateBands(lowSeparator, lowData, lowFftSize, decimator.getOutputRate(), 0, multirateLowBands, lowScale);
+        separateBands(highSeparator, highData, highFftSize, sampleRate, multirateLowBands, NumBands, 1.0f);
+        samplesSinceSeparation = 0;
+        separationUpdated = true;
+    }
+}
+
+//============================================================================
+// transform: Copies the window's worth of samples out of `buffer`, applies the
+// window and performs the FFT into `data`.
+bool SpectrumAnalyzer::transform(FftBackend& engine, const CircularBuffer& buffer,
+                                 const std::vector<float>& window, std::vector<float>& input,
+                                 std::vector<float>& data)
+{
+    const size_t size = window.size();
+    buffer.getBuffer(input);
+
+    if (input.size() < size)
+    {
+        juce::Logger::writeToLog("Not enough samples in circular buffer: " + juce::String(input.size()));
+        return false;
+    }
+
+    // The backends take the windowed samples contiguously in the first half
+    // of data; the second half is their scratch space for the spectrum.
+    for (size_t i = 0; i < size; ++i)
+        data[i] = input[i] * window[i];
+    std::fill(data.begin() + static_cast<std::ptrdiff_t>(size), data.end(), 0.0f);
+
+    // Perform the FFT.
+    engine.performRealForward(data.data());
+    return true;
+}
+
+//============================================================================
+// analyzeFrequencyBands: Processes a spectrum to compute average amplitudes
+// for a range of the defined bands.
+void SpectrumAnalyzer::analyzeFrequencyBands(const std::vector<float>& data, int size, double rate,
+                                             int firstBand, int endBand, float scale)
+{
+    for (int band = firstBand; band < endBand; ++band)
+    {
+        int startBin = 0, endBin = 0;
+        getBandBins(band, size, rate, startBin, endBin);
+        float sum = 0.0f;
+        for (int i = startBin; i < endBin; ++i)
+        {
+            // In a real-only FFT, the output is stored in interleaved format.
+            float re = data[i * 2];
+            float im = data[i * 2 + 1];
+            float magnitude = std::sqrt(re * re + im * im);
+            sum += magnitude;
+        }
+        if (endBin > startBin)
+            frequencyBands[band] = scale * sum / (endBin - startBin);
+        else
+            frequencyBands[band] = 0.0f;
+    }
+}
+
+//============================================================================
+// getBandBins: Converts a band's frequency range (Hz) to FFT bin indices.
+void SpectrumAnalyzer::getBandBins(int band, int size, double rate, int& startBin, int& endBin)
+{
+    const float binRate = static_cast<float>(rate);
+    startBin = juce::jlimit(0, size / 2, static_cast<int>(bandRanges[band].min * size / binRate));
+    endBin   = juce::jlimit(0, size / 2, static_cast<int>(bandRanges[band].max * size / binRate));
+}
+
+//============================================================================
+// getFftToneLevel: A Hann-windowed sine of amplitude 1 puts
+// (fftSize / 4) |sinc(d) / (1 - d^2)| into the bin d bins away from it (its
+// peak and half that in each neighbour); a band reads the average over its
+// bins.
+float SpectrumAnalyzer::getFftToneLevel(int band, double frequency) const
+{
+    int startBin = 0, endBin = 0;
+    getBandBins(band, fftSize, sampleRate, startBin, endBin);
+    if (endBin <= startBin)
+        return 0.0f;
+
+    const double pi = juce::MathConstants<double>::pi;
+    const double toneBin = frequency * fftSize / sampleRate;
+    double sum = 0.0;
+    for (int i = startBin; i < endBin; ++i)
+    {
+        const double d = std::abs(i - toneBin);
+        if (d < 1.0e-6)
+            sum += 1.0;
+        else if (std::abs(d - 1.0) < 1.0e-6)
+            sum += 0.5;
+        else
+            sum += std::abs(std::sin(pi * d) / (pi * d) / (1.0 - d * d));
+    }
+    return static_cast<float>(fftSize / 4.0 * sum / (endBin - startBin));
+}
+
+bool SpectrumAnalyzer::separationDue() const
+{
+    return separationActive && samplesSinceSeparation >= separationHop;
+}
+
+//============================================================================
+// separateBands: Splits the spectrum, then averages each part over the bands
+// exactly as analyzeFrequencyBands() does the whole. The energies cover the
+// same bins, normalised so a full-scale sine comes out at about 1: its
+// Hann-windowed peak is size / 4 and the peak's two neighbours hold half that.
+// That holds at any size and rate, so unlike the levels the energies take no
+// scale. In Multirate a tone just under 500 Hz also leaks into the short
+// window's band 14 bins and is counted there again (up to about 1.5).
+void SpectrumAnalyzer::separateBands(HarmonicPercussiveSeparator& splitter, const std::vector<float>& data, int size,
+                                     double rate, int firstBand, int endBand, float scale)
+{
+    splitter.process(data.data());
+    const std::vector<float>& harmonic = splitter.getHarmonic();
+    const std::vector<float>& percussive = splitter.getPercussive();
+
+    const float peak = size / 4.0f;
+    const float energyNorm = 1.0f / (peak * peak * 1.5f);
+
+    for (int band = firstBand; band < endBand; ++band)
+    {
+        int startBin = 0, endBin = 0;
+        getBandBins(band, size, rate, startBin, endBin);
+
+        float harmonicSum = 0.0f, percussiveSum = 0.0f;
+        float harmonicPower = 0.0f, percussivePower = 0.0f;
+        for (int i = startBin; i < endBin; ++i)
+        {
+            harmonicSum += harmonic[i];
+            percussiveSum += percussive[i];
+            harmonicPower += harmonic[i] * harmonic[i];
+            percussivePower += percussive[i] * percussive[i];
+        }
+
+        const int bins = endBin - startBin;
+        separation.harmonic[band] = bins > 0 ? scale * harmonicSum / bins : 0.0f;
+        separation.percussive[band] = bins > 0 ? scale * percussiveSum / bins : 0.0f;
+        separation.harmonicEnergy += harmonicPower * energyNorm;
+        separation.percussiveEnergy += percussivePower * energyNorm;
+    }
+}
+
+//============================================================================
+// getFrequencyBandLevel: Returns the computed amplitude for a given frequency band.
+float SpectrumAnalyzer::getFrequencyBandLevel(FrequencyBand band) const
+{
+    if (band >= 0 && band < NumBands)
+        return frequencyBands[band];
+    return 0.0f;
+}
@@ -0,0 +1,226 @@
+#ifndef SPECTRUMANALYZER_H
+#define SPECTRUMANALYZER_H
+
+#include <juce_core/juce_core.h>
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "CircularBuffer.h"
+#include "bandfilterbank.h"
+#include "fftbackend.h"
+#include "harmonicpercussive.h"
+#include "polyphasedecimator.h"
+
+// -----------------------------------------------------------------------------
+// SpectrumAnalyzer: turns the captured samples into the 16 frequency band
+// levels sent to the visualizer, in one of three modes:
+//
+//   Fft        - keeps the most recent fftSize samples and measures each band
+//                from an 8192-point spectrum. Precise, but a transient only
+//                shows once it is well inside the window (90-190 ms).
+//   Filterbank - runs every captured block through a BandFilterbank built
+//                from the same bandRanges. New levels after every block.
+//   Multirate  - bands 0-13 (all below 500 Hz) from a 512-point FFT of the
+//                signal decimated to about 3 kHz, bands 14-15 from a
+//                1024-point FFT at the full rate. The bass keeps the Fft
+//                mode's resolution for a fraction of the work, and the two
+//                upper bands follow a transient within ~20 ms.
+//
+// Every FFT goes through the fastest FftBackend for its size on this machine,
+// from the first prepare() after it has been measured (Juce until then).
+//
+// Optionally (setSeparationEnabled) the FFT modes also split their spectra
+// into harmonic and percussive parts with a HarmonicPercussiveSeparator, one
+// frame every separationHop samples, and measure the bands of each part:
+// drums and sustained tones as two separate band sets.
+//
+// Free of Qt and platform code so the headless renderer can share it.
+// -----------------------------------------------------------------------------
+class SpectrumAnalyzer
+{
+public:
+    SpectrumAnalyzer();
+
+    enum FrequencyBand {
+        Band0 = 0,
+        Band1,
+        Band2,
+        Band3,
+        Band4,
+        Band5,
+        Band6,
+        Band7,
+        Band8,
+        Band9,
+        Band10,
+        Band11,
+        Band12,
+        Band13,
+        Band14,
+        Band15,
+        NumBands   // = 16
+    };
+
+    // Closed‑form, precomputed min/max for each band
+    struct BandRange { float min; float max; };
+
+    static constexpr std::array<BandRange, NumBands> bandRanges = {{
+        // 14 bands from 20 → 500 Hz (ratio ≈ (500/20)^(1/14) ≈ 1.2585)
+        {  20.00f,   25.17f },  // Band0
+        {  25.17f,   31.68f },  // Band1
+        {  31.68f,   39.86f },  // Band2
+        {  39.86f,   50.17f },  // Band3
+        {  50.17f,   63.14f },  // Band4
+        {  63.14f,   79.46f },  // Band5
+        {  79.46f,  100.00f },  // Band6
+        { 100.00f,  125.85f },  // Band7
+        { 125.85f,  158.38f },  // Band8
+        { 158.38f,  199.32f },  // Band9
+        { 199.32f,  250.85f },  // Band10
+        { 250.85f,  315.69f },  // Band11
+        { 315.69f,  397.30f },  // Band12
+        { 397.30f,  500.00f },  // Band13
+
+        // 2 bands from 500 → 20 kHz (ratio ≈ √(20000/500) ≈ 6.3249)
+        { 500.00f, 3162.28f },  // Band14
+        {3162.28f,20000.00f }   // Band15
+    }};
+
+    using BandLevels = std::array<float, NumBands>;
+
+    // Band levels of the harmonic and percussive parts of the spectrum, on
+    // the same scale as the plain levels, plus the power of each part
+    // relative to a full-scale sine (a sine of amplitude a gives about a^2).
+    struct Separation
+    {
+        BandLevels harmonic {};
+        BandLevels percussive {};
+        float harmonicEnergy = 0.0f;
+        float percussiveEnergy = 0.0f;
+    };
+
+    enum Mode { Fft = 0, Filterbank, Multirate, NumModes };
+    static const char* getModeName(Mode mode);
+
+    // Any thread; the audio thread switches at its next pushSamples().
+    void setMode(Mode newMode) { requestedMode.store(newMode, std::memory_order_relaxed); }
+    Mode getMode() const { return requestedMode.load(std::memory_order_relaxed); }
+
+    static constexpr int fftOrder = 13;            // 2^13 = 8192 samples
+    static constexpr int fftSize  = 1 << fftOrder; // FFT size
+
+    // Multirate mode: bands below this one come from the decimated signal.
+    static constexpr int multirateLowBands = Band14;
+    static constexpr int lowFftOrder  = 9;             // 512 samples after decimation
+    static constexpr int lowFftSize   = 1 << lowFftOrder;
+    static constexpr int highFftOrder = 10;            // 1024 samples at the full rate
+    static constexpr int highFftSize  = 1 << highFftOrder;
+
+    // Separation: a frame every ~21 ms at 48 kHz (or every block, if blocks
+    // are longer), harmonic median over 9 frames (~190 ms).
+    static constexpr int separationHop = 1024;
+    static constexpr int harmonicFrames = 9;
+
+    // Sample rate of the samples being pushed (the rate the chain runs at).
+    // Not on the audio thread: it may swap FFT engines.
+    void prepare(double newSampleRate);
+
+    // Forget captured samples and band levels.
+    void reset();
+
+    // Append captured samples (mono). In filterbank mode this is where they
+    // are analysed.
+    void pushSamples(const float* samples, int numSamples);
+
+    // True once a full FFT window has been captured (both windows in
+    // multirate mode), or in filterbank mode once a block has been analysed
+    // since the last update.
+    bool isReady() const;
+
+    // Update the band levels: perform the FFT(s) on the captured samples, or
+    // in filterbank mode take the levels the last block left behind.
+    void performFFT();
+
+    // Any thread; the audio thread picks it up at its next pushSamples().
+    void setSeparationEnabled(bool enabled) { separationRequested.store(enabled, std::memory_order_relaxed); }
+    bool isSeparationEnabled() const { return separationRequested.load(std::memory_order_relaxed); }
+
+    // Whether the last performFFT() produced a new separation frame.
+    bool hasNewSeparation() const { return separationUpdated; }
+    const Separation& getSeparation() const { return separation; }
+
+    // Get level of a specific frequency band
+    float getFrequencyBandLevel(FrequencyBand band) const;
+
+    // Access computed frequency band levels
+    const BandLevels& getFreqBands() const { return frequencyBands; }
+
+private:
+    static void fillHannWindow(std::vector<float>& window);
+    static bool transform(FftBackend& engine, const CircularBuffer& buffer, const std::vector<float>& window,
+                          std::vector<float>& input, std::vector<float>& data);
+
+    // Average magnitude of bands [firstBand, endBand) in a spectrum of `size`
+    // points taken at `rate`, times `scale`.
+    void analyzeFrequencyBands(const std::vector<float>& data, int size, double rate,
+                               int firstBand, int endBand, float scale);
+
+    // FFT bins [startBin, endBin) that make up a band.
+    static void getBandBins(int band, int size, double rate, int& startBin, int& endBin);
+
+    // Fft-mode level of band `band` for a sine of amplitude 1 at `frequency`.
+    float getFftToneLevel(int band, double frequency) const;
+
+    // Whether a separation frame is due; counts the samples since the last.
+    bool separationDue() const;
+    // Split a spectrum and measure bands [firstBand, endBand) of each part
+    // into `separation`, adding to its energies.
+    void separateBands(HarmonicPercussiveSeparator& splitter, const std::vector<float>& data, int size,
+                       double rate, int firstBand, int endBand, float scale);
+
+    void useFastestFfts();
+    void prepareFilterbank();
+    void prepareMultirate();
+    void performMultirate();
+
+    double sampleRate = 44100.0;
+
+    std::atomic<Mode> requestedMode { Fft };
+    Mode mode = Fft;                               // audio thread
+    BandFilterbank<NumBands> filterbank;
+    bool filterbankReady = false;
+
+    std::unique_ptr<FftBackend> fft;               // FFT engine
+    std::vector<float> fftInput;                   // Logical-order copy of the window
+    std::vector<float> fftData;                    // Buffer for FFT
+    std::vector<float> fftWindow;                  // Window function (Hann)
+    BandLevels frequencyBands;                     // Average magnitudes per band
+
+    // Buffer to store recent audio samples
+    CircularBuffer sampleBuffer{fftSize};
+
+    // Multirate mode.
+    PolyphaseDecimator decimator;
+    std::array<float, 64> decimated {};            // decimator output, one chunk
+    std::unique_ptr<FftBackend> lowFft;
+    std::unique_ptr<FftBackend> highFft;
+    std::vector<float> lowInput, lowData, lowWindow;
+    std::vector<float> highInput, highData, highWindow;
+    CircularBuffer lowBuffer{lowFftSize};          // decimated samples
+    CircularBuffer highBuffer{highFftSize};        // full-rate samples
+
+    // Separation; one separator per spectrum the current mode produces.
+    std::atomic<bool> separationRequested { false };
+    bool separationActive = false;                 // audio thread
+    HarmonicPercussiveSeparator separator;         // Fft mode
+    HarmonicPercussiveSeparator lowSeparator;      // Multirate mode, low bands
+    HarmonicPercussiveSeparator highSeparator;     // Multirate mode, high bands
+    Separation separation;
+    bool separationUpdated = false;
+    int samplesSinceSeparation = 0;
+};
+
+#endif // SPECTRUMANALYZER_H
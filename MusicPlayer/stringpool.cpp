@@ -0,0 +1,58 @@
+#include "stringpool.h"
+
+#include <algorithm>
+#include <numeric>
+
+StringPool::StringPool()
+{
+    strings.append(QString());
+    ids.insert(QString(), 0);
+}
+
+quint32 StringPool::intern(const QString& s)
+{
+    const auto it = ids.constFind(s);
+    if (it != ids.cend())
+        return it.value();
+
+    // Keep a copy of our own, so a string built in a larger buffer (a
+    // mid() or a reader's scratch) doesn't keep that buffer alive.
+    const QString copy(s.constData(), s.size());
+    const quint32 id = static_cast<quint32>(strings.size());
+    strings.append(copy);
+    ids.insert(copy, id);
+    return id;
+}
+
+std::vector<quint32> StringPool::ranks() const
+{
+    std::vector<quint32> order(static_cast<size_t>(strings.size()));
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [this](quint32 a, quint32 b) {
+        return strings[a].compare(strings[b], Qt::CaseInsensitive) < 0;
+    });
+
+    std::vector<quint32> rank(order.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        rank[order[i]] = static_cast<quint32>(i);
+    return rank;
+}
+
+qsizetype StringPool::heapBytes(const QString& s)
+{
+    // QArrayData: reference count, flags and capacity, then the characters
+    // and a terminating null.
+    constexpr qsizetype header = 16;
+    return s.isEmpty() ? 0 : header + (s.capacity() + 1) * qsizetype(sizeof(QChar));
+}
+
+qsizetype StringPool::memoryUsage() const
+{
+    // Each string's data is shared by the table and the hash key.
+    qsizetype bytes = strings.capacity() * qsizetype(sizeof(QString));
+    for (const QString& s : strings)
+        bytes += heapBytes(s);
+    // Per hash entry: the key, the id and about a span slot's worth.
+    bytes += ids.capacity() * qsizetype(sizeof(QString) + sizeof(quint32) + 8);
+    return bytes;
+}
@@ -0,0 +1,46 @@
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// StringPool: each distinct string once, under a 32-bit id, for columns
+// where the same few values repeat (artists, albums, folders, codecs).
+// Id 0 is the empty string.
+//
+// Strings are never released: ids stay valid for the pool's lifetime, and
+// the set of artists, albums and folders in a library grows slowly.
+// -----------------------------------------------------------------------------
+class StringPool
+{
+public:
+    StringPool();
+
+    // The id of s, adding it if it is new.
+    quint32 intern(const QString& s);
+
+    const QString& at(quint32 id) const { return strings.at(id); }
+    int size() const { return static_cast<int>(strings.size()); }
+
+    // Each id's place among the pool's strings sorted case-insensitively,
+    // so columns of ids sort by comparing integers.
+    std::vector<quint32> ranks() const;
+
+    // Bytes held: the strings, the table of them and the lookup hash
+    // (approximately; allocator overhead isn't counted).
+    qsizetype memoryUsage() const;
+
+    // Heap bytes behind one QString: its data block (header and UTF-16
+    // buffer), or nothing if it is empty.
+    static qsizetype heapBytes(const QString& s);
+
+private:
+    QVector<QString> strings;
+    QHash<QString, quint32> ids;
+};
+
+#endif // STRINGPOOL_H
@@ -0,0 +1,240 @@
+#include "threadpolicy.h"
+
+#if JUCE_WINDOWS
+ #include <windows.h>
+ #include <avrt.h>
+#elif JUCE_LINUX
+ #include <pthread.h>
+ #include <sched.h>
+ #include <sys/resource.h>
+ #include <sys/syscall.h>
+ #include <unistd.h>
+ #include <cerrno>
+ #include <cstring>
+#elif JUCE_MAC
+ #include <pthread.h>
+ #include <pthread/qos.h>
+#endif
+
+namespace
+{
+#if JUCE_LINUX
+// SCHED_FIFO priority for the audio thread: above threaded interrupt handlers
+// (50) but well below the kernel's own watchdogs (99).
+constexpr int audioFifoPriority = 70;
+constexpr int backgroundNice = 5;
+#endif
+} // namespace
+
+juce::SpinLock ThreadPolicy::currentLock;
+ThreadPolicy::Settings ThreadPolicy::current;
+std::atomic<uint32_t> ThreadPolicy::generation { 1 };
+
+void ThreadPolicy::setCurrent(const Settings& settings)
+{
+    {
+        const juce::SpinLock::ScopedLockType lock(currentLock);
+        current = settings;
+    }
+    generation.fetch_add(1, std::memory_order_release);
+}
+
+ThreadPolicy::Settings ThreadPolicy::getCurrent()
+{
+    const juce::SpinLock::ScopedLockType lock(currentLock);
+    return current;
+}
+
+void ThreadPolicy::applyIfChanged(Role role)
+{
+    thread_local uint32_t appliedGeneration = 0;
+
+    const uint32_t latest = generation.load(std::memory_order_acquire);
+    if (appliedGeneration == latest)
+        return;
+    appliedGeneration = latest;
+
+    const Report report = applyToCurrentThread(role, getCurrent());
+    if (report.privilegeMissing)
+        DBG(describe(report));
+}
+
+ThreadPolicy::Report ThreadPolicy::applyToCurrentThread(Role role, const Settings& settings)
+{
+    Report report;
+    report.role = role;
+
+    if (!settings.enabled)
+    {
+        report.details = "policy off, default scheduling";
+        return report;
+    }
+
+    report.applied = setPriority(role, report);
+    if (settings.pinThreads)
+        report.pinned = setAffinity(role, settings, report);
+
+    return report;
+}
+
+const char* ThreadPolicy::getRoleName(Role role)
+{
+    switch (role)
+    {
+        case Role::Audio:      return "audio";
+        case Role::Background: return "background";
+    }
+    return "";
+}
+
+juce::String ThreadPolicy::describe(const Report& report)
+{
+    juce::String line = juce::String(getRoleName(report.role)) + " thread: " + report.details;
+    if (report.privilegeMissing)
+        line << " [insufficient privilege]";
+    return line;
+}
+
+//============================================================================
+// Priority
+
+bool ThreadPolicy::setPriority(Role role, Report& report)
+{
+#if JUCE_WINDOWS
+    if (role == Role::Audio)
+    {
+        // MMCSS schedules the thread in the "Pro Audio" class, above anything
+        // a normal-priority process can do, without needing admin rights.
+        DWORD taskIndex = 0;
+        if (HANDLE task = AvSetMmThreadCharacteristicsW(L"Pro Audio", &taskIndex))
+        {
+            AvSetMmThreadPriority(task, AVRT_PRIORITY_CRITICAL);
+            report.details = "MMCSS Pro Audio, critical";
+            return true;
+        }
+
+        const DWORD error = GetLastError();
+        SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+        report.privilegeMissing = error == ERROR_ACCESS_DENIED;
+        report.details = "MMCSS unavailable (error " + juce::String(static_cast<int>(error))
+                         + "), time-critical priority instead";
+        return false;
+    }
+
+    if (!SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL))
+    {
+        report.details = "SetThreadPriority failed (error " + juce::String(static_cast<int>(GetLastError())) + ")";
+        return false;
+    }
+    report.details = "below normal";
+    return true;
+
+#elif JUCE_LINUX
+    if (role == Role::Audio)
+    {
+        sched_param param {};
+        param.sched_priority = juce::jmin(audioFifoPriority, sched_get_priority_max(SCHED_FIFO));
+
+        const int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (error == 0)
+        {
+            report.details = "SCHED_FIFO priority " + juce::String(param.sched_priority);
+            return true;
+        }
+
+        report.privilegeMissing = error == EPERM;
+        report.details = error == EPERM
+                             ? "SCHED_FIFO refused; needs CAP_SYS_NICE or an rtprio limit (e.g. \"@audio - rtprio 95\" in /etc/security/limits.conf)"
+                             : "SCHED_FIFO failed: " + juce::String(std::strerror(error));
+        return false;
+    }
+
+    // Niceness is per thread on Linux when addressed by thread id.
+    const auto tid = static_cast<id_t>(syscall(SYS_gettid));
+    if (setpriority(PRIO_PROCESS, tid, backgroundNice) != 0)
+    {
+        const int error = errno;
+        report.privilegeMissing = error == EACCES || error == EPERM;
+        report.details = "nice " + juce::String(backgroundNice) + " refused: " + juce::String(std::strerror(error));
+        return false;
+    }
+    report.details = "nice " + juce::String(backgroundNice);
+    return true;
+
+#elif JUCE_MAC
+    if (role == Role::Audio)
+    {
+        // Core Audio's IO thread is already time-constrained; leave it alone.
+        report.details = "managed by Core Audio";
+        return true;
+    }
+
+    if (pthread_set_qos_class_self_np(QOS_CLASS_UTILITY, 0) != 0)
+    {
+        report.details = "QoS class refused";
+        return false;
+    }
+    report.details = "QoS utility";
+    return true;
+
+#else
+    juce::ignoreUnused(role);
+    report.details = "not supported on this platform";
+    return false;
+#endif
+}
+
+//============================================================================
+// Affinity
+
+bool ThreadPolicy::setAffinity(Role role, const Settings& settings, Report& report)
+{
+    const int numCores = juce::SystemStats::getNumCpus();
+    if (numCores < 2)
+    {
+        report.details << ", not pinned (single core)";
+        return false;
+    }
+
+    const int audioCore = settings.audioCore >= 0 && settings.audioCore < numCores ? settings.audioCore
+                                                                                   : numCores - 1;
+
+#if JUCE_WINDOWS
+    const int usableCores = juce::jmin(numCores, 64);
+    DWORD_PTR mask = 0;
+    for (int core = 0; core < usableCores; ++core)
+        if ((role == Role::Audio) == (core == audioCore))
+            mask |= static_cast<DWORD_PTR>(1) << core;
+
+    if (mask == 0 || SetThreadAffinityMask(GetCurrentThread(), mask) == 0)
+    {
+        report.details << ", pinning failed";
+        return false;
+    }
+
+#elif JUCE_LINUX
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (int core = 0; core < numCores; ++core)
+        if ((role == Role::Audio) == (core == audioCore))
+            CPU_SET(core, &cpus);
+
+    const int error = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    if (error != 0)
+    {
+        report.details << ", pinning failed: " << std::strerror(error);
+        return false;
+    }
+
+#else
+    juce::ignoreUnused(role, audioCore);
+    report.details << ", pinning not supported on this platform";
+    return false;
+#endif
+
+    if (role == Role::Audio)
+        report.details << ", pinned to core " << audioCore;
+    else
+        report.details << ", kept off core " << audioCore;
+    return true;
+}
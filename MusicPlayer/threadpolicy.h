@@ -0,0 +1,78 @@
+#ifndef THREADPOLICY_H
+#define THREADPOLICY_H
+
+#include <juce_core/juce_core.h>
+
+#include <atomic>
+#include <cstdint>
+
+// -----------------------------------------------------------------------------
+// ThreadPolicy: how the engine's threads are scheduled, so the audio callback
+// doesn't have to compete with decoding, library scans and the UI on equal
+// terms. Each thread applies it to itself once, by role:
+//
+//   Audio      - real time: MMCSS "Pro Audio" on Windows, SCHED_FIFO on Linux
+//                (Core Audio already runs its IO thread time-constrained).
+//                The spectrum analysis runs here too, inside the callback.
+//   Background - below normal: decoding, prefetching, scanning, and
+//                forwarding transport events to the UI
+//
+// With pinning on, the audio thread gets a core to itself and every other
+// role is kept off that core. Real-time scheduling often needs privileges the
+// process doesn't have (CAP_SYS_NICE or an rtprio limit on Linux, a running
+// MMCSS service on Windows); that is reported, not treated as an error, and
+// the thread keeps running with whatever it was allowed.
+//
+// The settings in force are process-wide (setCurrent()). Worker threads call
+// applyIfChanged() when they pick up work and re-apply only after a change.
+// Turning the policy off leaves threads as they are until they are recreated:
+// taking a priority back down can itself need privileges.
+// -----------------------------------------------------------------------------
+class ThreadPolicy
+{
+public:
+    enum class Role { Audio, Background };
+
+    struct Settings
+    {
+        bool enabled = true;
+        bool pinThreads = false;
+        int audioCore = -1;   // with pinning; -1: the last core
+    };
+
+    struct Report
+    {
+        Role role = Role::Audio;
+        bool applied = false;            // the requested priority is in effect
+        bool pinned = false;
+        bool privilegeMissing = false;   // the OS refused for lack of rights
+        juce::String details;            // what was done, or why not
+    };
+
+    // Apply the policy for `role` to the calling thread. Makes system calls,
+    // so call it once when a thread starts, not per block.
+    static Report applyToCurrentThread(Role role, const Settings& settings);
+
+    // The settings every thread should follow.
+    static void setCurrent(const Settings& settings);
+    static Settings getCurrent();
+
+    // Apply the current settings to the calling thread unless it already has
+    // them. One atomic load when nothing changed.
+    static void applyIfChanged(Role role);
+
+    static const char* getRoleName(Role role);
+
+    // One line for logs and the settings page.
+    static juce::String describe(const Report& report);
+
+private:
+    static juce::SpinLock currentLock;
+    static Settings current;
+    static std::atomic<uint32_t> generation;
+
+    static bool setPriority(Role role, Report& report);
+    static bool setAffinity(Role role, const Settings& settings, Report& report);
+};
+
+#endif // THREADPOLICY_H
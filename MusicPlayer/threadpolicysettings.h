@@ -0,0 +1,33 @@
+#ifndef THREADPOLICYSETTINGS_H
+#define THREADPOLICYSETTINGS_H
+
+#include <QSettings>
+
+#include "threadpolicy.h"
+
+// -----------------------------------------------------------------------------
+// ThreadPolicySettings: persists ThreadPolicy::Settings in QSettings under
+// "threads/". Kept out of threadpolicy.h so the policy itself stays Qt-free.
+// -----------------------------------------------------------------------------
+struct ThreadPolicySettings
+{
+    static ThreadPolicy::Settings load()
+    {
+        QSettings settings("FractalWave", "FractalWave");
+        ThreadPolicy::Settings s;
+        s.enabled    = settings.value("threads/policyEnabled", true).toBool();
+        s.pinThreads = settings.value("threads/pinThreads", false).toBool();
+        s.audioCore  = settings.value("threads/audioCore", -1).toInt();
+        return s;
+    }
+
+    static void save(const ThreadPolicy::Settings& s)
+    {
+        QSettings settings("FractalWave", "FractalWave");
+        settings.setValue("threads/policyEnabled", s.enabled);
+        settings.setValue("threads/pinThreads", s.pinThreads);
+        settings.setValue("threads/audioCore", s.audioCore);
+    }
+};
+
+#endif // THREADPOLICYSETTINGS_H
@@ -0,0 +1,226 @@
+#include "timestretchsource.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+constexpr float twoPi = juce::MathConstants<float>::twoPi;
+
+// Wrap a phase into [-pi, pi).
+inline float principalArgument(float phase)
+{
+    return phase - twoPi * std::floor((phase + juce::MathConstants<float>::pi) / twoPi);
+}
+} // namespace
+
+TimeStretchSource::TimeStretchSource(juce::AudioSource* sourceToWrap)
+    : wrappedSource(sourceToWrap)
+{
+}
+
+void TimeStretchSource::setSpeed(double newSpeed)
+{
+    speed.store(juce::jlimit(MinSpeed, MaxSpeed, newSpeed), std::memory_order_relaxed);
+}
+
+void TimeStretchSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    if (wrappedSource != nullptr)
+        wrappedSource->prepareToPlay(samplesPerBlockExpected, sampleRate);
+
+    // Periodic Hann for analysis and synthesis. With a hop of a quarter frame
+    // the squared windows overlap-add to 1.5, which is divided out here.
+    window.resize(fftSize);
+    const float gain = std::sqrt(1.0f / 1.5f);
+    for (int n = 0; n < fftSize; ++n)
+        window[n] = gain * 0.5f * (1.0f - std::cos(twoPi * n / fftSize));
+
+    timeData.assign(fftSize, Complex());
+    freqData.assign(fftSize, Complex());
+    previousPhase.assign(fftSize / 2 + 1, 0.0f);
+    synthesisPhase.assign(fftSize / 2 + 1, 0.0f);
+
+    // A frame needs fftSize samples; one analysis hop at 2x is half a frame.
+    input.setSize(MaxChannels, fftSize + static_cast<int>(synthesisHop * MaxSpeed) + 1, false, true, false);
+    overlap.setSize(MaxChannels, fftSize, false, true, false);
+    output.setSize(MaxChannels, synthesisHop, false, true, false);
+
+    resetState();
+}
+
+void TimeStretchSource::releaseResources()
+{
+    if (wrappedSource != nullptr)
+        wrappedSource->releaseResources();
+}
+
+void TimeStretchSource::resetState()
+{
+    input.clear();
+    overlap.clear();
+    output.clear();
+    inputCount = 0;
+    outputRead = synthesisHop;
+    firstFrame = true;
+    analysisHopRemainder = 0.0;
+}
+
+double TimeStretchSource::getBufferedTrackSamples() const
+{
+    if (!stretching)
+        return 0.0;
+
+    // The unread part of the current hop stands for `speed` track samples per
+    // output sample; the input still waiting for the next frame is all ahead.
+    return inputCount + (synthesisHop - outputRead) * speed.load(std::memory_order_relaxed);
+}
+
+void TimeStretchSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    if (wrappedSource == nullptr)
+    {
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+
+    const double currentSpeed = speed.load(std::memory_order_relaxed);
+    const bool shouldStretch = currentSpeed != 1.0;
+
+    // Entering or leaving stretch mode, or a seek: start from a clean frame.
+    if (resetRequested.exchange(false, std::memory_order_relaxed) || shouldStretch != stretching)
+        resetState();
+    stretching = shouldStretch;
+
+    if (!stretching)
+    {
+        wrappedSource->getNextAudioBlock(bufferToFill);
+        return;
+    }
+
+    auto* buffer = bufferToFill.buffer;
+    const int numChannels = juce::jmin(MaxChannels, buffer->getNumChannels());
+
+    for (int done = 0; done < bufferToFill.numSamples;)
+    {
+        if (outputRead == synthesisHop)
+            processFrame(currentSpeed);
+
+        const int numToCopy = juce::jmin(synthesisHop - outputRead, bufferToFill.numSamples - done);
+        for (int ch = 0; ch < numChannels; ++ch)
+            buffer->copyFrom(ch, bufferToFill.startSample + done, output, ch, outputRead, numToCopy);
+
+        outputRead += numToCopy;
+        done += numToCopy;
+    }
+
+    for (int ch = numChannels; ch < buffer->getNumChannels(); ++ch)
+        buffer->clear(ch, bufferToFill.startSample, bufferToFill.numSamples);
+}
+
+void TimeStretchSource::pullInput(int numSamples)
+{
+    if (numSamples <= 0)
+        return;
+
+    const juce::AudioSourceChannelInfo info(&input, inputCount, numSamples);
+    wrappedSource->getNextAudioBlock(info);
+    inputCount += numSamples;
+}
+
+//============================================================================
+// processFrame: analyse fftSize input samples, advance every bin's phase by
+// its measured frequency over one synthesis hop, resynthesise and overlap-add.
+// Leaves synthesisHop finished samples in `output` and drops one analysis hop
+// (synthesisHop * speed samples) from the front of the input.
+void TimeStretchSource::processFrame(double frameSpeed)
+{
+    // Integer analysis hop; the fraction carries over so the average is exact.
+    const double exactHop = synthesisHop * frameSpeed + analysisHopRemainder;
+    const int analysisHop = juce::jmax(1, static_cast<int>(exactHop));
+    analysisHopRemainder = exactHop - analysisHop;
+
+    pullInput(fftSize - inputCount);
+
+    const float* left = input.getReadPointer(0);
+    const float* right = input.getReadPointer(1);
+
+    // Left in the real part, right in the imaginary part: one FFT for both.
+    for (int n = 0; n < fftSize; ++n)
+        timeData[n] = Complex(left[n] * window[n], right[n] * window[n]);
+
+    fft.perform(timeData.data(), freqData.data(), false);
+
+    const float hopRatio = static_cast<float>(synthesisHop) / static_cast<float>(analysisHop);
+    const int half = fftSize / 2;
+
+    for (int k = 0; k <= half; ++k)
+    {
+        // Split the packed spectrum back into the two channels.
+        const Complex z = freqData[k];
+        const Complex zMirror = std::conj(freqData[(fftSize - k) % fftSize]);
+        const Complex leftBin = 0.5f * (z + zMirror);
+        const Complex rightBin = Complex(0.0f, -0.5f) * (z - zMirror);
+
+        Complex outLeft = leftBin;
+        Complex outRight = rightBin;
+
+        // DC and Nyquist stay real (and unrotated) so the output stays real.
+        if (k != 0 && k != half)
+        {
+            const float phase = std::arg(leftBin + rightBin);
+            const float expected = twoPi * static_cast<float>(k) * static_cast<float>(analysisHop) / fftSize;
+
+            if (firstFrame)
+            {
+                synthesisPhase[k] = phase;
+            }
+            else
+            {
+                const float deviation = principalArgument(phase - previousPhase[k] - expected);
+                synthesisPhase[k] = principalArgument(synthesisPhase[k] + (expected + deviation) * hopRatio);
+            }
+            previousPhase[k] = phase;
+
+            const Complex rotation = std::polar(1.0f, synthesisPhase[k] - phase);
+            outLeft = leftBin * rotation;
+            outRight = rightBin * rotation;
+        }
+
+        // Repack: Y = L + iR, with the conjugate-symmetric upper half.
+        freqData[k] = outLeft + Complex(0.0f, 1.0f) * outRight;
+        if (k != 0 && k != half)
+            freqData[fftSize - k] = std::conj(outLeft) + Complex(0.0f, 1.0f) * std::conj(outRight);
+    }
+    firstFrame = false;
+
+    fft.perform(freqData.data(), timeData.data(), true);
+
+    // Overlap-add the windowed frame.
+    float* accumLeft = overlap.getWritePointer(0);
+    float* accumRight = overlap.getWritePointer(1);
+    for (int n = 0; n < fftSize; ++n)
+    {
+        accumLeft[n] += timeData[n].real() * window[n];
+        accumRight[n] += timeData[n].imag() * window[n];
+    }
+
+    // The first hop is complete: hand it out and shift the accumulator.
+    for (int ch = 0; ch < MaxChannels; ++ch)
+    {
+        float* accum = overlap.getWritePointer(ch);
+        output.copyFrom(ch, 0, accum, synthesisHop);
+        std::memmove(accum, accum + synthesisHop, static_cast<size_t>(fftSize - synthesisHop) * sizeof(float));
+        juce::FloatVectorOperations::clear(accum + fftSize - synthesisHop, synthesisHop);
+    }
+    outputRead = 0;
+
+    // Drop one analysis hop from the input; the rest is reused next frame.
+    const int consumed = juce::jmin(analysisHop, inputCount);
+    for (int ch = 0; ch < MaxChannels; ++ch)
+    {
+        float* data = input.getWritePointer(ch);
+        std::memmove(data, data + consumed, static_cast<size_t>(inputCount - consumed) * sizeof(float));
+    }
+    inputCount -= consumed;
+}
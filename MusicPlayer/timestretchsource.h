@@ -0,0 +1,88 @@
+#ifndef TIMESTRETCHSOURCE_H
+#define TIMESTRETCHSOURCE_H
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_dsp/juce_dsp.h>
+
+#include <atomic>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// TimeStretchSource: changes playback speed without changing pitch, using a
+// phase vocoder on juce::dsp::FFT (complex transforms both ways, which FftBackend
+// doesn't cover).
+//
+// It sits right after the transport, so the transport keeps counting in track
+// time while everything downstream (effects, capture, the visualizer) sees the
+// stretched audio that is actually played.
+//
+// Both channels go through a single complex FFT (left as the real part, right
+// as the imaginary part). Phase is advanced from the mid signal and the same
+// rotation is applied to both sides, which keeps the stereo image from
+// drifting. Every frame costs one forward and one inverse FFT per hop of
+// output, whatever the speed, and all buffers are sized in prepareToPlay().
+//
+// At exactly 1x the source is passed straight through with no added latency.
+// -----------------------------------------------------------------------------
+class TimeStretchSource : public juce::AudioSource
+{
+public:
+    static constexpr double MinSpeed = 0.5;
+    static constexpr double MaxSpeed = 2.0;
+
+    explicit TimeStretchSource(juce::AudioSource* sourceToWrap);
+
+    void setSource(juce::AudioSource* newSource) { wrappedSource = newSource; }
+
+    // Any thread; picked up at the next analysis frame.
+    void setSpeed(double newSpeed);
+    double getSpeed() const { return speed.load(std::memory_order_relaxed); }
+
+    // Any thread: drop buffered audio at the next block (after a seek or a
+    // track change, so stale audio isn't played).
+    void requestReset() { resetRequested.store(true, std::memory_order_relaxed); }
+
+    // Audio thread: track samples already pulled from the source but not yet
+    // played, i.e. how far the transport runs ahead of what is heard. About
+    // one frame while stretching, 0 at 1x.
+    double getBufferedTrackSamples() const;
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+private:
+    static constexpr int fftOrder = 11;
+    static constexpr int fftSize = 1 << fftOrder;      // 2048 samples per frame
+    static constexpr int synthesisHop = fftSize / 4;   // output samples per frame
+    static constexpr int MaxChannels = 2;
+
+    using Complex = juce::dsp::Complex<float>;
+
+    void resetState();
+    void pullInput(int numSamples);
+    void processFrame(double frameSpeed);
+
+    juce::AudioSource* wrappedSource;
+    juce::dsp::FFT fft { fftOrder };
+
+    std::atomic<double> speed { 1.0 };
+    std::atomic<bool> resetRequested { false };
+
+    // Audio thread only.
+    bool stretching = false;
+    bool firstFrame = true;
+    double analysisHopRemainder = 0.0;
+
+    std::vector<float> window;
+    std::vector<Complex> timeData, freqData;
+    std::vector<float> previousPhase, synthesisPhase;
+
+    juce::AudioBuffer<float> input;     // analysis input, oldest sample first
+    int inputCount = 0;
+    juce::AudioBuffer<float> overlap;   // overlap-add accumulator, fftSize long
+    juce::AudioBuffer<float> output;    // the hop most recently finished
+    int outputRead = synthesisHop;      // next unread sample in `output`
+};
+
+#endif // TIMESTRETCHSOURCE_H
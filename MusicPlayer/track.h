@@ -10,9 +10,20 @@ struct Track {
     QString title;
     QString artist;
     QString album;
-    QString  coverImage;  // extracted from tags, if available
+    quint64  artHash = 0;  // cover art's ArtStore key, 0 if none
+
+    // Stream info, as the metadata tool reports it (0 / empty if unknown).
+    qint64   durationMs = 0;
+    QString  codec;        // e.g. "flac", "mp3", "vorbis"
+    int      sampleRate = 0;
+    int      channels = 0;
+    int      bitRate = 0;  // bits per second
+
+    // Audio hashes (see ContentHasher); 0 until taken.
+    quint64  quickHash = 0;
+    quint64  contentHash = 0;
 };
 
-Q_DECLARE_METATYPE(Track*)
+Q_DECLARE_METATYPE(Track)
 
 #endif // TRACK_H
@@ -0,0 +1,456 @@
+#include "trackstore.h"
+
+#include <QHash>
+
+#include <algorithm>
+#include <utility>
+
+namespace
+{
+// Folder (up to and including the last '/') and file name.
+std::pair<QStringView, QStringView> splitPath(QStringView path)
+{
+    const qsizetype slash = path.lastIndexOf(u'/');
+    return { path.left(slash + 1), path.mid(slash + 1) };
+}
+
+template <typename Column>
+qsizetype columnBytes(const Column& column)
+{
+    return qsizetype(column.capacity() * sizeof(typename Column::value_type));
+}
+} // namespace
+
+quint32 TrackStore::hashPath(QStringView filePath)
+{
+    const quint64 hash = qHash(filePath);
+    return quint32(hash ^ (hash >> 32));
+}
+
+size_t TrackStore::findBucket(QStringView filePath, quint32 hash) const
+{
+    if (buckets.empty())
+        return NotFound;
+
+    // Never more than half full, so there is always an Empty to stop at.
+    const size_t mask = buckets.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        const Bucket& bucket = buckets[i];
+        if (bucket.slot == Empty)
+            return NotFound;
+        if (bucket.slot != Removed && bucket.hash == hash && matchesPath(bucket.slot, filePath))
+            return i;
+    }
+}
+
+void TrackStore::insertBucket(quint32 slot, quint32 hash)
+{
+    const size_t mask = buckets.size() - 1;
+    size_t i = hash & mask;
+    while (buckets[i].slot != Empty && buckets[i].slot != Removed)
+        i = (i + 1) & mask;
+
+    if (buckets[i].slot == Empty)
+        ++usedBuckets;
+    buckets[i] = { slot, hash };
+}
+
+void TrackStore::rehash(size_t bucketCount)
+{
+    std::vector<Bucket> old;
+    old.swap(buckets);
+    buckets.assign(bucketCount, Bucket {});
+    usedBuckets = 0;
+
+    // Removed markers are left behind.
+    for (const Bucket& bucket : old) {
+        if (bucket.slot != Empty && bucket.slot != Removed)
+            insertBucket(bucket.slot, bucket.hash);
+    }
+}
+
+bool TrackStore::matchesPath(quint32 slot, QStringView filePath) const
+{
+    const auto [folder, name] = splitPath(filePath);
+    return text(fileNames[slot]) == name && folderPool.at(folders[slot]) == folder;
+}
+
+QString TrackStore::joinPath(quint32 folder, TextRef name) const
+{
+    const QString& folderPath = folderPool.at(folder);
+    QString path;
+    path.reserve(folderPath.size() + qsizetype(name.length));
+    path.append(folderPath);
+    path.append(text(name));
+    return path;
+}
+
+void TrackStore::setText(TextRef& ref, QStringView s)
+{
+    // Rescans mostly store what is already there.
+    if (text(ref) == s)
+        return;
+
+    releaseText(ref);
+    if (s.isEmpty())
+        return;
+
+    ref.offset = quint32(arena.size());
+    ref.length = quint32(s.size());
+    arena.insert(arena.end(), s.begin(), s.end());
+}
+
+void TrackStore::releaseText(TextRef& ref)
+{
+    garbage += ref.length;
+    ref = TextRef();
+}
+
+bool TrackStore::isWithin(TextRef inner, TextRef outer)
+{
+    return inner.length > 0 && inner.offset >= outer.offset
+           && inner.offset + inner.length <= outer.offset + outer.length;
+}
+
+void TrackStore::releaseTitle(quint32 slot)
+{
+    // Only text of its own becomes garbage, not a share of the file name.
+    if (isWithin(titles[slot], fileNames[slot]))
+        titles[slot] = TextRef();
+    else
+        releaseText(titles[slot]);
+}
+
+void TrackStore::compactText()
+{
+    if (garbage < MinGarbage || garbage * 2 < arena.size())
+        return;
+
+    std::vector<QChar> compacted;
+    compacted.reserve(arena.size() - garbage);
+    auto keep = [this, &compacted](TextRef& ref) {
+        const QStringView s = text(ref);
+        ref.offset = quint32(compacted.size());
+        compacted.insert(compacted.end(), s.begin(), s.end());
+    };
+    for (size_t slot = 0; slot < occupied.size(); ++slot) {
+        if (!occupied[slot])
+            continue;
+
+        TextRef& title = titles[slot];
+        if (isWithin(title, fileNames[slot])) {
+            const quint32 within = title.offset - fileNames[slot].offset;
+            keep(fileNames[slot]);
+            title.offset = fileNames[slot].offset + within;
+        } else {
+            keep(fileNames[slot]);
+            keep(title);
+        }
+    }
+
+    arena.swap(compacted);
+    garbage = 0;
+}
+
+quint32 TrackStore::appendSlot()
+{
+    generations.push_back(1);
+    occupied.push_back(0);
+    folders.push_back(0);
+    fileNames.emplace_back();
+    titles.emplace_back();
+    artists.push_back(0);
+    albums.push_back(0);
+    artHashes.push_back(0);
+    durationsMs.push_back(0);
+    codecs.push_back(0);
+    sampleRates.push_back(0);
+    channelCounts.push_back(0);
+    bitRates.push_back(0);
+    quickHashes.push_back(0);
+    contentHashes.push_back(0);
+    return quint32(generations.size() - 1);
+}
+
+void TrackStore::assign(quint32 slot, const Track& track)
+{
+    const auto [folder, name] = splitPath(track.filePath);
+    folders[slot] = folderPool.intern(folder.toString());
+
+    // A title shared with the old file name has to let go of it first.
+    if (isWithin(titles[slot], fileNames[slot]))
+        titles[slot] = TextRef();
+    setText(fileNames[slot], name);
+
+    const qsizetype within = track.title.isEmpty() ? -1 : text(fileNames[slot]).indexOf(track.title);
+    if (within >= 0) {
+        releaseText(titles[slot]);
+        titles[slot] = { fileNames[slot].offset + quint32(within), quint32(track.title.size()) };
+    } else {
+        setText(titles[slot], track.title);
+    }
+    artists[slot] = tagPool.intern(track.artist);
+    albums[slot] = tagPool.intern(track.album);
+    artHashes[slot] = track.artHash;
+
+    durationsMs[slot] = track.durationMs;
+    codecs[slot] = tagPool.intern(track.codec);
+    sampleRates[slot] = track.sampleRate;
+    channelCounts[slot] = track.channels;
+    bitRates[slot] = track.bitRate;
+    quickHashes[slot] = track.quickHash;
+    contentHashes[slot] = track.contentHash;
+}
+
+TrackHandle TrackStore::insert(const Track& track)
+{
+    const quint32 hash = hashPath(track.filePath);
+    const size_t bucket = findBucket(track.filePath, hash);
+    if (bucket != NotFound) {
+        const quint32 slot = buckets[bucket].slot;
+        assign(slot, track);
+        compactText();
+        return TrackHandle(slot, generations[slot]);
+    }
+
+    // Grow (or just sweep out Removed markers) before going over half full,
+    // to a quarter full.
+    if ((usedBuckets + 1) * 2 > buckets.size()) {
+        size_t bucketCount = MinBuckets;
+        while (bucketCount < (size_t(live) + 1) * 4)
+            bucketCount *= 2;
+        rehash(bucketCount);
+    }
+
+    quint32 slot;
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    } else {
+        slot = appendSlot();
+    }
+
+    occupied[slot] = 1;
+    ++live;
+    assign(slot, track);
+    insertBucket(slot, hash);
+    return TrackHandle(slot, generations[slot]);
+}
+
+TrackHandle TrackStore::find(const QString& filePath) const
+{
+    const size_t bucket = findBucket(filePath, hashPath(filePath));
+    if (bucket == NotFound)
+        return {};
+
+    const quint32 slot = buckets[bucket].slot;
+    return TrackHandle(slot, generations[slot]);
+}
+
+bool TrackStore::contains(TrackHandle handle) const
+{
+    return !handle.isNull() && handle.slot < occupied.size() && occupied[handle.slot]
+           && generations[handle.slot] == handle.generation;
+}
+
+bool TrackStore::get(TrackHandle handle, Track& track) const
+{
+    if (!contains(handle))
+        return false;
+
+    const quint32 slot = handle.slot;
+    track.filePath = joinPath(folders[slot], fileNames[slot]);
+    track.title = text(titles[slot]).toString();
+    track.artist = tagPool.at(artists[slot]);
+    track.album = tagPool.at(albums[slot]);
+    track.artHash = artHashes[slot];
+    track.durationMs = durationsMs[slot];
+    track.codec = tagPool.at(codecs[slot]);
+    track.sampleRate = sampleRates[slot];
+    track.channels = channelCounts[slot];
+    track.bitRate = bitRates[slot];
+    track.quickHash = quickHashes[slot];
+    track.contentHash = contentHashes[slot];
+    return true;
+}
+
+QString TrackStore::filePath(TrackHandle handle) const
+{
+    return contains(handle) ? joinPath(folders[handle.slot], fileNames[handle.slot]) : QString();
+}
+
+quint64 TrackStore::artHash(TrackHandle handle) const
+{
+    return contains(handle) ? artHashes[handle.slot] : 0;
+}
+
+quint64 TrackStore::quickHash(TrackHandle handle) const
+{
+    return contains(handle) ? quickHashes[handle.slot] : 0;
+}
+
+void TrackStore::setContentHash(TrackHandle handle, quint64 contentHash)
+{
+    if (contains(handle))
+        contentHashes[handle.slot] = contentHash;
+}
+
+void TrackStore::retire(quint32 slot, size_t bucket)
+{
+    // The marker keeps later buckets in the same probe run reachable.
+    buckets[bucket].slot = Removed;
+
+    releaseTitle(slot);
+    releaseText(fileNames[slot]);
+
+    // A new generation retires every handle to the old track.
+    occupied[slot] = 0;
+    if (++generations[slot] == 0)
+        generations[slot] = 1;
+    freeSlots.push_back(slot);
+    --live;
+}
+
+bool TrackStore::remove(const QString& filePath)
+{
+    const size_t bucket = findBucket(filePath, hashPath(filePath));
+    if (bucket == NotFound)
+        return false;
+
+    retire(buckets[bucket].slot, bucket);
+    compactText();
+    return true;
+}
+
+int TrackStore::removeIf(const std::function<bool(const QString& filePath)>& shouldRemove)
+{
+    int removed = 0;
+    for (size_t slot = 0; slot < occupied.size(); ++slot) {
+        if (!occupied[slot])
+            continue;
+
+        const QString path = joinPath(folders[slot], fileNames[slot]);
+        if (!shouldRemove(path))
+            continue;
+
+        retire(quint32(slot), findBucket(path, hashPath(path)));
+        ++removed;
+    }
+
+    compactText();
+    return removed;
+}
+
+void TrackStore::clear()
+{
+    // Slots are kept (and retired) rather than freed, so that handles to
+    // the cleared tracks can't come back to life when the slots are reused.
+    removeIf([](const QString&) { return true; });
+}
+
+void TrackStore::squeeze()
+{
+    compactText();
+    generations.shrink_to_fit();
+    occupied.shrink_to_fit();
+    folders.shrink_to_fit();
+    fileNames.shrink_to_fit();
+    titles.shrink_to_fit();
+    artists.shrink_to_fit();
+    albums.shrink_to_fit();
+    artHashes.shrink_to_fit();
+    durationsMs.shrink_to_fit();
+    codecs.shrink_to_fit();
+    sampleRates.shrink_to_fit();
+    channelCounts.shrink_to_fit();
+    bitRates.shrink_to_fit();
+    quickHashes.shrink_to_fit();
+    contentHashes.shrink_to_fit();
+    arena.shrink_to_fit();
+    freeSlots.shrink_to_fit();
+}
+
+QVector<TrackHandle> TrackStore::sorted(SortKey key) const
+{
+    std::vector<quint32> order;
+    order.reserve(size_t(live));
+    for (size_t slot = 0; slot < occupied.size(); ++slot) {
+        if (occupied[slot])
+            order.push_back(quint32(slot));
+    }
+
+    auto compareText = [this](const std::vector<TextRef>& column, quint32 a, quint32 b) {
+        return text(column[a]).compare(text(column[b]), Qt::CaseInsensitive);
+    };
+
+    // Artists and albums sort by their rank among the pool's strings,
+    // worked out once, rather than by comparing strings per pair.
+    std::vector<quint32> rank;
+    if (key != SortKey::Duration)
+        rank = tagPool.ranks();
+
+    switch (key) {
+    case SortKey::Title:
+        std::stable_sort(order.begin(), order.end(), [&](quint32 a, quint32 b) {
+            const int byTitle = compareText(titles, a, b);
+            return byTitle != 0 ? byTitle < 0 : rank[artists[a]] < rank[artists[b]];
+        });
+        break;
+    case SortKey::Artist:
+        std::stable_sort(order.begin(), order.end(), [&](quint32 a, quint32 b) {
+            if (artists[a] != artists[b])
+                return rank[artists[a]] < rank[artists[b]];
+            if (albums[a] != albums[b])
+                return rank[albums[a]] < rank[albums[b]];
+            return compareText(fileNames, a, b) < 0;
+        });
+        break;
+    case SortKey::Album:
+        std::stable_sort(order.begin(), order.end(), [&](quint32 a, quint32 b) {
+            if (albums[a] != albums[b])
+                return rank[albums[a]] < rank[albums[b]];
+            return compareText(fileNames, a, b) < 0;
+        });
+        break;
+    case SortKey::Duration:
+        std::stable_sort(order.begin(), order.end(), [this](quint32 a, quint32 b) {
+            return durationsMs[a] < durationsMs[b];
+        });
+        break;
+    }
+
+    QVector<TrackHandle> handles;
+    handles.reserve(qsizetype(order.size()));
+    for (quint32 slot : order)
+        handles.append(TrackHandle(slot, generations[slot]));
+    return handles;
+}
+
+QVector<TrackHandle> TrackStore::matching(QStringView needle) const
+{
+    // Each distinct artist and album is tested once; tracks then only look
+    // up the answer by id.
+    std::vector<quint8> tagMatches(size_t(tagPool.size()));
+    for (int id = 0; id < tagPool.size(); ++id)
+        tagMatches[size_t(id)] = tagPool.at(quint32(id)).contains(needle, Qt::CaseInsensitive);
+
+    QVector<TrackHandle> handles;
+    for (size_t slot = 0; slot < occupied.size(); ++slot) {
+        if (!occupied[slot])
+            continue;
+        if (tagMatches[artists[slot]] || tagMatches[albums[slot]]
+            || text(titles[slot]).contains(needle, Qt::CaseInsensitive))
+            handles.append(TrackHandle(quint32(slot), generations[slot]));
+    }
+    return handles;
+}
+
+qsizetype TrackStore::memoryUsage() const
+{
+    return columnBytes(generations) + columnBytes(occupied) + columnBytes(folders) + columnBytes(fileNames)
+           + columnBytes(titles) + columnBytes(artists) + columnBytes(albums) + columnBytes(artHashes)
+           + columnBytes(durationsMs) + columnBytes(codecs) + columnBytes(sampleRates)
+           + columnBytes(channelCounts) + columnBytes(bitRates) + columnBytes(quickHashes)
+           + columnBytes(contentHashes) + columnBytes(arena) + columnBytes(freeSlots) + columnBytes(buckets)
+           + folderPool.memoryUsage() + tagPool.memoryUsage();
+}
@@ -0,0 +1,204 @@
+#ifndef TRACKSTORE_H
+#define TRACKSTORE_H
+
+#include <QMetaType>
+#include <QString>
+#include <QStringView>
+#include <QVector>
+
+#include <functional>
+#include <vector>
+
+#include "stringpool.h"
+#include "track.h"
+
+// -----------------------------------------------------------------------------
+// TrackHandle: a reference to a track in a TrackStore that can't dangle. It
+// names the track's slot and the slot's generation; once the track is
+// removed the slot's generation moves on, and the handle resolves to nothing
+// rather than to whatever track takes the slot next.
+//
+// A track keeps its handle while it stays in the store, through rescans and
+// tag updates, so list items can hold one for as long as they like. toId()
+// packs it into 64 bits; the low 32 (the slot) alone are unique among the
+// tracks in the store at any one time.
+// -----------------------------------------------------------------------------
+class TrackHandle
+{
+public:
+    TrackHandle() = default;
+
+    bool isNull() const { return generation == 0; }
+
+    quint64 toId() const { return quint64(generation) << 32 | slot; }
+    static TrackHandle fromId(quint64 id) { return TrackHandle(quint32(id), quint32(id >> 32)); }
+
+    bool operator==(const TrackHandle& other) const { return slot == other.slot && generation == other.generation; }
+    bool operator!=(const TrackHandle& other) const { return !(*this == other); }
+
+private:
+    friend class TrackStore;
+    TrackHandle(quint32 slot_, quint32 generation_) : slot(slot_), generation(generation_) {}
+
+    quint32 slot = 0;
+    quint32 generation = 0;   // 0: null
+};
+
+Q_DECLARE_METATYPE(TrackHandle)
+
+// -----------------------------------------------------------------------------
+// TrackStore: the library's tracks, by file path, kept column by column.
+//
+// A Track is handy to pass around but heavy to keep 100k of: five QStrings,
+// with the folder repeated in every path and the artist and album in every
+// track by them. Here each field is an array indexed by slot. Folders,
+// artists, albums and codecs are StringPool ids; file names and titles are
+// ranges of one UTF-16 arena; a path is (folder id, file name), and a title
+// found in its file name ("07 - Title.flac", or the file name itself for
+// untagged files) points into the name's text rather than being stored
+// again. sorted() and matching() walk these arrays:
+// artists and albums compare as integer ranks, and a filter tests each
+// distinct one once.
+//
+// A removed track's slot is reused; its TrackHandle knows, because the
+// slot's generation moves on. Paths are found through an open-addressing
+// table (linear probing, kept at most half full) of slot numbers and 32-bit
+// path hashes, so a lookup is a probe or two and only compares paths whose
+// hashes already match. Text left behind by removed or retitled tracks is
+// reclaimed once it is half the arena; squeeze() returns the arrays' spare
+// capacity once a scan is done growing them.
+//
+// get() builds a Track; the single-field accessors don't. Not thread-safe;
+// LibraryManager uses it on the GUI thread.
+// -----------------------------------------------------------------------------
+class TrackStore
+{
+public:
+    enum class SortKey
+    {
+        Title,      // then artist
+        Artist,     // then album, then file name
+        Album,      // then file name (usually the track number)
+        Duration,
+    };
+
+    // Add a track, or replace the one with the same filePath in place (its
+    // handle stays the same).
+    TrackHandle insert(const Track& track);
+
+    // Null if no track has that path.
+    TrackHandle find(const QString& filePath) const;
+
+    // False once the track has been removed.
+    bool contains(TrackHandle handle) const;
+    bool get(TrackHandle handle, Track& track) const;
+
+    // Single fields; empty or 0 once the track has been removed.
+    QString filePath(TrackHandle handle) const;
+    quint64 artHash(TrackHandle handle) const;
+    quint64 quickHash(TrackHandle handle) const;
+    void setContentHash(TrackHandle handle, quint64 contentHash);
+
+    // Remove the track with that path, if there is one.
+    bool remove(const QString& filePath);
+    // Remove every track whose path shouldRemove returns true for; returns
+    // how many.
+    int removeIf(const std::function<bool(const QString& filePath)>& shouldRemove);
+    void clear();
+
+    // Release spare capacity (after a scan, say).
+    void squeeze();
+
+    int size() const { return live; }
+    bool isEmpty() const { return live == 0; }
+
+    // Every track's handle, in slot order.
+    template <typename Fn>
+    void forEach(Fn&& fn) const
+    {
+        for (size_t slot = 0; slot < occupied.size(); ++slot) {
+            if (occupied[slot])
+                fn(TrackHandle(quint32(slot), generations[slot]));
+        }
+    }
+
+    // Every track, ordered by key (text compared case-insensitively).
+    QVector<TrackHandle> sorted(SortKey key) const;
+    // Tracks whose title, artist or album contains needle,
+    // case-insensitively, in slot order.
+    QVector<TrackHandle> matching(QStringView needle) const;
+
+    // Bytes held by the columns, text, pools and path table (approximately;
+    // allocator overhead isn't counted).
+    qsizetype memoryUsage() const;
+
+private:
+    struct TextRef
+    {
+        quint32 offset = 0;
+        quint32 length = 0;
+    };
+
+    struct Bucket
+    {
+        quint32 slot = Empty;
+        quint32 hash = 0;
+    };
+
+    static constexpr quint32 Empty = ~quint32(0);
+    static constexpr quint32 Removed = ~quint32(0) - 1;
+    static constexpr size_t MinBuckets = 64;
+    static constexpr size_t NotFound = ~size_t(0);
+    static constexpr size_t MinGarbage = 1 << 16;
+
+    static quint32 hashPath(QStringView filePath);
+
+    // Index of the bucket holding filePath, or NotFound.
+    size_t findBucket(QStringView filePath, quint32 hash) const;
+    void insertBucket(quint32 slot, quint32 hash);
+    void rehash(size_t bucketCount);
+    void retire(quint32 slot, size_t bucket);
+
+    // Columns.
+    quint32 appendSlot();
+    void assign(quint32 slot, const Track& track);
+    bool matchesPath(quint32 slot, QStringView filePath) const;
+    QString joinPath(quint32 folder, TextRef name) const;
+
+    // The arena.
+    QStringView text(TextRef ref) const { return QStringView(arena.data() + ref.offset, qsizetype(ref.length)); }
+    void setText(TextRef& ref, QStringView s);
+    void releaseText(TextRef& ref);
+    void releaseTitle(quint32 slot);
+    void compactText();
+    static bool isWithin(TextRef inner, TextRef outer);
+
+    // Per slot.
+    std::vector<quint32> generations;
+    std::vector<quint8> occupied;
+    std::vector<quint32> folders;         // of filePath, with its trailing '/'
+    std::vector<TextRef> fileNames;
+    std::vector<TextRef> titles;
+    std::vector<quint32> artists;
+    std::vector<quint32> albums;
+    std::vector<quint64> artHashes;
+    std::vector<qint64> durationsMs;
+    std::vector<quint32> codecs;
+    std::vector<qint32> sampleRates;
+    std::vector<qint32> channelCounts;
+    std::vector<qint32> bitRates;
+    std::vector<quint64> quickHashes;
+    std::vector<quint64> contentHashes;
+
+    StringPool folderPool;
+    StringPool tagPool;                   // artists, albums and codecs
+    std::vector<QChar> arena;
+    size_t garbage = 0;                   // arena characters no track uses
+
+    std::vector<quint32> freeSlots;
+    std::vector<Bucket> buckets;
+    int live = 0;
+    size_t usedBuckets = 0;               // live and Removed
+};
+
+#endif // TRACKSTORE_H
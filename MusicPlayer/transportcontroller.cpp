@@ -0,0 +1,254 @@
+#include "transportcontroller.h"
+
+TransportController::TransportController(juce::AudioTransportSource& transportToDrive)
+    : transport(transportToDrive)
+{
+}
+
+//============================================================================
+// Producer side (UI thread)
+
+bool TransportController::play()
+{
+    // Starting the transport broadcasts a change message (which locks and
+    // posts), so it happens here rather than on the audio thread. Nothing
+    // pulls a stopped transport, so its callback lock is free; the audio
+    // thread pulls again, fading in, once it has the Play command.
+    if (!transport.isPlaying())
+        transport.start();
+
+    playRequested.store(true, std::memory_order_relaxed);
+    return post({ Command::Play });
+}
+
+bool TransportController::pause()
+{
+    playRequested.store(false, std::memory_order_relaxed);
+    return post({ Command::Pause });
+}
+
+bool TransportController::seek(double seconds)
+{
+    Command command { Command::Seek, juce::jmax(0.0, seconds) };
+    command.seekSerial = latestSeekSerial.fetch_add(1, std::memory_order_relaxed) + 1;
+    pendingSeekSeconds.store(command.position, std::memory_order_relaxed);
+    return post(command);
+}
+
+bool TransportController::reset()
+{
+    // A new source starts at 0; report that until the audio thread has caught up.
+    Command command { Command::Reset };
+    command.seekSerial = latestSeekSerial.fetch_add(1, std::memory_order_relaxed) + 1;
+    command.sourceSerial = latestSourceSerial.fetch_add(1, std::memory_order_relaxed) + 1;
+    playRequested.store(false, std::memory_order_relaxed);
+    pendingSeekSeconds.store(0.0, std::memory_order_relaxed);
+    return post(command);
+}
+
+bool TransportController::post(const Command& command)
+{
+    const auto scope = fifo.write(1);
+
+    if (scope.blockSize1 > 0)
+        commands[static_cast<size_t>(scope.startIndex1)] = command;
+    else if (scope.blockSize2 > 0)
+        commands[static_cast<size_t>(scope.startIndex2)] = command;
+    else
+        return false;
+
+    return true;
+}
+
+bool TransportController::popEvent(Event& event)
+{
+    if (eventFifo.getNumReady() == 0)
+        return false;
+
+    const auto scope = eventFifo.read(1);
+    event = events[static_cast<size_t>(scope.blockSize1 > 0 ? scope.startIndex1 : scope.startIndex2)];
+    return true;
+}
+
+//============================================================================
+// Consumer side (audio thread)
+
+void TransportController::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    rampLength = juce::jmax(1, juce::roundToInt(RampSeconds * sampleRate));
+    transport.prepareToPlay(samplesPerBlockExpected, sampleRate);
+}
+
+void TransportController::releaseResources()
+{
+    transport.releaseResources();
+}
+
+void TransportController::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    const int numReady = fifo.getNumReady();
+    if (numReady > 0)
+    {
+        const auto scope = fifo.read(numReady);
+        scope.forEach([this](int index) { apply(commands[static_cast<size_t>(index)]); });
+    }
+
+    // Paused: the transport isn't pulled at all, so its position holds.
+    if (paused)
+    {
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+
+    transport.getNextAudioBlock(bufferToFill);
+
+    if (bufferToFill.buffer != nullptr)
+        applyGain(*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples);
+
+    // Finish a pause or seek once the fade has reached silence.
+    if (rampSamplesLeft == 0 && gain == 0.0f && (pauseAfterFade || seekAfterFade))
+        finishFadeOut();
+
+    // The track ran out on its own (and nobody has asked for anything since).
+    // The transport stopped itself, and isn't pulled again until a Play
+    // (which starts it again) has been carried out.
+    if (transport.hasStreamFinished() && !transport.isPlaying() && fifo.getNumReady() == 0)
+    {
+        paused = true;
+        if (playRequested.exchange(false, std::memory_order_relaxed))
+            postEvent(Event::Ended);
+    }
+}
+
+void TransportController::postEvent(Event::Type type)
+{
+    // A full queue means nobody is reading; dropping is all we can do here.
+    const auto scope = eventFifo.write(1);
+    if (scope.blockSize1 > 0)
+        events[static_cast<size_t>(scope.startIndex1)] = { type, sourceSerial };
+    else if (scope.blockSize2 > 0)
+        events[static_cast<size_t>(scope.startIndex2)] = { type, sourceSerial };
+    else
+        return;
+
+    eventsPosted.signal();
+}
+
+void TransportController::apply(const Command& command)
+{
+    // Audible: the transport is running and we are pulling from it.
+    const bool audible = isPulling();
+
+    switch (command.type)
+    {
+        case Command::Play:
+        {
+            // play() has already started the transport.
+            pauseAfterFade = false;
+            if (paused)
+            {
+                paused = false;
+                gain = 0.0f;
+            }
+            // A seek that is still fading out fades back in by itself.
+            if (!seekAfterFade)
+                rampTo(1.0f);
+
+            if (!audible && isPulling())
+                postEvent(Event::Started);
+            break;
+        }
+
+        case Command::Pause:
+            if (audible)
+            {
+                pauseAfterFade = true;
+                rampTo(0.0f);
+            }
+            break;
+
+        case Command::Seek:
+            if (audible)
+            {
+                seekAfterFade = true;
+                seekTarget = command.position;
+                seekTargetSerial = command.seekSerial;
+                rampTo(0.0f);
+            }
+            else
+            {
+                // Nothing audible to de-click.
+                transport.setPosition(command.position);
+                if (command.seekSerial == latestSeekSerial.load(std::memory_order_relaxed))
+                    pendingSeekSeconds.store(-1.0, std::memory_order_relaxed);
+            }
+            break;
+
+        case Command::Reset:
+            sourceSerial = command.sourceSerial;
+            paused = true;
+            pauseAfterFade = false;
+            seekAfterFade = false;
+            gain = gainTarget = 1.0f;
+            rampSamplesLeft = 0;
+            if (command.seekSerial == latestSeekSerial.load(std::memory_order_relaxed))
+                pendingSeekSeconds.store(-1.0, std::memory_order_relaxed);
+            break;
+    }
+}
+
+void TransportController::rampTo(float target)
+{
+    gainTarget = target;
+    rampSamplesLeft = gain == target ? 0 : rampLength;
+    gainStep = rampSamplesLeft > 0 ? (target - gain) / static_cast<float>(rampLength) : 0.0f;
+}
+
+void TransportController::applyGain(juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    const int numChannels = buffer.getNumChannels();
+
+    // Ramp section.
+    const int rampPart = juce::jmin(numSamples, rampSamplesLeft);
+    if (rampPart > 0)
+    {
+        rampSamplesLeft -= rampPart;
+        const float endGain = rampSamplesLeft == 0 ? gainTarget : gain + gainStep * static_cast<float>(rampPart);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            buffer.applyGainRamp(ch, startSample, rampPart, gain, endGain);
+
+        gain = endGain;
+    }
+
+    // Steady section: untouched at unity.
+    const int rest = numSamples - rampPart;
+    if (rest > 0 && gain != 1.0f)
+    {
+        for (int ch = 0; ch < numChannels; ++ch)
+            buffer.applyGain(ch, startSample + rampPart, rest, gain);
+    }
+}
+
+void TransportController::finishFadeOut()
+{
+    if (seekAfterFade)
+    {
+        seekAfterFade = false;
+        transport.setPosition(seekTarget);
+        if (seekTargetSerial == latestSeekSerial.load(std::memory_order_relaxed))
+            pendingSeekSeconds.store(-1.0, std::memory_order_relaxed);
+
+        if (!pauseAfterFade)
+            rampTo(1.0f);
+    }
+
+    // Pausing never calls transport.stop(): that waits for the audio thread,
+    // which is this one. We just stop pulling from the transport instead.
+    if (pauseAfterFade)
+    {
+        pauseAfterFade = false;
+        paused = true;
+        postEvent(Event::Paused);
+    }
+}
@@ -0,0 +1,132 @@
+#ifndef TRANSPORTCONTROLLER_H
+#define TRANSPORTCONTROLLER_H
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_audio_devices/juce_audio_devices.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// -----------------------------------------------------------------------------
+// TransportController: the only thing that starts, pauses or seeks the
+// transport during playback. The UI posts commands into a fixed-size
+// single-producer/single-consumer queue (juce::AbstractFifo); the audio thread
+// drains it at the start of each block and carries them out itself. The UI
+// therefore never takes the transport's callback lock.
+//
+// Pause, resume and seek are de-clicked with short linear gain ramps:
+//   pause  - fade out, then stop pulling from the transport
+//   resume - pull again, fade in
+//   seek   - fade out, move, fade back in (moves at once when nothing is audible)
+//
+// The transport is never started on the audio thread: start() broadcasts a
+// change message, which locks and posts. play() starts it on the posting
+// thread if it had stopped, and the audio thread only pulls from it once the
+// Play command arrives. A new source, or the end of the track, leaves the
+// transport unpulled until then.
+//
+// It sits right after the transport in the chain and passes audio through
+// untouched whenever no ramp is running. Commands must all be posted from one
+// thread (the Qt thread in the player, the main thread in the renderer).
+//
+// State changes that only the audio thread can see (playback actually started,
+// the pause fade finished, the track ran out) go the other way through a
+// second queue. Each event carries the serial of the source it belongs to, so
+// a reader can drop events that arrive after the track was replaced.
+// -----------------------------------------------------------------------------
+class TransportController : public juce::AudioSource
+{
+public:
+    static constexpr double RampSeconds = 0.010;
+
+    struct Event
+    {
+        enum Type { Started, Paused, Ended } type = Started;
+        uint32_t sourceSerial = 0;
+    };
+
+    explicit TransportController(juce::AudioTransportSource& transportToDrive);
+
+    // Producer side. Each returns false if the queue was full and the command
+    // was dropped (only possible while the device isn't pulling audio).
+    bool play();
+    bool pause();
+    bool seek(double seconds);
+
+    // Forget ramps and pending actions; posted when the transport gets a new source.
+    bool reset();
+
+    // Serial of the most recent reset(), i.e. of the current source.
+    uint32_t getSourceSerial() const { return latestSourceSerial.load(std::memory_order_relaxed); }
+
+    // Consumer side of the event queue (one thread). waitForEvents() blocks
+    // until an event is posted, wakeEventReader() is called or the timeout
+    // (ms, -1 for none) runs out.
+    bool popEvent(Event& event);
+    bool waitForEvents(int timeoutMs) { return eventsPosted.wait(timeoutMs); }
+    void wakeEventReader() { eventsPosted.signal(); }
+
+    // What the UI last asked for, cleared when the track runs out by itself.
+    bool isPlaying() const { return playRequested.load(std::memory_order_relaxed); }
+
+    // Target of a seek (or the start of a new source) that hasn't been carried
+    // out yet, or -1 if there is none.
+    double getPendingPosition() const { return pendingSeekSeconds.load(std::memory_order_relaxed); }
+
+    // Audio thread: whether the transport is being pulled (playing, or fading).
+    bool isPulling() const { return transport.isPlaying() && !paused; }
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+private:
+    struct Command
+    {
+        enum Type { Play, Pause, Seek, Reset } type = Play;
+        double position = 0.0;
+        uint32_t seekSerial = 0;   // Seek and Reset
+        uint32_t sourceSerial = 0; // Reset
+    };
+
+    static constexpr int QueueSize = 64;
+    static constexpr int EventQueueSize = 32;
+
+    bool post(const Command& command);
+    void postEvent(Event::Type type);
+    void apply(const Command& command);
+    void rampTo(float target);
+    void applyGain(juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+    void finishFadeOut();
+
+    juce::AudioTransportSource& transport;
+
+    juce::AbstractFifo fifo { QueueSize };
+    std::array<Command, QueueSize> commands {};
+
+    std::atomic<bool> playRequested { false };
+    std::atomic<double> pendingSeekSeconds { -1.0 };   // < 0: none
+    std::atomic<uint32_t> latestSeekSerial { 0 };
+    std::atomic<uint32_t> latestSourceSerial { 0 };
+
+    juce::AbstractFifo eventFifo { EventQueueSize };
+    std::array<Event, EventQueueSize> events {};
+    juce::WaitableEvent eventsPosted;
+
+    // Audio thread only.
+    int rampLength = 441;
+    float gain = 1.0f;
+    float gainTarget = 1.0f;
+    float gainStep = 0.0f;
+    int rampSamplesLeft = 0;
+
+    bool paused = true;            // not pulling the transport
+    bool pauseAfterFade = false;
+    bool seekAfterFade = false;
+    double seekTarget = 0.0;
+    uint32_t seekTargetSerial = 0;
+    uint32_t sourceSerial = 0;
+};
+
+#endif // TRANSPORTCONTROLLER_H
@@ -0,0 +1,149 @@
+#ifndef XXHASH64_H
+#define XXHASH64_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// -----------------------------------------------------------------------------
+// XxHash64: the XXH64 hash (Yann Collet's xxHash, 64-bit variant), fed in
+// pieces. Not cryptographic; it is here to tell files apart at close to
+// memory speed, and its digests match the reference implementation's (and
+// `xxhsum -H1`), so they can be checked against other tools.
+// -----------------------------------------------------------------------------
+class XxHash64
+{
+public:
+    explicit XxHash64(uint64_t seed = 0) { reset(seed); }
+
+    void reset(uint64_t newSeed = 0)
+    {
+        seed = newSeed;
+        acc[0] = seed + Prime1 + Prime2;
+        acc[1] = seed + Prime2;
+        acc[2] = seed;
+        acc[3] = seed - Prime1;
+        totalLength = 0;
+        bufferSize = 0;
+    }
+
+    void update(const void* data, size_t length)
+    {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        totalLength += length;
+
+        // Top up a partial stripe first.
+        if (bufferSize > 0) {
+            const size_t take = length < StripeSize - bufferSize ? length : StripeSize - bufferSize;
+            std::memcpy(buffer + bufferSize, p, take);
+            bufferSize += take;
+            p += take;
+            length -= take;
+            if (bufferSize < StripeSize)
+                return;
+            consumeStripe(buffer);
+            bufferSize = 0;
+        }
+
+        for (; length >= StripeSize; p += StripeSize, length -= StripeSize)
+            consumeStripe(p);
+
+        std::memcpy(buffer, p, length);
+        bufferSize = length;
+    }
+
+    uint64_t digest() const
+    {
+        uint64_t h;
+        if (totalLength >= StripeSize) {
+            h = rotl(acc[0], 1) + rotl(acc[1], 7) + rotl(acc[2], 12) + rotl(acc[3], 18);
+            for (uint64_t lane : acc)
+                h = mergeRound(h, lane);
+        } else {
+            h = seed + Prime5;
+        }
+        h += totalLength;
+
+        const unsigned char* p = buffer;
+        size_t remaining = bufferSize;
+        for (; remaining >= 8; p += 8, remaining -= 8) {
+            h ^= round(0, read64(p));
+            h = rotl(h, 27) * Prime1 + Prime4;
+        }
+        if (remaining >= 4) {
+            h ^= static_cast<uint64_t>(read32(p)) * Prime1;
+            h = rotl(h, 23) * Prime2 + Prime3;
+            p += 4;
+            remaining -= 4;
+        }
+        for (; remaining > 0; ++p, --remaining) {
+            h ^= *p * Prime5;
+            h = rotl(h, 11) * Prime1;
+        }
+
+        h ^= h >> 33;
+        h *= Prime2;
+        h ^= h >> 29;
+        h *= Prime3;
+        h ^= h >> 32;
+        return h;
+    }
+
+    static uint64_t hash(const void* data, size_t length, uint64_t seed = 0)
+    {
+        XxHash64 hasher(seed);
+        hasher.update(data, length);
+        return hasher.digest();
+    }
+
+private:
+    static constexpr uint64_t Prime1 = 11400714785074694791ULL;
+    static constexpr uint64_t Prime2 = 14029467366897019727ULL;
+    static constexpr uint64_t Prime3 = 1609587929392839161ULL;
+    static constexpr uint64_t Prime4 = 9650029242287828579ULL;
+    static constexpr uint64_t Prime5 = 2870177450012600261ULL;
+    static constexpr size_t StripeSize = 32;
+
+    static uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+    static uint64_t round(uint64_t lane, uint64_t input)
+    {
+        lane += input * Prime2;
+        return rotl(lane, 31) * Prime1;
+    }
+
+    static uint64_t mergeRound(uint64_t h, uint64_t lane)
+    {
+        h ^= round(0, lane);
+        return h * Prime1 + Prime4;
+    }
+
+    // Little-endian whatever the host is, so digests travel between machines.
+    static uint64_t read64(const unsigned char* p)
+    {
+        uint64_t v = 0;
+        for (int i = 7; i >= 0; --i)
+            v = (v << 8) | p[i];
+        return v;
+    }
+
+    static uint32_t read32(const unsigned char* p)
+    {
+        return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8
+               | static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
+    }
+
+    void consumeStripe(const unsigned char* p)
+    {
+        for (int lane = 0; lane < 4; ++lane)
+            acc[lane] = round(acc[lane], read64(p + 8 * lane));
+    }
+
+    uint64_t seed = 0;
+    uint64_t acc[4] {};
+    uint64_t totalLength = 0;
+    unsigned char buffer[StripeSize] {};
+    size_t bufferSize = 0;
+};
+
+#endif // XXHASH64_H